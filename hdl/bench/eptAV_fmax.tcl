@@ -0,0 +1,57 @@
+# ===============================================================
+# EPT Fmax benchmark
+# ===============================================================
+# Compiles eptAV.v stand-alone and reports the achieved Fmax and the critical path
+#   quartus_sh -t eptAV_fmax.tcl [family] [device]
+# Run it on two revisions to compare them, e.g. before and after a read path change
+# The result is printed and appended to eptAV_fmax.txt
+
+set benchDir [file dirname [file normalize [info script]]]
+set hdlDir [file dirname $benchDir]
+
+# --- Timing analysis pass (run by quartus_sta) ---
+if {[lindex $quartus(args) 0] == "sta"} {
+	project_open eptAV_fmax
+	create_timing_netlist
+	read_sdc
+	update_timing_netlist
+	set fmax [lindex [lindex [get_clock_fmax_info] 0] 2]
+	set path [get_timing_paths -setup -npaths 1]
+	foreach_in_collection p $path {
+		set from [get_node_info -name [get_path_info $p -from]]
+		set to [get_node_info -name [get_path_info $p -to]]
+		set slack [get_path_info $p -slack]
+	}
+	set result "[clock format [clock seconds] -format {%Y-%m-%d %H:%M}] Fmax: $fmax MHz, slack: $slack ns, critical path: $from -> $to"
+	puts $result
+	set log [open [file join $benchDir eptAV_fmax.txt] a]
+	puts $log $result
+	close $log
+	delete_timing_netlist
+	project_close
+	return
+}
+
+# --- Compilation pass (run by quartus_sh) ---
+package require ::quartus::project
+package require ::quartus::flow
+
+set family [lindex [concat $quartus(args) {"Cyclone IV E"}] 0]
+set device [lindex [concat [lrange $quartus(args) 1 end] EP4CE22F17C6] 0]
+
+cd $benchDir
+project_new eptAV_fmax -overwrite
+set_global_assignment -name FAMILY $family
+set_global_assignment -name DEVICE $device
+set_global_assignment -name TOP_LEVEL_ENTITY eptAV
+foreach file {eptAV.v ept.v counter.v timebase.v trace.v dma.v histogram.v budget.v sampler.v trigger.v} {
+	set_global_assignment -name VERILOG_FILE [file join $hdlDir $file]
+}
+set_global_assignment -name SDC_FILE [file join $benchDir eptAV.sdc]
+# The conduits stay ports: no I/O packing, the core logic is measured
+set_global_assignment -name VIRTUAL_PIN ON -to *
+set_instance_assignment -name VIRTUAL_PIN OFF -to ept_clock
+execute_flow -compile
+project_close
+
+qexec "quartus_sta -t [info script] sta"
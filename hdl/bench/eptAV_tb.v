@@ -0,0 +1,217 @@
+//=================================================================================================
+// Execution Performance Tester Interface: Read Latency Bench
+// 	@Brief:
+//		  - Avalon master stimulus of eptAV with a behavioral ping-pong record RAM (registered output)
+//		  - Single cycle read transfers to registers and to a RAM field, the readdata is sampled at
+//			 every clock edge after the address phase until it matches the expected value
+//		  - Reports the read latency in cycles: 0 for a combinational readdata, else the readLatency of eptAV_hw.tcl
+//		  - The transfers are held while ept_waitrequest is set, e.g. a RAM field read right after a fill start
+//			 or a register write at the cycle of a probe
+//		  - A task start probe at the cycle of a preemption stack pop: the probe wins, the resumed task is preempted
+//		@Run:
+//			 iverilog -o eptAV_tb bench/eptAV_tb.v eptAV.v ept.v counter.v timebase.v trace.v dma.v histogram.v budget.v sampler.v trigger.v && vvp eptAV_tb
+//=================================================================================================
+
+`timescale 1ns / 1ps
+
+module eptAV_tb;
+
+	localparam
+		ADDRESS_WIDTH		= 11,
+		DATA_WIDTH			= 32,
+		RECORD_SIZE			= 3,
+		RAM_ADDRESS_WIDTH	= ADDRESS_WIDTH - RECORD_SIZE,
+		RECORD_WIDTH		= DATA_WIDTH << RECORD_SIZE,
+		RECORD_BYTES		= RECORD_WIDTH / 8,
+		LATENCY_MAX			= 8;
+	localparam [ADDRESS_WIDTH-1:0]
+		MM_REGISTER_BASE	= 1'b1 << (ADDRESS_WIDTH-1),
+		MM_READY				= MM_REGISTER_BASE + 'h2,
+		MM_START				= MM_REGISTER_BASE + 'h3,
+		MM_MODE				= MM_REGISTER_BASE + 'hc,
+		MM_TASK_ID			= MM_REGISTER_BASE + 'h5,
+		MM_OFFSET_ISR		= MM_REGISTER_BASE + 'h13,
+		MM_FILL_RANGE		= MM_REGISTER_BASE + 'h1b,
+		MM_FILL				= MM_REGISTER_BASE + 'h1c,
+		MM_PREEMPT			= MM_REGISTER_BASE + 'h1d,
+		MM_RAM_FIELD		= 'h2a;														// Record 5, field 2
+	localparam [2:0]
+		PROBE_TASK_ID		= 3'd0;
+
+	//----------------------------------
+	// Signal declaration
+	//----------------------------------
+	reg clock = 0, reset = 1;
+	reg [ADDRESS_WIDTH-1:0] address = 0;
+	reg [DATA_WIDTH-1:0] writedata = 0;
+	reg chipselect = 0, write = 0, read = 0;
+	reg probeValid = 0;
+	reg [2:0] probeSelect = 0;
+	reg [DATA_WIDTH-1:0] probeData = 0;
+	wire [DATA_WIDTH-1:0] readdata;
+	wire waitrequest, status;
+	wire [RAM_ADDRESS_WIDTH-1:0] ramAddress, ramWriteAddress, ramAddressB;
+	wire [RECORD_WIDTH-1:0] ramWriteData, ramWriteDataB;
+	reg  [RECORD_WIDTH-1:0] ramReadData, ramReadDataB;
+	wire [RECORD_BYTES-1:0] ramByteEnable, ramByteEnableB;
+	wire ramWrite, ramWriteB;
+	reg  [RECORD_WIDTH-1:0] ram [0:(1 << RAM_ADDRESS_WIDTH)-1];
+	integer i, latency, worst = 0, errors = 0;
+
+	always #5 clock = ~clock;															// 100 MHz
+
+	//----------------------------------
+	// Behavioral record RAM
+	//----------------------------------
+	// Port A: read and byte enabled write at separate addresses, port B: frozen bank
+	always @ (posedge clock) begin
+		ramReadData		<= ram[ramAddress];
+		ramReadDataB	<= ram[ramAddressB];
+		for (i=0; i<RECORD_BYTES; i=i+1) begin
+			if (ramWrite & ramByteEnable[i]) ram[ramWriteAddress][i*8 +: 8] <= ramWriteData[i*8 +: 8];
+			if (ramWriteB & ramByteEnableB[i]) ram[ramAddressB][i*8 +: 8] <= ramWriteDataB[i*8 +: 8];
+		end
+	end
+
+	//----------------------------------
+	// Device under test
+	//----------------------------------
+	eptAV #(.ADDRESS_WIDTH(ADDRESS_WIDTH), .DATA_WIDTH(DATA_WIDTH), .RECORD_SIZE(RECORD_SIZE)) dut
+	(
+		.ept_clock(clock),
+		.ept_reset(reset),
+		.ept_measure_clock(1'b0),
+		.ept_address(address),
+		.ept_writedata(writedata),
+		.ept_readdata(readdata),
+		.ept_chipselect(chipselect),
+		.ept_write(write),
+		.ept_read(read),
+		.ept_waitrequest(waitrequest),
+		.ept_irc(1'b0),
+		.ept_status(status),
+		.ept_irq(),
+		.ept_dma_address(),
+		.ept_dma_write(),
+		.ept_dma_writedata(),
+		.ept_dma_waitrequest(1'b0),
+		.ept_probe_valid(probeValid),
+		.ept_probe_select(probeSelect),
+		.ept_probe_data(probeData),
+		.ept_probe_counter(),
+		.ept_ramaddress_exp(ramAddress),
+		.ept_ramwriteaddress_exp(ramWriteAddress),
+		.ept_ramwritedata_exp(ramWriteData),
+		.ept_ramreaddata_exp(ramReadData),
+		.ept_rambyteenable_exp(ramByteEnable),
+		.ept_ramwrite_exp(ramWrite),
+		.ept_ramaddress_b_exp(ramAddressB),
+		.ept_ramwritedata_b_exp(ramWriteDataB),
+		.ept_ramreaddata_b_exp(ramReadDataB),
+		.ept_rambyteenable_b_exp(ramByteEnableB),
+		.ept_ramwrite_b_exp(ramWriteB)
+	);
+
+	//----------------------------------
+	// Avalon master tasks
+	//----------------------------------
+	task busWrite(input [ADDRESS_WIDTH-1:0] a, input [DATA_WIDTH-1:0] d);
+		begin
+			@ (negedge clock);
+			address = a; writedata = d; chipselect = 1; write = 1;
+			#1 while (waitrequest) @ (negedge clock);
+			@ (negedge clock);
+			chipselect = 0; write = 0;
+		end
+	endtask
+
+	// Bus write with a single cycle probe at its first cycle: the write waits for the probe
+	task busWriteProbe(input [ADDRESS_WIDTH-1:0] a, input [DATA_WIDTH-1:0] d, input [2:0] s, input [DATA_WIDTH-1:0] pd);
+		begin
+			@ (negedge clock);
+			address = a; writedata = d; chipselect = 1; write = 1;
+			probeValid = 1; probeSelect = s; probeData = pd;
+			#1 if (!waitrequest) begin
+				$display("FAIL - write 0x%h is not held at the probe", a);
+				errors = errors + 1;
+			end
+			@ (negedge clock);
+			probeValid = 0;
+			#1 while (waitrequest) @ (negedge clock);
+			@ (negedge clock);
+			chipselect = 0; write = 0;
+		end
+	endtask
+
+	// Single cycle address phase after the wait states: the readdata is checked before its edge (combinational slave),
+	// then after each edge
+	// Consecutive reads expect different values, a stale readdata does not match
+	task busRead(input [ADDRESS_WIDTH-1:0] a, input [DATA_WIDTH-1:0] expected);
+		begin
+			@ (negedge clock);
+			address = a; chipselect = 1; read = 1;
+			#1 while (waitrequest) @ (negedge clock);
+			latency = 0;
+			#3;
+			if (readdata !== expected) begin
+				@ (negedge clock);
+				latency = 1;
+			end
+			chipselect = 0; read = 0; address = 0;
+			while ((readdata !== expected) && (latency < LATENCY_MAX)) begin
+				@ (negedge clock);
+				latency = latency + 1;
+			end
+			if (readdata !== expected) begin
+				$display("FAIL - read 0x%h: 0x%h, expected 0x%h", a, readdata, expected);
+				errors = errors + 1;
+			end
+			else begin
+				$display("read 0x%h: 0x%h, latency: %0d cycles", a, readdata, latency);
+				if (latency > worst) worst = latency;
+			end
+		end
+	endtask
+
+	//----------------------------------
+	// Stimulus
+	//----------------------------------
+	initial begin
+		for (i=0; i<(1 << RAM_ADDRESS_WIDTH); i=i+1) ram[i] = 0;
+		repeat (4) @ (negedge clock);
+		reset = 0;
+		busWrite(MM_MODE, 1);
+		busWrite(MM_OFFSET_ISR, 'h5a);
+		busWrite(MM_RAM_FIELD, 'hcafe0001);
+		busRead(MM_READY, 1);
+		busRead(MM_OFFSET_ISR, 'h5a);
+		busRead(MM_MODE, 1);
+		busRead(MM_RAM_FIELD, 'hcafe0001);
+		busWrite(MM_FILL_RANGE, ((MM_REGISTER_BASE - 1) << 16) | (MM_RAM_FIELD & ~'h7));	// Record 5 - last record
+		busWrite(MM_FILL, 'hcafe0002);
+		busRead(MM_RAM_FIELD, 'hcafe0002);															// Held until the fill is done
+		busWriteProbe(MM_OFFSET_ISR, 'h33, PROBE_TASK_ID, 'h105);									// Both writes are kept
+		busRead(MM_OFFSET_ISR, 'h33);
+		busRead(MM_TASK_ID, 'h105);
+		// Task 2 preempts task 1, a task 12 start probe arrives at the cycle that resumes task 1
+		busWrite(MM_MODE, 0);
+		busWrite(MM_TASK_ID, 0);
+		busWrite(MM_START, 1);
+		busWrite(MM_TASK_ID, 'h101);
+		busWrite(MM_TASK_ID, 'h102);
+		busWrite(MM_TASK_ID, 'h002);
+		latency = 0;
+		while (!dut.taskResume && (latency < (LATENCY_MAX << 2))) begin
+			@ (negedge clock);
+			latency = latency + 1;
+		end
+		probeValid = 1; probeSelect = PROBE_TASK_ID; probeData = 'h10c;
+		@ (negedge clock);
+		probeValid = 0;
+		busRead(MM_TASK_ID, 'h10c);																		// The probe is kept
+		busRead(MM_PREEMPT, 1);																			// Task 12 preempts the resumed task 1
+		$display("read latency: %0d cycles, %0d errors", worst, errors);
+		$finish;
+	end
+
+endmodule
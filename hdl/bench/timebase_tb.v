@@ -0,0 +1,136 @@
+//=================================================================================================
+// Measurement Time Base: Clock Crossing Bench
+// 	@Brief:
+//		  - timebase.v at MEASURE_CLOCK = 1, the measurement clock has a random period (2.5-10 ns)
+//			 and a random phase against the 20 ns bus clock, e.g. vvp timebase_tb +seed=7
+//		  - Checks at every measurement edge: a single Gray bit changes
+//		  - Checks at every bus edge: the count is monotonic and advances by the clock ratio (+-1 cycle),
+//			 it restarts from 0 at the clear and holds while disabled
+//		  - Checks at the end: the counted cycles match the elapsed time within the crossing latency
+//		@Run:
+//			 iverilog -o timebase_tb bench/timebase_tb.v timebase.v counter.v && vvp timebase_tb +seed=1
+//=================================================================================================
+
+`timescale 1ps / 1ps
+
+module timebase_tb;
+
+	localparam
+		COUNTER_SIZE		= 40,
+		BUS_PERIOD			= 20000,
+		BUS_CYCLES			= 20000;
+
+	//----------------------------------
+	// Signal declaration
+	//----------------------------------
+	reg clock = 0, measureClock = 0, reset = 1, clear = 0, enable = 0;
+	wire [COUNTER_SIZE-1:0] counter;
+	reg [COUNTER_SIZE-1:0] lastCounter, lastGray, holdCounter;
+	integer seed = 1, measurePeriod, measurePhase, stepMin, stepMax, errors = 0, cycles = 0, i;
+	real expected;
+
+	//----------------------------------
+	// Device under test
+	//----------------------------------
+	timebase #(.COUNTER_SIZE(COUNTER_SIZE), .MEASURE_CLOCK(1)) dut
+	(
+		.clock_i(clock),
+		.measureClock_i(measureClock),
+		.reset_i(reset),
+		.clear_i(clear),
+		.enable_i(enable),
+		.preload_i({COUNTER_SIZE{1'b0}}),
+		.counterOut_o(counter)
+	);
+
+	//----------------------------------
+	// Clocks: random ratio and phase
+	//----------------------------------
+	initial begin
+		if (!$value$plusargs("seed=%d", seed)) seed = 1;
+		measurePeriod = 2 * (1250 + ({$random(seed)} % 3750));					// Even: two equal half periods
+		measurePhase = {$random(seed)} % measurePeriod;
+		stepMin = BUS_PERIOD / measurePeriod - 1;
+		stepMax = (BUS_PERIOD + measurePeriod - 1) / measurePeriod + 1;
+		$display("seed %0d: measurement clock %0d ps, phase %0d ps", seed, measurePeriod, measurePhase);
+		#(measurePhase);
+		forever #(measurePeriod / 2) measureClock = ~measureClock;
+	end
+
+	always #(BUS_PERIOD / 2) clock = ~clock;
+
+	//----------------------------------
+	// Checkers
+	//----------------------------------
+	function integer bitsSet(input [COUNTER_SIZE-1:0] data);
+		integer b;
+		begin
+			bitsSet = 0;
+			for (b=0; b<COUNTER_SIZE; b=b+1) bitsSet = bitsSet + data[b];
+		end
+	endfunction
+
+	// Gray code crossing: one bit per measurement edge
+	always @ (posedge measureClock) begin
+		#1;
+		if (!reset && (bitsSet(dut.measure_clock.grayReg ^ lastGray) > 1)) begin
+			$display("FAIL - Gray code step %h -> %h", lastGray, dut.measure_clock.grayReg);
+			errors = errors + 1;
+		end
+		lastGray = dut.measure_clock.grayReg;
+	end
+
+	// Bus domain count: monotonic, advances by the ratio while enabled
+	always @ (posedge clock) begin
+		#1;
+		if (enable && !clear && (lastCounter != 0)) begin
+			if ((counter < lastCounter) || (counter - lastCounter < stepMin) || (counter - lastCounter > stepMax)) begin
+				$display("FAIL - count step %0d -> %0d (%0d-%0d)", lastCounter, counter, stepMin, stepMax);
+				errors = errors + 1;
+			end
+		end
+		lastCounter = counter;
+	end
+
+	//----------------------------------
+	// Stimulus
+	//----------------------------------
+	initial begin
+		lastGray = 0;
+		lastCounter = 0;
+		repeat (4) @ (negedge clock);
+		reset = 0;
+		for (i=0; i<2; i=i+1) begin
+			repeat (8) @ (negedge clock);
+			// Measurement start: clear and count
+			clear = 1;
+			@ (negedge clock);
+			clear = 0;
+			enable = 1;
+			if (counter != 0) begin
+				$display("FAIL - count %0d after the clear", counter);
+				errors = errors + 1;
+			end
+			repeat (BUS_CYCLES) @ (negedge clock);
+			cycles = cycles + BUS_CYCLES;
+			expected = (1.0 * BUS_CYCLES * BUS_PERIOD) / measurePeriod;
+			if ((counter < expected - 4) || (counter > expected + 4)) begin
+				$display("FAIL - %0d cycles counted, %0.1f expected", counter, expected);
+				errors = errors + 1;
+			end
+			// Measurement stop: the count holds
+			enable = 0;
+			@ (negedge clock);
+			holdCounter = counter;
+			repeat (16) @ (negedge clock);
+			if (counter != holdCounter) begin
+				$display("FAIL - count %0d changed while disabled", counter);
+				errors = errors + 1;
+			end
+			lastCounter = 0;
+		end
+		$display("%0d bus cycles, %0d errors -> %s", cycles, errors, (errors == 0) ? "PASS" : "FAIL");
+		$finish;
+	end
+
+endmodule
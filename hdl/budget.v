@@ -0,0 +1,125 @@
+//=====================================
+// Task budget table and overrun counters
+//=====================================
+
+/*** @Brief: ***
+* Holds a cycle budget and an overrun counter per task record address (true dual-port memories)
+*   - Port A follows the running task: its budget is presented to ept.v one cycle after the address,
+*     an overrun tick of ept.v increments the counter of the running task (saturated)
+*   - Port B is the CPU access at index_i: write the budget (0: no budget) or the counter,
+*     budgetData_o and overrunsData_o show the entry one cycle after the index
+*   - The first overrun after clear_i or firstClear_i is captured with its task and counter value
+****************/
+
+/*** Instantiation ***
+	budget #(.DATA_WIDTH(DATA_WIDTH), .COUNTER_SIZE(COUNTER_SIZE), .RAM_SIZE(RAM_SIZE)) budget1
+	(
+		// Clock-reset
+		.clock_i(clock),
+		.reset_i(reset),
+		// Control signals
+		.clear_i(start),						// Measurement start: the first overrun is armed
+		.firstClear_i(clear),					// The first overrun is armed again
+		// Running task
+		.taskAddress_i(RAM_SIZE),
+		.budget_o(DATA_WIDTH),					// Budget of the task address at the previous cycle
+		.overrunTick_i(tick),					// The running task exceeded its budget
+		.counter_i(COUNTER_SIZE),
+		// CPU access
+		.index_i(RAM_SIZE),
+		.budgetWrite_i(),
+		.overrunsWrite_i(),
+		.writeData_i(DATA_WIDTH),
+		.budgetData_o(DATA_WIDTH),
+		.overrunsData_o(DATA_WIDTH),
+		// First overrun
+		.firstValid_o(),
+		.firstAddress_o(RAM_SIZE),
+		.firstTime_o(COUNTER_SIZE)
+	);
+*/
+
+module budget
+#(
+	parameter
+		DATA_WIDTH		= 32,
+		COUNTER_SIZE	= 40,
+		RAM_SIZE			= 7										// Address width of a result bank
+)
+(
+	// Clock-reset
+	input wire 								clock_i,
+	input wire 								reset_i,
+	// Control signals
+	input wire 								clear_i,
+	input wire 								firstClear_i,
+	// Running task
+	input wire [RAM_SIZE-1:0]			taskAddress_i,
+	output reg [DATA_WIDTH-1:0]		budget_o,
+	input wire 								overrunTick_i,
+	input wire [COUNTER_SIZE-1:0]		counter_i,
+	// CPU access
+	input wire [RAM_SIZE-1:0]			index_i,
+	input wire 								budgetWrite_i,
+	input wire 								overrunsWrite_i,
+	input wire [DATA_WIDTH-1:0]		writeData_i,
+	output reg [DATA_WIDTH-1:0]		budgetData_o,
+	output reg [DATA_WIDTH-1:0]		overrunsData_o,
+	// First overrun
+	output reg 								firstValid_o,
+	output reg [RAM_SIZE-1:0]			firstAddress_o,
+	output reg [COUNTER_SIZE-1:0]		firstTime_o
+);
+
+	localparam [DATA_WIDTH-1:0] COUNT_MAX = ~('b0);
+
+	// Signal declaration
+	reg [DATA_WIDTH-1:0] budgetRam [0:(1<<RAM_SIZE)-1];
+	reg [DATA_WIDTH-1:0] overrunRam [0:(1<<RAM_SIZE)-1];
+	reg [DATA_WIDTH-1:0] overrunsReg;
+	wire [DATA_WIDTH-1:0] overrunsNext;
+
+	// Port A: the running task, its counter was read with the budget
+	always @ (posedge clock_i) begin
+		if (overrunTick_i) begin
+			overrunRam[taskAddress_i]	<= overrunsNext;
+		end
+		budget_o								<= budgetRam[taskAddress_i];
+		overrunsReg							<= overrunRam[taskAddress_i];
+	end
+
+	// Port B: CPU access
+	always @ (posedge clock_i) begin
+		if (budgetWrite_i) begin
+			budgetRam[index_i]			<= writeData_i;
+		end
+		if (overrunsWrite_i) begin
+			overrunRam[index_i]			<= writeData_i;
+		end
+		budgetData_o						<= budgetRam[index_i];
+		overrunsData_o						<= overrunRam[index_i];
+	end
+
+	// First overrun capture
+	always @ (posedge clock_i, posedge reset_i) begin
+		if (reset_i) begin
+			firstValid_o					<= 0;
+			firstAddress_o					<= 0;
+			firstTime_o						<= 0;
+		end
+		else begin
+			if (clear_i | firstClear_i) begin
+				firstValid_o				<= 1'b0;
+			end
+			else if (overrunTick_i & ~firstValid_o) begin
+				firstValid_o				<= 1'b1;
+				firstAddress_o				<= taskAddress_i;
+				firstTime_o					<= counter_i;
+			end
+		end
+	end
+
+	// Control logic
+	assign overrunsNext					= (overrunsReg == COUNT_MAX) ? COUNT_MAX : overrunsReg + 1'b1;		// Saturated
+
+endmodule
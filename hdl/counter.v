@@ -3,7 +3,7 @@
 //===============================
 
 /*** @Brief: ***
-* Simple N-bit counter cycle solution with Enable and Reset features
+* Simple N-bit counter cycle solution with Enable, Load and Reset features
 ****************/
 
 /*** Instantiation ***
@@ -14,6 +14,8 @@
 		.reset_i(reset),
 		// Control signals
 		.enable_i(enable),
+		.load_i(load),						// Synchronous load, overrides the enable
+		.loadData_i(COUNTER_SIZE),
 		// Output(s)	
 		.counterOut_o(COUNTER_SIZE)		// Get actual counter's transparent value output
 	);
@@ -30,6 +32,8 @@ module counter
 	input wire 								reset_i,
 	// Control signals	
 	input wire 								enable_i,
+	input wire 								load_i,
+	input wire	[COUNTER_SIZE-1:0]	loadData_i,
 	// Output(s)	
 	output wire	[COUNTER_SIZE-1:0]	counterOut_o		// Get actual counter's transparent value output
 );
@@ -42,6 +46,9 @@ module counter
 		if (reset_i) begin
 			counterReg <= 0;
 		end
+		else if (load_i) begin
+			counterReg <= loadData_i;
+		end
 		else if (enable_i) begin
 			counterReg <= counterReg + 1;
 		end
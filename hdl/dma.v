@@ -0,0 +1,188 @@
+//=====================================
+// Result readout DMA (Avalon MM master)
+//=====================================
+
+/*** @Brief: ***
+* Copies the frozen result bank or the stored trace records into system memory, the CPU is not involved
+* Destination layout: word 0 completion {Sequence[31:16], Words[15:0]}, then the copied words from word 1
+*   - Records: read on the frozen bank port, each record is cleared (written to 0) after it is read,
+*     the words follow the on-chip RAM layout (record address * 2^RECORD_SIZE + field)
+*   - Trace: the records stored at the start are popped in order, the buffer keeps filling meanwhile
+*   - The completion word is written last: a new sequence number marks a complete copy
+****************/
+
+/*** Instantiation ***
+	dma #(.DATA_WIDTH(DATA_WIDTH), .RAM_SIZE(RAM_SIZE), .RECORD_SIZE(RECORD_SIZE), .TRACE_SIZE(TRACE_SIZE)) dma1
+	(
+		// Clock-reset
+		.clock_i(clock),
+		.reset_i(reset),
+		// Control signals
+		.start_i(start),						// Ignored while busy
+		.traceSource_i(traceSource),			// 0: records of the frozen bank, 1: trace buffer
+		.baseAddress_i(DATA_WIDTH),			// Destination byte address
+		// Frozen record bank
+		.ramAddress_o(RAM_SIZE),
+		.ramReadData_i(RECORD_WIDTH),			// Registered RAM output
+		.ramClear_o(),							// Write 0 to the whole record at ramAddress_o
+		// Trace buffer
+		.traceReadData_i(DATA_WIDTH),
+		.traceLevel_i(TRACE_SIZE + 1),
+		.tracePop_o(),
+		// Avalon MM master (write only)
+		.masterAddress_o(DATA_WIDTH),
+		.masterWrite_o(),
+		.masterWriteData_o(DATA_WIDTH),
+		.masterWaitRequest_i(waitrequest),
+		// Status output
+		.busy_o(),
+		.doneTick_o()							// The completion word is written
+	);
+*/
+
+module dma
+#(
+	parameter
+		DATA_WIDTH		= 32,
+		RAM_SIZE			= 7,										// Address width of a result bank
+		RECORD_SIZE		= 3,										// Number of DATA_WIDTH fields in a task record: 2^RECORD_SIZE
+		TRACE_SIZE		= 9,
+		RECORD_WIDTH	= DATA_WIDTH << RECORD_SIZE
+)
+(
+	// Clock-reset
+	input wire 								clock_i,
+	input wire 								reset_i,
+	// Control signals
+	input wire 								start_i,
+	input wire 								traceSource_i,
+	input wire [DATA_WIDTH-1:0]		baseAddress_i,
+	// Frozen record bank
+	output wire [RAM_SIZE-1:0]			ramAddress_o,
+	input wire [RECORD_WIDTH-1:0]		ramReadData_i,
+	output wire 							ramClear_o,
+	// Trace buffer
+	input wire [DATA_WIDTH-1:0]		traceReadData_i,
+	input wire [TRACE_SIZE:0]			traceLevel_i,
+	output wire 							tracePop_o,
+	// Avalon MM master
+	output wire [DATA_WIDTH-1:0]		masterAddress_o,
+	output wire 							masterWrite_o,
+	output wire [DATA_WIDTH-1:0]		masterWriteData_o,
+	input wire 								masterWaitRequest_i,
+	// Status output
+	output wire 							busy_o,
+	output wire 							doneTick_o
+);
+
+	// State Definitions
+	localparam [2:0]
+		STATE_IDLE		= 3'd0,
+		STATE_READ		= 3'd1,						// Record address is presented to the RAM
+		STATE_LATCH		= 3'd2,						// Record is latched and cleared
+		STATE_RECORD	= 3'd3,						// Fields of the latched record are written
+		STATE_TRACE		= 3'd4,						// Trace records are written and popped
+		STATE_COMPLETE	= 3'd5;						// Completion word is written
+	localparam
+		WORD_BYTES		= DATA_WIDTH / 8,
+		COUNT_SIZE		= DATA_WIDTH / 2;
+
+	// Signal declaration
+	reg [2:0] stateReg;
+	reg [DATA_WIDTH-1:0] baseReg, addressReg;
+	reg [RAM_SIZE-1:0] recordAddressReg;
+	reg [RECORD_SIZE-1:0] fieldReg;
+	reg [RECORD_WIDTH-1:0] recordReg;
+	reg [TRACE_SIZE:0] wordsReg;
+	reg [COUNT_SIZE-1:0] countReg, sequenceReg;
+	wire accept;
+
+	always @ (posedge clock_i, posedge reset_i) begin
+		if (reset_i) begin
+			stateReg						<= STATE_IDLE;
+			baseReg						<= 0;
+			addressReg					<= 0;
+			recordAddressReg			<= 0;
+			fieldReg						<= 0;
+			recordReg					<= 0;
+			wordsReg						<= 0;
+			countReg						<= 0;
+			sequenceReg					<= 0;
+		end
+		else begin
+			case (stateReg)
+				STATE_IDLE: begin
+					if (start_i) begin
+						baseReg				<= baseAddress_i;
+						addressReg			<= baseAddress_i + WORD_BYTES;
+						recordAddressReg	<= 0;
+						fieldReg				<= 0;
+						wordsReg				<= traceLevel_i;
+						countReg				<= 0;
+						if (~traceSource_i) begin
+							stateReg			<= STATE_READ;
+						end
+						else if (traceLevel_i != 0) begin
+							stateReg			<= STATE_TRACE;
+						end
+						else begin
+							stateReg			<= STATE_COMPLETE;
+						end
+					end
+				end
+				STATE_READ: begin
+					stateReg					<= STATE_LATCH;
+				end
+				STATE_LATCH: begin
+					recordReg				<= ramReadData_i;
+					stateReg					<= STATE_RECORD;
+				end
+				STATE_RECORD: begin
+					if (accept) begin
+						addressReg			<= addressReg + WORD_BYTES;
+						countReg				<= countReg + 1'b1;
+						fieldReg				<= fieldReg + 1'b1;
+						if (&fieldReg) begin
+							recordAddressReg	<= recordAddressReg + 1'b1;
+							stateReg			<= (&recordAddressReg) ? STATE_COMPLETE : STATE_READ;
+						end
+					end
+				end
+				STATE_TRACE: begin
+					if (accept) begin
+						addressReg			<= addressReg + WORD_BYTES;
+						countReg				<= countReg + 1'b1;
+						wordsReg				<= wordsReg - 1'b1;
+						if (wordsReg == 1) begin
+							stateReg			<= STATE_COMPLETE;
+						end
+					end
+				end
+				STATE_COMPLETE: begin
+					if (accept) begin
+						sequenceReg			<= sequenceReg + 1'b1;
+						stateReg				<= STATE_IDLE;
+					end
+				end
+				default: begin
+					stateReg					<= STATE_IDLE;
+				end
+			endcase
+		end
+	end
+
+	// Control logic
+	assign accept					= masterWrite_o & ~masterWaitRequest_i;
+
+	// Output assignment
+	assign ramAddress_o			= recordAddressReg;
+	assign ramClear_o				= (stateReg == STATE_LATCH);										// The read record is on the RAM output
+	assign tracePop_o				= (stateReg == STATE_TRACE) & accept;
+	assign masterAddress_o		= (stateReg == STATE_COMPLETE) ? baseReg : addressReg;
+	assign masterWrite_o			= (stateReg == STATE_RECORD) | (stateReg == STATE_TRACE) | (stateReg == STATE_COMPLETE);
+	assign masterWriteData_o	= (stateReg == STATE_RECORD) ? recordReg[fieldReg*DATA_WIDTH +: DATA_WIDTH] :
+										  (stateReg == STATE_TRACE) ? traceReadData_i : {sequenceReg + 1'b1, countReg};
+	assign busy_o					= (stateReg != STATE_IDLE);
+	assign doneTick_o				= (stateReg == STATE_COMPLETE) & accept;
+
+endmodule
@@ -2,11 +2,25 @@
 // Execution Performance Tester Version 0.0
 // 	@Brief:
 //		  - NIOSii/e based (non-vectored IR, no chache and branch prediction)
-//		  - No multitask measurement support
+//		  - Preemption stack (PREEMPT_DEPTH > 0): a task started while another one runs suspends it, the suspended
+//			 task resumes with its part-time at the stop of the preempting one -> exclusive time per task
+//		  - Nested regions: the inclusive time (own and nested cycles) and the parent region are stored in the record
+//		  - Budget watchdog: the running elapsed time of the task is compared against its budget (budget_i) at every
+//			 cycle, the first excess of an invocation is an overrun tick (a resumed task keeps its overrun state)
+//		  - Sampling snapshot: the record address of the running task or of the current exception phase
 //		  - Detects task execution
 //      - Measures exception handling timings: IR latency, context saving, ISR handling, context restoring
+//		  - Per-task statistic records: 64 bit summarized cycles, invocation count, minimum and maximum,
+//			 64 bit inclusive cycles and the parent link {Valid, Multiple parents, Parent ID}
+//		  - Trace mode: every detected event as a delta timestamped record for the trace ring buffer
+//		  - Task switch: a single probe closes the running task and opens the next one at the same cycle
+//		  - Separate I/O offset compensation for tasks and for each exception timing parameter
+//		  - Pipelined record update (read -> summarize -> store): one event per clock, same-record updates are forwarded
+//		  - Lost event counter: edges merged into a capture register that still holds an unprocessed event
+//		  - Optional measurement clock (MEASURE_CLOCK = 1): the cycle counter runs on measureClock_i and crosses in Gray code
+//		  - Accumulator warning: a stored record whose Sum or Count crossed half of its range
 //		@Operation Modes:
-//		  - Basic 40 bit cycle counter with reset feature
+//		  - Basic 40 bit cycle counter with reset and preload features
 //=================================================================================================
 
 /*** Instantiation ***
@@ -16,32 +30,66 @@ ept
 	.DATA_WIDTH(32),
 	.RAM_SIZE(7),									
 	.TASK_ID_SIZE(RAM_SIZE + 1),
-	.OFFSET_SIZE(8)
+	.OFFSET_SIZE(8),
+	.RECORD_SIZE(3),
+	.RECORD_WIDTH(DATA_WIDTH << RECORD_SIZE),
+	.MEASURE_CLOCK(0),
+	.PREEMPT_DEPTH(4)
 )
 ept1
 (
 	// Clock-reset
 	.clock_i(),
+	.measureClock_i(),						// Counter clock at MEASURE_CLOCK = 1
 	.reset_i(),
 	// RAM Interfacing
-	.ramAddress_o(RAM_SIZE),
-	.ramWriteData_o(DATA_WIDTH),
-	.ramReadData_i(DATA_WIDTH),
+	.ramAddress_o(RAM_SIZE),				// Read address
+	.ramWriteAddress_o(RAM_SIZE),
+	.ramWriteData_o(RECORD_WIDTH),
+	.ramReadData_i(RECORD_WIDTH),
 	.ramWrite_o(),
 	.ramRead_o(),
+	.ramBusy_o(),							// Record read-modify-write in progress
 	// Control input
 	.start_i(),
 	.stop_i(),
 	.taskID_i(TASK_ID_SIZE),				// Storing the actual task ID -> MSB is the current task activity
+	.taskSwitch_i(),							// Pulse: the running task is stopped, taskID_i is started
 	.offset_i(OFFSET_SIZE),				// Offset duration of a control write operation
+	.offsetIrLatency_i(OFFSET_SIZE),		// Offset of the IRQ edge to Context Save probe
+	.offsetContextSave_i(OFFSET_SIZE),	// Offset of the Context Save probe pair
+	.offsetIsr_i(OFFSET_SIZE),				// Offset of the ISR probe pair
+	.offsetContextRestore_i(OFFSET_SIZE),	// Offset of the Context Restore probe pair
 	.irqAssert_i(),							// Posedge triggering at start
 	.isrHandling_i(),							// Posedge triggering at start()(), negedge at stop
 	.contextSave_i(),  						// Posedge triggering at start()(), negedge at stop
 	.contextRestore_i(),						// Posedge triggering at start()(), negedge at stop
+	.traceEnable_i(),							// Record the detected events
+	.lostClear_i(),							// Clear the lost event counter
+	.preemptClear_i(),						// Clear the preemption overflow flag
+	.counterPreload_i(COUNTER_SIZE),		// Counter value at the start
+	.budget_i(DATA_WIDTH),					// Budget of taskAddress_o at the previous cycle, 0: no budget
 	// Data I/O
 	.counterData_o(COUNTER_SIZE),
+	.lostEvents_o(DATA_WIDTH),				// Number of lost events since the start
+	.accumulatorWarn_o(),					// Pulse: the stored Sum or Count reached half of its range
+	.recordUpdate_o(),						// Pulse: a record is summarized (histogram input)
+	.recordAddress_o(RAM_SIZE),
+	.recordElapsed_o(DATA_WIDTH),			// Saturated elapsed cycles of the update
+	.taskResume_o(),							// Pulse: the suspended task taskResumeID_o runs again
+	.taskResumeID_o(RAM_SIZE),
+	.taskAddress_o(RAM_SIZE),				// RAM address of the running task
+	.overrunTick_o(),						// Pulse: the running task exceeded its budget
+	.sampleRun_o(),							// Measurement in progress
+	.sampleActive_o(),						// A task or an exception runs
+	.sampleAddress_o(RAM_SIZE),				// Record address of the running task or exception phase
+	.eventTick_o(),							// A detected event while measuring
+	.preemptLevel_o(5),						// Suspended tasks on the preemption stack
+	.preemptOverflow_o(),					// A preempted task was not suspended: the stack was full
+	.traceWrite_o(),
+	.traceData_o(DATA_WIDTH),
 	// Status output
-	.ready_o(),
+	.ready_o(),
 	.doneTick_o()
 );
 */
@@ -53,29 +101,63 @@ module ept
 		DATA_WIDTH 			= 32,
 		RAM_SIZE				= 7,									
 		TASK_ID_SIZE		= RAM_SIZE + 1,
-		OFFSET_SIZE			= 8
+		OFFSET_SIZE			= 8,
+		RECORD_SIZE			= 3,									// Number of DATA_WIDTH fields in a task record: 2^RECORD_SIZE
+		RECORD_WIDTH		= DATA_WIDTH << RECORD_SIZE,
+		MEASURE_CLOCK		= 0,									// 0: count clock_i cycles, 1: count measureClock_i cycles
+		PREEMPT_DEPTH		= 4									// Preemption stack depth (0-16), 0: a task start while a task runs is ignored
 )
 (
 	// Clock-reset
 	input wire 								clock_i,
+	input wire 								measureClock_i,		// Dedicated counter clock, e.g. a faster PLL output
 	input wire 								reset_i,
 	// RAM Interfacing
-	output wire [RAM_SIZE-1:0] 		ramAddress_o,
-	output wire [DATA_WIDTH-1:0] 		ramWriteData_o,
-	input wire [DATA_WIDTH-1:0] 		ramReadData_i,
+	output wire [RAM_SIZE-1:0] 		ramAddress_o,			// Read address of the record update
+	output wire [RAM_SIZE-1:0] 		ramWriteAddress_o,
+	output wire [RECORD_WIDTH-1:0] 	ramWriteData_o,
+	input wire [RECORD_WIDTH-1:0] 	ramReadData_i,
 	output wire								ramWrite_o,
 	output wire								ramRead_o,
+	output wire								ramBusy_o,				// Record read-modify-write in progress: from the read address to the store
 	// Control input
 	input wire 								start_i,
 	input wire 								stop_i,
 	input wire [TASK_ID_SIZE-1:0]		taskID_i,				// Storing the actual task ID -> MSB is the current task activity
+	input wire 								taskSwitch_i,			// Pulse: the running task is stopped, taskID_i is started
 	input wire [OFFSET_SIZE-1:0]		offset_i,				// Offset duration of a control write operation
+	input wire [OFFSET_SIZE-1:0]		offsetIrLatency_i,	// Offset of the IRQ edge to Context Save probe
+	input wire [OFFSET_SIZE-1:0]		offsetContextSave_i,	// Offset of the Context Save probe pair
+	input wire [OFFSET_SIZE-1:0]		offsetIsr_i,			// Offset of the ISR probe pair
+	input wire [OFFSET_SIZE-1:0]		offsetContextRestore_i,	// Offset of the Context Restore probe pair
 	input wire 								irqAssert_i,			// Posedge triggering at start
 	input wire 								isrHandling_i,			// Posedge triggering at start(), negedge at stop
 	input wire 								contextSave_i,  		// Posedge triggering at start(), negedge at stop
 	input wire 								contextRestore_i,		// Posedge triggering at start(), negedge at stop
+	input wire 								traceEnable_i,			// Record the detected events
+	input wire 								lostClear_i,			// Clear the lost event counter
+	input wire 								preemptClear_i,		// Clear the preemption overflow flag
+	input wire [COUNTER_SIZE-1:0]		counterPreload_i,		// Counter value at the start, e.g. below a wrap boundary
+	input wire [DATA_WIDTH-1:0]		budget_i,				// Budget of taskAddress_o at the previous cycle in counter cycles, 0: off
 	// Data I/O
 	output wire [COUNTER_SIZE-1:0]	counterData_o,
+	output reg [DATA_WIDTH-1:0]		lostEvents_o,			// Saturating number of lost events
+	output wire								accumulatorWarn_o,	// Pulse at the store: Sum or Count reached half of its range
+	output wire								recordUpdate_o,		// Pulse at the summarize stage: the record and its elapsed cycles
+	output wire [RAM_SIZE-1:0]			recordAddress_o,
+	output wire [DATA_WIDTH-1:0]		recordElapsed_o,
+	output reg 								taskResume_o,			// Pulse: the suspended task runs again, the Task ID register follows it
+	output wire [RAM_SIZE-1:0]			taskResumeID_o,
+	output wire [RAM_SIZE-1:0]			taskAddress_o,			// RAM address of the running task
+	output wire								overrunTick_o,			// Pulse: the running task exceeded its budget, once per invocation
+	output wire								sampleRun_o,			// Measurement in progress: the activity can be sampled
+	output wire								sampleActive_o,		// A task or an exception runs, else idle
+	output wire [RAM_SIZE-1:0]			sampleAddress_o,		// Record address of the running task or exception phase
+	output wire								eventTick_o,			// A detected event (trace record type) while measuring
+	output wire [4:0]						preemptLevel_o,		// Suspended tasks
+	output reg 								preemptOverflow_o,	// Sticky: a preempted task was dropped at the full stack
+	output reg 								traceWrite_o,			// Trace record is valid
+	output reg [DATA_WIDTH-1:0]		traceData_o,			// Trace record
 	// Status output
 	output reg 								ready_o,
 	output reg								doneTick_o
@@ -86,6 +168,44 @@ module ept
 	//---------------------------------
 	// Basic definitions
 	localparam COUNTER_ZEROS = {(COUNTER_SIZE-DATA_WIDTH){1'b0}};
+	localparam [DATA_WIDTH-1:0] DATA_MAX = ~('b0);
+	
+	// Task record fields, RECORD_SUM is stored at the lowest two words (LO, HI)
+	localparam
+		RECORD_SUM					= 0,														// Summarized cycles
+		RECORD_COUNT				= 2,														// Number of invocations
+		RECORD_MIN					= 3,														// Shortest invocation
+		RECORD_MAX					= 4,														// Longest invocation
+		RECORD_INCLUSIVE			= 5,														// Summarized cycles with the nested regions (LO, HI)
+		RECORD_PARENT				= 7;														// Parent link of the last invocation
+	localparam SUM_WIDTH = 2 * DATA_WIDTH;
+	localparam SUM_ZEROS = {(SUM_WIDTH-COUNTER_SIZE){1'b0}};
+	
+	// Trace records: {Type, Task ID, Delta} -> Delta is the distance from the previous record's timestamp
+	// 					{TRACE_EXTENSION, Delta >> TRACE_DELTA_SIZE} -> Precedes a record whose Delta does not fit
+	localparam
+		TRACE_TYPE_SIZE			= 4,
+		TRACE_ID_SIZE				= TASK_ID_SIZE - 1,
+		TRACE_DELTA_SIZE			= DATA_WIDTH - TRACE_TYPE_SIZE - TRACE_ID_SIZE,
+		TRACE_EVENTS				= 10;
+	localparam [TRACE_TYPE_SIZE-1:0]
+		TRACE_TASK_START			= 4'h0,
+		TRACE_TASK_STOP			= 4'h1,
+		TRACE_IRQ					= 4'h2,
+		TRACE_CTX_SAVE_START		= 4'h3,
+		TRACE_CTX_SAVE_STOP		= 4'h4,
+		TRACE_ISR_START			= 4'h5,
+		TRACE_ISR_STOP				= 4'h6,
+		TRACE_CTX_RESTORE_START	= 4'h7,
+		TRACE_CTX_RESTORE_STOP	= 4'h8,
+		TRACE_TASK_SWITCH			= 4'h9,
+		TRACE_EXTENSION			= 4'hf;
+	
+	// Preemption stack: {RAM address, part-time, nested time, parent link} of the suspended tasks
+	localparam PREEMPT_ENTRIES = (PREEMPT_DEPTH > 0) ? PREEMPT_DEPTH : 1;
+	
+	// Capture control registers watched by the lost event counter
+	localparam LOST_EVENTS = 9;
 	
 	// RAM allocation for STATE_EXCEPTION handling timing parameters: IR Latency, Context Save, ISR Handling, Context Restore
 	localparam RESERVED_PARAMETER_SIZE = 4;												
@@ -93,15 +213,13 @@ module ept
 		RAM_ADDRESS_MAX 			= ~('b0),															// The maximum addressable RAM
 		RAM_ADDRESS_RESERVED		= RAM_ADDRESS_MAX - RESERVED_PARAMETER_SIZE + 1;		// The last addresses is reserved for IRQ latency
 	
-	// FSM State Definitions
+	// FSM State Definitions: the record updates run in the pipeline, the FSM handles an event at each cycle
 	localparam FSM_SIZE = 3;
 	localparam [FSM_SIZE-1:0]
 		STATE_IDLE 							= 3'b000,
 		STATE_WATCH							= 3'b001,
 		STATE_EXCEPTION 					= 3'b010,
-		STATE_SUMMARIZE					= 3'b011,
-		STATE_DONE							= 3'b100,
-		STATE_STORE							= 3'b101;
+		STATE_DONE							= 3'b100;
 		
 	//-----------------------
 	// Signal declaration
@@ -110,20 +228,70 @@ module ept
 	// Basic registers
 	reg [FSM_SIZE-1:0] stateReg, stateNextReg;
 	reg [TASK_ID_SIZE-1:0] taskIDReg, taskIDNextReg;
-	reg [RAM_SIZE-1:0] ramAddressReg, ramAddressNextReg, taskAddressReg;
+	reg [RAM_SIZE-1:0] ramAddressReg, ramAddressNextReg, taskAddressReg, stopAddressReg;
 	// Counter interfacing
-	wire counterEnable, counterReset;
+	wire counterEnable;
 	reg counterResetReg;
 	// Measurement Timings
-	reg [COUNTER_SIZE-1:0] startTimestampReg, startTimestampNextReg, taskPartTimeReg, taskPartTimeNextReg, elapsedReg, elapsedNextReg, elapsedSumReg, elapsedSumNextReg;
+	reg [COUNTER_SIZE-1:0] startTimestampReg, startTimestampNextReg, taskPartTimeReg, taskPartTimeNextReg, elapsedReg, elapsedNextReg;
+	// Record update pipeline: read (FSM) -> summarize -> store, the last two stored records are forwarded
+	reg summarizeReg, summarizeNextReg, storeReg, forwardReg, accumulatorWarnReg, accumulatorWarnNextReg;
+	reg [RAM_SIZE-1:0] storeAddressReg, forwardAddressReg;
+	reg regionReg, regionNextReg;
+	reg [COUNTER_SIZE-1:0] inclusiveReg, inclusiveNextReg;
+	reg [RAM_SIZE:0] parentReg, parentNextReg;
+	reg [RECORD_WIDTH-1:0] recordReg, recordNextReg, forwardRecordReg;
+	wire [RECORD_WIDTH-1:0] recordSource;
+	wire [SUM_WIDTH-1:0] recordSum;
+	wire [DATA_WIDTH-1:0] recordCount, recordMin, recordMax, elapsedData;
+	wire [SUM_WIDTH-1:0] recordInclusive;
+	wire [DATA_WIDTH-1:0] recordParent;
 	// Measurement Timestamp Triggers
-	reg irqReg, irqNextReg, isrReg, isrNextReg, contextSaveReg, contextSaveNextReg, contextRestoreReg, contextRestoreNextReg, exceptionFlagReg, exceptionFlagNextReg;
+	reg irqReg, irqNextReg, isrReg, isrNextReg, contextSaveReg, contextSaveNextReg, contextRestoreReg, contextRestoreNextReg;
 	reg taskStartCCR, taskStartNextCCR, taskStopCCR, taskStopNextCCR;
 	reg irqStartCCR, irqStartNextCCR, isrStartCCR, isrStartNextCCR, isrStopCCR, isrStopNextCCR, contextSaveStartCCR, contextSaveStartNextCCR,
 		 contextSaveStopCCR, contextSaveStopNextCCR, contextRestoreStartCCR, contextRestoreStartNextCCR, contextRestoreStopCCR, contextRestoreStopNextCCR;
-	wire taskStartTick, taskStopTick;
+	wire taskStartTick, taskStopTick, taskSwitchTick;
 	wire irqStartTick, isrStartTick, isrStopTick, contextSaveStartTick, contextSaveStopTick, contextRestoreStartTick, contextRestoreStopTick;
 	wire taskEnableRamAddress;
+	// Preemption stack
+	reg [RAM_SIZE-1:0] preemptAddressReg [0:PREEMPT_ENTRIES-1];
+	reg [COUNTER_SIZE-1:0] preemptTimeReg [0:PREEMPT_ENTRIES-1];
+	reg [RAM_SIZE-1:0] suspendAddressReg;
+	reg [4:0] preemptLevelReg;
+	reg taskPreemptCCR, taskPreemptNextCCR, preemptPush, preemptPop, preemptDrop;
+	wire taskPreemptTick;
+	wire [RAM_SIZE-1:0] preemptTopAddress;
+	wire [COUNTER_SIZE-1:0] preemptTopTime, suspendTime;
+	// Nested regions: inclusive time of the finished nested regions and the parent link {Valid, RAM address} of the running task
+	reg [COUNTER_SIZE-1:0] preemptChildReg [0:PREEMPT_ENTRIES-1];
+	reg [RAM_SIZE:0] preemptParentReg [0:PREEMPT_ENTRIES-1];
+	reg [COUNTER_SIZE-1:0] taskChildTimeReg, taskChildTimeNextReg;
+	reg [RAM_SIZE:0] taskParentReg, taskParentNextReg;
+	reg preemptChildAdd;
+	wire [COUNTER_SIZE-1:0] preemptTopChild;
+	wire [RAM_SIZE:0] preemptTopParent;
+	// Budget watchdog: overrun state of the running invocation, a suspended task keeps its own on the stack
+	reg preemptOverrunReg [0:PREEMPT_ENTRIES-1];
+	reg taskOverrunReg, taskOverrunNextReg;
+	reg [RAM_SIZE-1:0] budgetAddressReg;
+	wire budgetWatch, preemptTopOverrun;
+	wire [COUNTER_SIZE-1:0] taskElapsed;
+	// Lost event counter
+	wire [LOST_EVENTS-1:0] lostTicks;
+	reg [3:0] lostCount;
+	wire [DATA_WIDTH:0] lostSum;
+	// Trace encoder: pending event bits are indexed by the record type
+	reg [TRACE_EVENTS-1:0] tracePendingReg, tracePendingNextReg, traceFirst;
+	reg [COUNTER_SIZE-1:0] traceTimestampReg, traceTimestampNextReg, traceLastReg, traceLastNextReg;
+	reg [TRACE_ID_SIZE-1:0] traceTaskReg, traceTaskNextReg;
+	reg traceExtensionReg, traceExtensionNextReg;
+	reg [TRACE_TYPE_SIZE-1:0] traceType;
+	wire [TRACE_EVENTS-1:0] traceTicks;
+	wire [COUNTER_SIZE-1:0] traceDelta;
+	wire [DATA_WIDTH-TRACE_TYPE_SIZE-1:0] traceExtensionData;
+	wire traceDeltaLong;
+	integer i, j;
 	
 	//-------------------------------
 	// Clock-edge synchronized DFFs
@@ -134,6 +302,7 @@ module ept
 			taskIDReg 									<= 0;
 			ramAddressReg								<= 0;
 			taskAddressReg								<= 0;
+			stopAddressReg								<= 0;
 			taskStartCCR								<= 0;
 			taskStopCCR									<= 0;
 			irqStartCCR									<= 0;
@@ -149,9 +318,32 @@ module ept
 			contextRestoreReg							<= 0;
 			startTimestampReg							<= 0;
 			taskPartTimeReg							<= 0;
-			elapsedReg									<= 0;
-			elapsedSumReg								<= 0;
-			exceptionFlagReg							<= 0;
+			elapsedReg									<= 0;
+			taskChildTimeReg							<= 0;
+			taskParentReg								<= 0;
+			taskOverrunReg								<= 0;
+			budgetAddressReg							<= 0;
+			summarizeReg								<= 0;
+			regionReg									<= 0;
+			inclusiveReg								<= 0;
+			parentReg									<= 0;
+			storeReg										<= 0;
+			storeAddressReg							<= 0;
+			recordReg									<= 0;
+			accumulatorWarnReg						<= 0;
+			forwardReg									<= 0;
+			forwardAddressReg							<= 0;
+			forwardRecordReg							<= 0;
+			lostEvents_o								<= 0;
+			tracePendingReg							<= 0;
+			traceTimestampReg							<= 0;
+			traceLastReg								<= 0;
+			traceTaskReg								<= 0;
+			traceExtensionReg							<= 0;
+			taskPreemptCCR								<= 0;
+			suspendAddressReg							<= 0;
+			preemptLevelReg							<= 0;
+			preemptOverflow_o							<= 0;
 		end
 		else begin
 			stateReg 									<= stateNextReg;
@@ -164,9 +356,20 @@ module ept
 			end
 			else begin
 				taskStartCCR							<= taskStartNextCCR;
+				if (taskResume_o) begin
+					taskAddressReg						<= preemptTopAddress;					// The suspended task runs again
+				end
+			end
+			if (taskPreemptTick) begin
+				taskPreemptCCR							<= 1'b1;
+				suspendAddressReg						<= taskAddressReg;					// RAM address of the suspended task
+			end
+			else begin
+				taskPreemptCCR							<= taskPreemptNextCCR;
 			end
 			if (taskStopTick) begin
 				taskStopCCR								<= 1'b1;
+				stopAddressReg							<= taskAddressReg;					// RAM address of the finished task: a switch overwrites taskAddressReg
 			end
 			else begin
 				taskStopCCR								<= taskStopNextCCR;
@@ -219,9 +422,65 @@ module ept
 			contextRestoreReg							<= contextRestoreNextReg;
 			startTimestampReg							<= startTimestampNextReg;
 			taskPartTimeReg							<= taskPartTimeNextReg;
-			elapsedReg									<= elapsedNextReg;
-			elapsedSumReg								<= elapsedSumNextReg;
-			exceptionFlagReg							<= exceptionFlagNextReg;
+			elapsedReg									<= elapsedNextReg;
+			taskChildTimeReg							<= taskChildTimeNextReg;
+			taskParentReg								<= taskParentNextReg;
+			taskOverrunReg								<= taskOverrunNextReg;
+			budgetAddressReg							<= taskAddressReg;					// Address of budget_i at the next cycle
+			// Record update pipeline
+			summarizeReg								<= summarizeNextReg;
+			regionReg									<= regionNextReg;
+			inclusiveReg								<= inclusiveNextReg;
+			parentReg									<= parentNextReg;
+			storeReg										<= summarizeReg;
+			storeAddressReg							<= ramAddressReg;
+			recordReg									<= recordNextReg;
+			accumulatorWarnReg						<= accumulatorWarnNextReg;
+			forwardReg									<= storeReg;
+			forwardAddressReg							<= storeAddressReg;
+			forwardRecordReg							<= recordReg;
+			// Lost events restart with the counter
+			if (counterResetReg | lostClear_i) begin
+				lostEvents_o							<= 0;
+			end
+			else if (lostCount != 0) begin
+				lostEvents_o							<= (lostSum[DATA_WIDTH]) ? DATA_MAX : lostSum[DATA_WIDTH-1:0];
+			end
+			tracePendingReg							<= tracePendingNextReg;
+			traceTimestampReg							<= traceTimestampNextReg;
+			traceLastReg								<= traceLastNextReg;
+			traceTaskReg								<= traceTaskNextReg;
+			traceExtensionReg							<= traceExtensionNextReg;
+			// Preemption stack restarts with the counter
+			if (counterResetReg) begin
+				preemptLevelReg						<= 0;
+			end
+			else if (preemptPush) begin
+				preemptLevelReg						<= preemptLevelReg + 1'b1;
+			end
+			else if (preemptPop) begin
+				preemptLevelReg						<= preemptLevelReg - 1'b1;
+			end
+			if (counterResetReg | preemptClear_i) begin
+				preemptOverflow_o						<= 1'b0;
+			end
+			else if (preemptDrop) begin
+				preemptOverflow_o						<= 1'b1;
+			end
+		end
+	end
+	
+	// Preemption stack entries: no reset, the level qualifies them
+	always @ (posedge clock_i) begin
+		if (preemptPush) begin
+			preemptAddressReg[preemptLevelReg]		<= suspendAddressReg;
+			preemptTimeReg[preemptLevelReg]			<= suspendTime;
+			preemptChildReg[preemptLevelReg]		<= taskChildTimeReg;
+			preemptParentReg[preemptLevelReg]		<= taskParentReg;
+			preemptOverrunReg[preemptLevelReg]		<= taskOverrunReg;
+		end
+		else if (preemptChildAdd) begin
+			preemptChildReg[preemptLevelReg - 1'b1]	<= preemptTopChild + inclusiveNextReg;		// A task switched in a nested region
 		end
 	end
 	
@@ -234,7 +493,7 @@ module ept
 		taskIDNextReg								= taskID_i;
 		ramAddressNextReg							= ramAddressReg;
 		// Capture Control Registers
-		taskStartNextCCR							= taskStopCCR;
+		taskStartNextCCR							= taskStartCCR;
 		taskStopNextCCR							= taskStopCCR;
 		irqStartNextCCR							= irqStartCCR;
 		isrStartNextCCR							= isrStartCCR;
@@ -243,17 +502,29 @@ module ept
 		contextSaveStopNextCCR					= contextSaveStopCCR;
 		contextRestoreStartNextCCR				= contextRestoreStartCCR;
 		contextRestoreStopNextCCR				= contextRestoreStopCCR;
+		taskPreemptNextCCR						= taskPreemptCCR;
 		// Control signals
 		irqNextReg									= irqAssert_i;
 		isrNextReg									= isrHandling_i;
 		contextSaveNextReg						= contextSave_i;
 		contextRestoreNextReg					= contextRestore_i;
-		exceptionFlagNextReg						= exceptionFlagReg;
 		// Timings
 		startTimestampNextReg					= startTimestampReg;
 		taskPartTimeNextReg						= taskPartTimeReg;
-		elapsedNextReg								= elapsedReg;
-		elapsedSumNextReg							= elapsedSumReg;
+		elapsedNextReg								= elapsedReg;
+		taskChildTimeNextReg						= taskChildTimeReg;
+		taskParentNextReg							= taskParentReg;
+		taskOverrunNextReg						= taskOverrunReg | overrunTick_o;
+		summarizeNextReg							= 1'b0;
+		regionNextReg								= 1'b0;
+		inclusiveNextReg							= inclusiveReg;
+		parentNextReg								= parentReg;
+		// Preemption stack
+		preemptPush									= 1'b0;
+		preemptPop									= 1'b0;
+		preemptDrop									= 1'b0;
+		preemptChildAdd							= 1'b0;
+		taskResume_o								= 1'b0;
 		// Status and control
 		counterResetReg								= 1'b0;
 		ready_o 										= 1'b0;
@@ -264,8 +535,19 @@ module ept
 			STATE_IDLE: begin
 				ready_o 								= 1'b1;
 				// Detect start input signal
-				if (start_i) begin
+				if (start_i) begin
 					counterResetReg					= 1'b1;
+					taskPreemptNextCCR				= 0;									// The stack restarts empty
+					// Events captured before the start are dropped, an event at the start (trigger) is kept
+					taskStartNextCCR				= 0;
+					taskStopNextCCR				= 0;
+					irqStartNextCCR				= 0;
+					isrStartNextCCR				= 0;
+					isrStopNextCCR					= 0;
+					contextSaveStartNextCCR		= 0;
+					contextSaveStopNextCCR		= 0;
+					contextRestoreStartNextCCR	= 0;
+					contextRestoreStopNextCCR	= 0;
 					stateNextReg					= STATE_WATCH;
 				end
 			end
@@ -279,7 +561,6 @@ module ept
 					if (irqStartCCR) begin
 						irqStartNextCCR				= 0;																			// Reset captured task register
 						startTimestampNextReg		= counterData_o;															// IRQAssert timestamp
-						exceptionFlagNextReg			= 1'b1;																		// STATE_EXCEPTION handling is started
 						taskPartTimeNextReg			= taskPartTimeReg + (counterData_o - startTimestampReg);		// Task is interrupted, calculate the elapsed part-time without IR latency
 						stateNextReg					= STATE_EXCEPTION;														// Initiate STATE_EXCEPTION handling measurements
 					end
@@ -290,6 +571,18 @@ module ept
 							taskStartNextCCR			= 0;												// Reset captured task register
 							startTimestampNextReg 	= counterData_o;								// TaskStart timestamp
 							taskPartTimeNextReg		= 0;											// Reset part time register
+							taskChildTimeNextReg		= 0;
+							taskOverrunNextReg		= 1'b0;										// New invocation
+							// The running task is preempted: suspended with its part-time, dropped at the full stack
+							if (taskPreemptCCR) begin
+								taskPreemptNextCCR	= 0;
+								preemptPush				= (preemptLevelReg != PREEMPT_DEPTH);
+								preemptDrop				= (preemptLevelReg == PREEMPT_DEPTH);
+								taskParentNextReg		= {1'b1, suspendAddressReg};				// Nested in the preempted task
+							end
+							else begin
+								taskParentNextReg		= (preemptLevelReg != 0) ? {1'b1, preemptTopAddress} : 0;	// Nested in the suspended task, if any
+							end
 						end
 						// A task is finished
 						if (taskStopCCR) begin
@@ -297,77 +590,83 @@ module ept
 							elapsedNextReg 				= (counterData_o - startTimestampReg) + taskPartTimeReg - {COUNTER_ZEROS, offset_i};	// Calculate the Task duration
 							// Set RAM address
 							if (taskEnableRamAddress) begin
-								ramAddressNextReg 	= taskAddressReg;											
+								ramAddressNextReg 	= stopAddressReg;											
 							end
 							else begin
 								ramAddressNextReg		= RAM_ADDRESS_RESERVED - 1;			// Disable reserved memory address, set to the last available value
 							end
-							stateNextReg = STATE_SUMMARIZE;
+							summarizeNextReg			= 1'b1;											// Read the record, summarize at the next cycle
+							regionNextReg				= 1'b1;
+							inclusiveNextReg			= elapsedNextReg + taskChildTimeReg;			// Own and nested cycles
+							parentNextReg				= taskParentReg;
+							// The last suspended task resumes, unless a task is started instead (switch)
+							if (~taskStartCCR & (preemptLevelReg != 0)) begin
+								preemptPop				= 1'b1;
+								taskResume_o			= 1'b1;
+								taskIDNextReg			= {1'b1, preemptTopAddress};				// No start edge: the task runs again
+								startTimestampNextReg	= counterData_o;
+								taskPartTimeNextReg	= preemptTopTime;
+								taskChildTimeNextReg	= preemptTopChild + inclusiveNextReg;
+								taskParentNextReg		= preemptTopParent;
+								taskOverrunNextReg	= preemptTopOverrun;
+							end
+							else if (taskStartCCR & ~taskPreemptCCR & (preemptLevelReg != 0)) begin
+								preemptChildAdd		= 1'b1;
+							end
 						end
 					end
 				end
 			end
 //--- STATE_EXCEPTION handler: IRQ -> CPU ContextSaving -> ISR -> CPU ContextRestoring
 			STATE_EXCEPTION: begin
+				// One record update per cycle: the captured events are handled in the order of the exception
 				// IR Latency = Context Save Start - IRQ Assert
 				if (contextSaveStartCCR) begin
 					contextSaveStartNextCCR				= 0;																						// Reset captured task register
-					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offset_i};	// Duration of IR latency
+					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offsetIrLatency_i};	// Duration of IR latency
 					startTimestampNextReg				= counterData_o;																		// Set contextSaveStartTick timestamp
 					ramAddressNextReg						= RAM_ADDRESS_RESERVED;																// Set RAM to IR latency
-					stateNextReg							= STATE_SUMMARIZE;
+					summarizeNextReg						= 1'b1;
 				end
 				// Context Save = Context Save Stop - Context Save Start
-				if (contextSaveStopCCR) begin
+				else if (contextSaveStopCCR) begin
 					contextSaveStopNextCCR				= 0;																						// Reset captured task register
 					taskPartTimeNextReg					= taskPartTimeReg + elapsedReg;													// Add IR latency to interrupted Task's part time
-					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offset_i};	// Duration of Context Save
+					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offsetContextSave_i};	// Duration of Context Save
 					ramAddressNextReg						= RAM_ADDRESS_RESERVED + 1;														// Set RAM to Context Save
-					stateNextReg							= STATE_SUMMARIZE;
+					summarizeNextReg						= 1'b1;
 				end
 				// ISR = ISR Stop - ISR Start
-				if (isrStartCCR) begin
+				else if (isrStartCCR) begin
 					isrStartNextCCR						= 0;																						// Reset captured task register
 					startTimestampNextReg				= counterData_o;
 				end
-				if (isrStopCCR) begin
+				else if (isrStopCCR) begin
 					isrStopNextCCR							= 0;																						// Reset captured task register
-					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offset_i};	// Duration of ISR
+					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offsetIsr_i};	// Duration of ISR
 					ramAddressNextReg						= RAM_ADDRESS_RESERVED + 2;														// Set RAM to ISR
-					stateNextReg							= STATE_SUMMARIZE;
+					summarizeNextReg						= 1'b1;
 				end
 				// Context Restore = Context Restore Stop - Context Restore Start
-				if (contextRestoreStartCCR) begin
+				else if (contextRestoreStartCCR) begin
 					contextRestoreStartNextCCR			= 0;																						// Reset captured task register
 					startTimestampNextReg				= counterData_o;
 				end
-				if (contextRestoreStopCCR) begin
+				else if (contextRestoreStopCCR) begin
 					contextRestoreStopNextCCR			= 0;																						// Reset captured task register
-					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offset_i};	// Duration of Context Restore
+					elapsedNextReg							= (counterData_o - startTimestampReg) - {COUNTER_ZEROS, offsetContextRestore_i};	// Duration of Context Restore
 					ramAddressNextReg						= RAM_ADDRESS_RESERVED + 3;														// Set RAM to Context Restore
-					exceptionFlagNextReg					= 1'b0;																					// The STATE_EXCEPTION handling is finished
 					startTimestampNextReg				= counterData_o;																		// Set start timestamp for interrupted task snippet part-time measurement
-					stateNextReg							= STATE_SUMMARIZE;
-				end
-			end
-//--- STATE_SUMMARIZE and prepare data for storing data in external RAM
-			STATE_SUMMARIZE: begin
-				elapsedSumNextReg 		= elapsedReg + ramReadData_i;				// STATE_SUMMARIZE the elapsed cycles
-				stateNextReg				= STATE_STORE;
-			end
-			STATE_STORE: begin
-				// STATE_EXCEPTION handling is ongoing
-				if (exceptionFlagReg) begin
-					stateNextReg		= STATE_EXCEPTION;
-				end
-				// STATE_EXCEPTION handling is finished
-				else begin
-					stateNextReg		= STATE_WATCH;
+					summarizeNextReg						= 1'b1;
+					stateNextReg							= STATE_WATCH;																			// The STATE_EXCEPTION handling is finished
 				end
 			end
 			STATE_DONE: begin
-				doneTick_o				= 1'b1;
-				stateNextReg			= STATE_IDLE;
+				// Results are ready when the last record update is stored
+				if (~(summarizeReg | storeReg)) begin
+					doneTick_o			= 1'b1;
+					stateNextReg		= STATE_IDLE;
+				end
 			end
 			default: begin
 				stateNextReg 			= STATE_IDLE;
@@ -375,27 +674,124 @@ module ept
 		endcase
 	end
 	
-	// Instantiate Counter
-	counter #(.COUNTER_SIZE(COUNTER_SIZE)) counter1
+	//-----------------------------
+	// Record update pipeline
+	//-----------------------------
+	always @* begin
+		recordNextReg																	= recordReg;
+		accumulatorWarnNextReg														= 1'b0;
+		// Summarize the record read at the previous cycle into the stored one
+		if (summarizeReg) begin
+			recordNextReg																= recordSource;
+			recordNextReg[RECORD_SUM*DATA_WIDTH +: SUM_WIDTH]			= recordSum + {SUM_ZEROS, elapsedReg};			// Summarize the elapsed cycles, carry into the HI word
+			recordNextReg[RECORD_COUNT*DATA_WIDTH +: DATA_WIDTH]		= recordCount + 1;										// Count the invocation
+			if ((recordCount == 0) || (elapsedData < recordMin)) begin
+				recordNextReg[RECORD_MIN*DATA_WIDTH +: DATA_WIDTH]		= elapsedData;												// First or shortest invocation
+			end
+			if (elapsedData > recordMax) begin
+				recordNextReg[RECORD_MAX*DATA_WIDTH +: DATA_WIDTH]		= elapsedData;												// Longest invocation
+			end
+			// Task stop: inclusive cycles and the parent link, a different parent than the stored one is flagged
+			if (regionReg) begin
+				recordNextReg[RECORD_INCLUSIVE*DATA_WIDTH +: SUM_WIDTH]	= recordInclusive + {SUM_ZEROS, inclusiveReg};
+				recordNextReg[RECORD_PARENT*DATA_WIDTH +: DATA_WIDTH]		= {parentReg[RAM_SIZE], recordParent[DATA_WIDTH-2] |
+																								  ((recordCount != 0) & ({recordParent[DATA_WIDTH-1], recordParent[RAM_SIZE-1:0]} != parentReg)),
+																								  {(DATA_WIDTH-RAM_SIZE-2){1'b0}}, parentReg[RAM_SIZE-1:0]};
+			end
+			// The MSB of the Sum, of the inclusive Sum or of the Count is set by this update
+			accumulatorWarnNextReg													= (recordNextReg[RECORD_SUM*DATA_WIDTH+SUM_WIDTH-1] & ~recordSum[SUM_WIDTH-1]) |
+																								  (recordNextReg[RECORD_INCLUSIVE*DATA_WIDTH+SUM_WIDTH-1] & ~recordInclusive[SUM_WIDTH-1]) |
+																								  (recordNextReg[RECORD_COUNT*DATA_WIDTH+DATA_WIDTH-1] & ~recordCount[DATA_WIDTH-1]);
+		end
+	end
+	
+	// Number of lost events at this cycle
+	always @* begin
+		lostCount									= 0;
+		for (j=0; j<LOST_EVENTS; j=j+1) begin
+			lostCount								= lostCount + lostTicks[j];
+		end
+	end
+	
+	//-----------------------------
+	// Trace encoder logic
+	//-----------------------------
+	always @* begin
+		// The lowest pending event type is recorded first
+		traceType									= 0;
+		traceFirst									= 0;
+		for (i=TRACE_EVENTS-1; i>=0; i=i-1) begin
+			if (tracePendingReg[i]) begin
+				traceType							= i;
+				traceFirst							= {{(TRACE_EVENTS-1){1'b0}}, 1'b1} << i;
+			end
+		end
+		tracePendingNextReg						= tracePendingReg;
+		traceTimestampNextReg					= traceTimestampReg;
+		traceLastNextReg							= traceLastReg;
+		traceTaskNextReg							= traceTaskReg;
+		traceExtensionNextReg					= traceExtensionReg;
+		traceWrite_o								= 1'b0;
+		traceData_o									= 0;
+		// Emit one record per cycle
+		if (tracePendingReg != 0) begin
+			traceWrite_o							= 1'b1;
+			if (traceDeltaLong & ~traceExtensionReg) begin
+				traceData_o							= {TRACE_EXTENSION, traceExtensionData};								// Upper bits of the Delta
+				traceExtensionNextReg			= 1'b1;
+			end
+			else begin
+				traceData_o							= {traceType, traceTaskReg, traceDelta[TRACE_DELTA_SIZE-1:0]};
+				tracePendingNextReg				= tracePendingReg & ~traceFirst;
+				traceLastNextReg					= traceTimestampReg;
+				traceExtensionNextReg			= 1'b0;
+			end
+		end
+		// Capture the detected events, simultaneous ones share the timestamp
+		if (traceEnable_i & (stateReg != STATE_IDLE) & (traceTicks != 0)) begin
+			if (tracePendingNextReg == 0) begin
+				traceTimestampNextReg			= counterData_o;
+				traceTaskNextReg					= (taskStartTick) ? taskIDNextReg[TRACE_ID_SIZE-1:0] : taskAddressReg;		// Started or running task
+			end
+			tracePendingNextReg					= tracePendingNextReg | traceTicks;
+		end
+		// Timestamps restart with the counter
+		if (counterResetReg) begin
+			tracePendingNextReg					= 0;
+			traceLastNextReg						= 0;
+			traceExtensionNextReg				= 0;
+		end
+	end
+	
+	// Instantiate Counter: on clock_i or on the measurement clock
+	timebase #(.COUNTER_SIZE(COUNTER_SIZE), .MEASURE_CLOCK(MEASURE_CLOCK)) timebase1
 	(
 		// Clock-reset
 		.clock_i(clock_i),
-		.reset_i(counterReset),
+		.measureClock_i(measureClock_i),
+		.reset_i(reset_i),
 		// Control signals
+		.clear_i(counterResetReg),
 		.enable_i(counterEnable),
+		.preload_i(counterPreload_i),
 		// Output(s)	
-		.counterOut_o(counterData_o)		// Get actual counter's transparent value output
+		.counterOut_o(counterData_o)		// Elapsed cycles in the clock_i domain
 	);
 
 	//------------------------
 	// Control logic signals
 	//------------------------
-	assign counterReset	= (reset_i) ? reset_i : counterResetReg;
 	assign counterEnable = (stateReg != STATE_IDLE);
 	// Posedge detection of task ID input MSB -> shows the task starting activity
-	assign taskStartTick 				= (taskIDNextReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1] > taskIDReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1]);
+	assign taskStartTick 				= ((taskIDNextReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1] > taskIDReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1]) & ~taskResume_o) |
+												  taskSwitchTick | taskPreemptTick;
 	// Negedge detection of task ID input MSB -> shows the task stopping activity
-	assign taskStopTick 					= (taskIDNextReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1] < taskIDReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1]);
+	assign taskStopTick 					= (taskIDNextReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1] < taskIDReg[TASK_ID_SIZE-1:TASK_ID_SIZE-1]) | taskSwitchTick;
+	// Task switch while a task is running -> stopping and starting activity at the same cycle
+	assign taskSwitchTick				= taskSwitch_i & taskIDReg[TASK_ID_SIZE-1] & taskIDNextReg[TASK_ID_SIZE-1];
+	// Another task ID is started while a task is running -> the running task is preempted
+	assign taskPreemptTick				= (PREEMPT_DEPTH != 0) & ~taskSwitch_i & taskIDReg[TASK_ID_SIZE-1] & taskIDNextReg[TASK_ID_SIZE-1] &
+												  (taskIDNextReg[TASK_ID_SIZE-2:0] != taskIDReg[TASK_ID_SIZE-2:0]);
 	// IRQ, ISR and Context Saving triggers
 	assign irqStartTick 					= (irqNextReg > irqReg) ? 1'b1 : 0;																		// Posedge detection
 	assign isrStartTick 					= (isrNextReg > isrReg) ? 1'b1 : 0;																		// Posedge detection
@@ -404,16 +800,70 @@ module ept
 	assign contextSaveStopTick			= (contextSaveNextReg < contextSaveReg) ? 1'b1 : 0;												// Negedge detection
 	assign contextRestoreStartTick	= (contextRestoreNextReg > contextRestoreReg) ? 1'b1 : 0;										// Posedge detection
 	assign contextRestoreStopTick		= (contextRestoreNextReg < contextRestoreReg) ? 1'b1 : 0;										// Negedge detection
-	assign taskEnableRamAddress		= (stateReg == STATE_WATCH) & (taskIDReg[TASK_ID_SIZE-2:0] < RAM_ADDRESS_RESERVED);		// Last addresses are reserved for STATE_EXCEPTION latency storing
+	assign taskEnableRamAddress		= (stateReg == STATE_WATCH) & (stopAddressReg < RAM_ADDRESS_RESERVED);		// Last addresses are reserved for STATE_EXCEPTION latency storing
+	// Task record fields: the RAM read misses the record at the store stage and the one stored at the read edge
+	assign recordSource					= (storeReg & (storeAddressReg == ramAddressReg)) ? recordReg :
+													  (forwardReg & (forwardAddressReg == ramAddressReg)) ? forwardRecordReg : ramReadData_i;
+	assign recordSum						= recordSource[RECORD_SUM*DATA_WIDTH +: SUM_WIDTH];
+	assign recordCount					= recordSource[RECORD_COUNT*DATA_WIDTH +: DATA_WIDTH];
+	assign recordMin						= recordSource[RECORD_MIN*DATA_WIDTH +: DATA_WIDTH];
+	assign recordMax						= recordSource[RECORD_MAX*DATA_WIDTH +: DATA_WIDTH];
+	assign recordInclusive				= recordSource[RECORD_INCLUSIVE*DATA_WIDTH +: SUM_WIDTH];
+	assign recordParent					= recordSource[RECORD_PARENT*DATA_WIDTH +: DATA_WIDTH];
+	assign elapsedData					= (|elapsedReg[COUNTER_SIZE-1:DATA_WIDTH]) ? DATA_MAX : elapsedReg[DATA_WIDTH-1:0];	// Saturated elapsed cycles for minimum/maximum
+	// Trace events ordered by the record type
+	assign traceTicks						= {taskSwitchTick, contextRestoreStopTick, contextRestoreStartTick, isrStopTick, isrStartTick, contextSaveStopTick,
+												   contextSaveStartTick, irqStartTick, taskStopTick & ~taskSwitchTick, taskStartTick & ~taskSwitchTick};
+	// Lost events: a new edge while the capture register keeps its previous event (ordered by the trace record type)
+	assign lostTicks						= {contextRestoreStopTick & contextRestoreStopNextCCR, contextRestoreStartTick & contextRestoreStartNextCCR,
+													   isrStopTick & isrStopNextCCR, isrStartTick & isrStartNextCCR, contextSaveStopTick & contextSaveStopNextCCR,
+													   contextSaveStartTick & contextSaveStartNextCCR, irqStartTick & irqStartNextCCR, taskStopTick & taskStopNextCCR,
+													   taskStartTick & taskStartNextCCR} & {LOST_EVENTS{(stateReg != STATE_IDLE)}};
+	assign lostSum							= {1'b0, lostEvents_o} + lostCount;
+	// Preemption stack: part-time of the suspended task at the start of the preempting one
+	assign suspendTime					= taskPartTimeReg + (counterData_o - startTimestampReg);
+	assign preemptTopAddress			= preemptAddressReg[preemptLevelReg - 1'b1];
+	assign preemptTopTime				= preemptTimeReg[preemptLevelReg - 1'b1];
+	assign preemptTopChild				= preemptChildReg[preemptLevelReg - 1'b1];
+	assign preemptTopParent				= preemptParentReg[preemptLevelReg - 1'b1];
+	assign preemptTopOverrun			= preemptOverrunReg[preemptLevelReg - 1'b1];
+	// Budget watchdog: the timestamps of a running task are valid after its start is handled, budget_i belongs to it
+	assign taskElapsed					= (counterData_o - startTimestampReg) + taskPartTimeReg;
+	assign budgetWatch					= (stateReg == STATE_WATCH) & taskIDReg[TASK_ID_SIZE-1] & ~taskStartCCR & ~taskStopCCR &
+												  (budgetAddressReg == taskAddressReg) & (budget_i != 0) & ~taskOverrunReg;
+	assign traceDelta						= traceTimestampReg - traceLastReg;
+	assign traceDeltaLong				= |(traceDelta >> TRACE_DELTA_SIZE);
+	assign traceExtensionData			= traceDelta >> TRACE_DELTA_SIZE;
 	
 	//------------------------
 	// Output assignments
 	//------------------------	
 	// RAM control signals
-	assign ramRead_o					= (stateReg == STATE_SUMMARIZE);
-	assign ramWrite_o 				= (stateReg == STATE_STORE);																				// Enable RAM writing only at STATE_STORE state
+	assign ramRead_o					= summarizeNextReg;
+	assign ramBusy_o					= summarizeNextReg | summarizeReg | storeReg;													// The record is read and stored in the same RAM bank
+	assign ramWrite_o 				= storeReg;																										// Enable RAM writing only at the store stage
 	assign ramAddress_o				= (stateReg == STATE_IDLE) ? 0 : ramAddressNextReg;														
-	assign ramWriteData_o			= (stateReg == STATE_STORE) ? elapsedSumReg[DATA_WIDTH-1:0] : 0;								// For storing the summarized data in the RAM
+	assign ramWriteAddress_o		= storeAddressReg;
+	assign ramWriteData_o			= (storeReg) ? recordReg : 0;																// For storing the updated task record in the RAM
+	assign accumulatorWarn_o		= storeReg & accumulatorWarnReg;
+	assign recordUpdate_o			= summarizeReg;
+	assign recordAddress_o			= ramAddressReg;
+	assign recordElapsed_o			= elapsedData;
+	// Preemption stack
+	assign taskResumeID_o			= preemptTopAddress;
+	assign preemptLevel_o			= preemptLevelReg;
+	// Budget watchdog: the offset of the probes is compensated as in the stored duration
+	assign taskAddress_o				= taskAddressReg;
+	assign overrunTick_o				= budgetWatch & (taskElapsed >= {COUNTER_ZEROS, budget_i} + offset_i);	// Last watched cycle precedes the stop processing
+	// Sampling snapshot: the exception phase covers the running task, the gaps between the probe pairs count as IR latency
+	assign sampleRun_o				= (stateReg == STATE_WATCH) | (stateReg == STATE_EXCEPTION);
+	assign sampleActive_o			= (stateReg == STATE_EXCEPTION) | taskIDReg[TASK_ID_SIZE-1];
+	assign sampleAddress_o			= (stateReg != STATE_EXCEPTION) ? taskAddressReg :
+												  (contextRestoreReg) ? RAM_ADDRESS_RESERVED + 2'd3 :
+												  (isrReg) ? RAM_ADDRESS_RESERVED + 2'd2 :
+												  (contextSaveReg) ? RAM_ADDRESS_RESERVED + 2'd1 : RAM_ADDRESS_RESERVED;
+	// Trigger unit: events of a cycle count once
+	assign eventTick_o				= (stateReg != STATE_IDLE) & (traceTicks != 0);
 
 endmodule
 
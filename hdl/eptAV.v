@@ -2,37 +2,135 @@
 // Execution Performance Tester Interface
 // 	@Brief:
 //		  - NIOSii/e based (non-vectored IR, no cache and branch prediction)
-//		  - No multitask measurement support
+//		  - Preemption stack (PREEMPT_DEPTH > 0): a task started while another one runs suspends it, it resumes at
+//			 the stop of the preempting task and the Task ID register follows it, see ept.v
 //		  - Detects task execution
 //      - Measures exception timings: IR latency, context saving, ISR handling, context restoring
+//		  - Per-task records in RAM: {RAMaddr, Field} -> Field 0: Sum LO, 1: Sum HI, 2: Count, 3: Min, 4: Max,
+//			 5: Inclusive LO, 6: Inclusive HI, 7: Parent {Valid[31], Multiple parents[30], Parent ID}
+//		  - Trace mode: delta timestamped event records in a ring buffer, drained while measuring
+//			 Record: {Type[31:28], Task ID, Delta}, Type 0xf: extension {Delta >> Delta width} of the next record
+//			 Task ID: RAM_ADDRESS_WIDTH bits below the Type, Delta: the remaining 28 - RAM_ADDRESS_WIDTH bits
+//		  - Ping-pong result banks: the core accumulates into the active bank, the CPU reaches the frozen bank
+//			 on the second RAM port while measuring (and the active bank at ready status)
+//		  - Pipelined Avalon read: fixed read latency of 1 cycle, registered readdata from a one-hot register select
+//		  - Pipelined record updates: port A reads a record and writes an earlier one at the same cycle,
+//			 e.g. one true dual-port block per bank (active: read + write, frozen: CPU access)
+//		  - Interrupt sender: ept_irq is set by the status bits enabled in the IRQ mask, the CPU clears them
+//		  - Optional readout DMA (DMA = 1): an Avalon MM master copies the frozen bank or the trace records
+//			 into system memory, see dma.v. Records: every bank swap is copied and cleared, a stop or a period
+//			 requests the swap. Trace: a stop or a period copies the stored records. The frozen bank port
+//			 belongs to the DMA while it is busy, the swap waits for it
+//		  - RAM fill: a word range of the RAM window (the active bank at ready status, else the frozen one)
+//			 is written in hardware, one record per cycle with the field byte enables. The bus RAM accesses are
+//			 held by ept_waitrequest until it is done, the start has to wait for the busy flag, the swap waits for it
+//		  - Optional latency histograms (HISTOGRAM = 1): 2^HIST_SIZE linear or log2 buckets of the elapsed cycles
+//			 for 4 selected task IDs and the 4 exception records, counted at each record update, see histogram.v
+//		  - Optional budget watchdog (BUDGET = 1): a cycle budget per task ID, the running task is checked at every
+//			 cycle, overruns are counted per task and raise the overrun IRQ source, the first one is captured
+//			 with its task ID and counter value, see budget.v
+//		  - Optional sampling profiler (SAMPLING = 1): the running task or exception phase is sampled every
+//			 period (with a pseudo-random dither) while measuring, the hits are counted per record, see sampler.v
+//		  - Optional trigger unit (TRIGGER = 1): the armed unit starts and stops the measurement on a task start,
+//			 an IRQ edge, a cycle or event count, optionally keeping the trace records before the trigger, see trigger.v
+//		  - Probe custom instruction (eptCI.v on the probe conduit): the task ID, task switch, ISR and context
+//			 probes in a single instruction without an Avalon transfer, the probe takes the register write path
+//			 for its cycle (a concurrent Avalon transfer waits), the instruction result is the counter LO word
+//		  - Optional measurement clock (MEASURE_CLOCK = 1): the cycle counter runs on ept_measure_clock,
+//			 the counter, the records and the trace deltas are in ept_measure_clock cycles
 //		@Operation Modes by Address:
 //			 Operation			|	Address(RAMaddr)	|	WriteData	|	ReadData
 //			 -----------------------------------------------------------------------
-//		  1. Acess RAM				0x0(RAMaddr)			data				data
-//      2. GetCounterLO			0x80						X					Counter data
-//      3. GetCounterHI			0x81						X					Counter data
-//      4. Ready Status			0x82						X					Status
-//      5. Start					0x83						0x1				X					
-//      6. Stop					0x84						0x1				X					
-//		  7. Set Task ID			0x85						Task ID			X
-//		  8. Set offset			0x86						Offset			X
-//		 9. ISR handling			0x87						0x1				X
-//		 10. Context saving		0x88						0x1				X
-//		 11. Context restoring	0x89						0x1				X
-//		 12. Get executed			0x8a						X					Executed
-//		 13. Module reset			0x8b						0x1				X
+//		  1. Acess RAM				0x0(RAMaddr,Field)	data				data
+//      2. CounterLO				0x400						Preload LO		Counter data	-> Read: latches the HI word
+//      3. CounterHI				0x401						Preload HI		Counter data	-> Read: HI word at the last LO read
+//																									-> Write: the counter starts from the preload
+//      4. Ready Status			0x402						X					Status
+//      5. Start					0x403						0x1				X					
+//      6. Stop					0x404						0x1				X					
+//		  7. Set Task ID			0x405						Task ID			X
+//		  8. Set offset			0x406						Offset			X
+//		 9. ISR handling			0x407						0x1				X
+//		 10. Context saving		0x408						0x1				X
+//		 11. Context restoring	0x409						0x1				X
+//		 12. Get executed			0x40a						X					Executed
+//		 13. Module reset			0x40b						0x1				X
+//		 14. Mode					0x40c						Mode				Mode				-> Bit 0: Trace enable
+//		 15. Trace level			0x40d						X (clear)		Level				-> Bit 31: Overflow
+//		 16. Trace data			0x40e						X					Oldest record	-> Read pops the record
+//		 17. Swap banks			0x40f						Command			Status			-> Command bit 0: Now, bit 1: At the next IRQ
+//																									-> Status bit 0: Active bank, bit 1: Pending
+//		 18. Task switch			0x410						Task ID			Task ID			-> Stops the running task, starts Task ID
+//		 19. IR latency offset	0x411						Offset			Offset
+//		 20. Ctx save offset		0x412						Offset			Offset
+//		 21. ISR offset			0x413						Offset			Offset
+//		 22. Ctx restore offset	0x414						Offset			Offset
+//		 23. Lost events			0x415						X (clear)		Lost events		-> Edges merged into an unprocessed one, saturating
+//		 24. IRQ status			0x416						Clear bits		Status			-> Bit 0: Done, 1: Accumulator at half range,
+//																									   2: Trace level at half depth, 3: Banks swapped,
+//																									   4: DMA copy complete, 5: Budget overrun
+//		 25. IRQ mask				0x417						Mask				Mask				-> ept_irq: a status bit enabled in the mask
+//		 26. DMA control			0x418						Control			Status			-> Bit 0: Enable, 1: At stop, 2: Trace source
+//																									-> Status bit 31: Busy
+//		 27. DMA address			0x419						Address			Address			-> Destination byte address (word aligned)
+//		 28. DMA period			0x41a						Cycles			Cycles			-> Readout period while measuring, 0: off
+//		 29. Fill range			0x41b						Range				Range				-> {Last word[31:16], First word[15:0]}, default: all
+//		 30. Fill					0x41c						Data				Busy				-> Write: fills the range with the data
+//		 31. Preemption			0x41d						X (clear)		Status			-> Bit 31: Overflow, [4:0]: Suspended tasks
+//		 32. Histogram layout	0x41e						Layout			Layout			-> Bit 31: Enable, 30: Busy (read), [12:8]: Shift,
+//																									   0: Log2 buckets. Write: clears every bucket
+//		 33. Histogram tasks LO	0x41f						Select			Select			-> Slot 0-1: {Enable[31], ID[30:16], Enable[15], ID[14:0]}
+//		 34. Histogram tasks HI	0x420						Select			Select			-> Slot 2-3, slot 4-7: exception records
+//		 35. Histogram address	0x421						Index				Index				-> {Slot, Bucket} of the next data read
+//		 36. Histogram data		0x422						X					Count				-> Read increments the index, valid 2 cycles after it
+//		 37. Budget index			0x423						Task ID			Task ID			-> Entry of the budget and overruns registers
+//		 38. Budget				0x424						Cycles			Cycles			-> Budget of the indexed task, 0: no budget
+//		 39. Overruns				0x425						Count				Count				-> Overruns of the indexed task, saturating
+//		 40. First overrun		0x426						X (clear)		Status			-> Bit 31: Valid, Task ID. Cleared at the start
+//		 41. Overrun time LO		0x427						X					Counter LO		-> Counter value at the first overrun
+//		 42. Overrun time HI		0x428						X					Counter HI
+//		 43. Sampling control		0x429						Control			Control			-> Bit 31: Enable, 30: Busy (read), [3:0]: Dither bits
+//																									   Write: clears every count
+//		 44. Sampling period		0x42a						Cycles			Cycles			-> Sampling interval in ept_clock cycles (at least 4)
+//		 45. Sample address		0x42b						Index				Index				-> Record address of the next hits read
+//		 46. Sample hits			0x42c						X					Count				-> Read increments the index, valid 2 cycles after it
+//		 47. Idle samples			0x42d						X					Count				-> Samples without a task and an exception
+//		 48. Trigger control		0x42e						Control			Status			-> Bit 31: Arm (read: Armed), 30: Triggered (read),
+//																									   29: Pre-trigger, [6:4]: Stop, [2:0]: Start condition
+//		 49. Trigger start			0x42f						Value				Value				-> Task ID or cycles after the arm
+//		 50. Trigger stop			0x430						Value				Value				-> Task ID, cycles or events after the trigger
+//		 51. Pre-trigger			0x431						Records			Records			-> Trace records kept before the trigger
+//		 52. Trigger time LO		0x432						X					Counter LO		-> Counter value at the trigger (pre-trigger)
+//		 53. Trigger time HI		0x433						X					Counter HI
+//		@Parameters:
+//			 Addresses above are for ADDRESS_WIDTH = 11: the registers start at 2^(ADDRESS_WIDTH-1),
+//			 the RAM holds 2^(ADDRESS_WIDTH-RECORD_SIZE-1) task records per bank (the last 4 for the exceptions)
+//			 e.g. ADDRESS_WIDTH = 14: 1024 records (1020 task IDs), register base 0x2000
+//			 eptAV_hw.tcl exports ADDRESS_WIDTH, RECORD_SIZE and TRACE_SIZE to system.h for the driver,
+//			 and the counter clock frequency as MEASURE_CLOCK_FREQ (ept_clock or ept_measure_clock)
 //=================================================================================================
 
 module eptAV
 #( 
 	parameter
-		ADDRESS_WIDTH		= 8,									
+		ADDRESS_WIDTH		= 11,									// Word address: 2^(ADDRESS_WIDTH-RECORD_SIZE-1) task records
 		DATA_WIDTH			= 32,
-		COUNTER_SIZE		= 40
+		COUNTER_SIZE		= 40,
+		RECORD_SIZE			= 3,										// Number of DATA_WIDTH fields in a task record: 2^RECORD_SIZE
+		TRACE_SIZE			= 9,										// Trace ring buffer depth: 2^TRACE_SIZE records
+		MEASURE_CLOCK		= 0,										// 0: count ept_clock cycles, 1: count ept_measure_clock cycles
+		DMA					= 0,										// 1: readout DMA on the dma_master interface
+		PREEMPT_DEPTH		= 4,										// Preemption stack depth (0-16), 0: off
+		HISTOGRAM			= 0,										// 1: latency histograms
+		HIST_SIZE			= 5,										// Buckets of a histogram slot: 2^HIST_SIZE
+		BUDGET				= 0,										// 1: budget watchdog
+		SAMPLING				= 0,										// 1: sampling profiler
+		TRIGGER				= 0										// 1: trigger unit
 )
 (
 	// Clock - Reset
 	input wire 													ept_clock,
+	input wire 													ept_measure_clock,				// Cycle counter clock at MEASURE_CLOCK = 1
 	input wire 													ept_reset,
 	// Avalon MM Slave
 	input wire	[ADDRESS_WIDTH-1:0]						ept_address,
@@ -40,56 +138,215 @@ module eptAV
 	output wire	[DATA_WIDTH-1:0]							ept_readdata,
 	input wire 													ept_chipselect,
 	input wire 													ept_write,
+	input wire 													ept_read,
+	output wire 												ept_waitrequest,
 	// Conduit to interrupt
 	input wire 													ept_irc,
 	// Conduit to status
 	output wire 												ept_status,
-	// Conduit to RAM
-	output wire	[ADDRESS_WIDTH-2:0]		 				ept_ramaddress_exp,
-	output wire	[DATA_WIDTH-1:0]  						ept_ramwritedata_exp,
-	input wire  [DATA_WIDTH-1:0] 							ept_ramreaddata_exp,
-	output wire													ept_ramwrite_exp
+	// Interrupt sender
+	output wire 												ept_irq,
+	// Avalon MM Master: readout DMA (write only)
+	output wire	[DATA_WIDTH-1:0]							ept_dma_address,
+	output wire 												ept_dma_write,
+	output wire	[DATA_WIDTH-1:0]							ept_dma_writedata,
+	input wire 													ept_dma_waitrequest,
+	// Conduit to the probe custom instruction
+	input wire 													ept_probe_valid,					// Single cycle probe
+	input wire	[2:0]											ept_probe_select,					// Probe, see eptCI.v
+	input wire 	[DATA_WIDTH-1:0]							ept_probe_data,
+	output wire	[DATA_WIDTH-1:0]							ept_probe_counter,				// Counter LO word
+	// Conduit to RAM: port A (active bank), the MSB of the address selects the bank
+	output wire	[ADDRESS_WIDTH-RECORD_SIZE-1:0]		ept_ramaddress_exp,				// Read address
+	output wire	[ADDRESS_WIDTH-RECORD_SIZE-1:0]		ept_ramwriteaddress_exp,
+	output wire	[(DATA_WIDTH<<RECORD_SIZE)-1:0]		ept_ramwritedata_exp,
+	input wire  [(DATA_WIDTH<<RECORD_SIZE)-1:0]		ept_ramreaddata_exp,
+	output wire	[(DATA_WIDTH<<RECORD_SIZE)/8-1:0]	ept_rambyteenable_exp,
+	output wire													ept_ramwrite_exp,
+	// Conduit to RAM: port B (frozen bank)
+	output wire	[ADDRESS_WIDTH-RECORD_SIZE-1:0]		ept_ramaddress_b_exp,
+	output wire	[(DATA_WIDTH<<RECORD_SIZE)-1:0]		ept_ramwritedata_b_exp,
+	input wire  [(DATA_WIDTH<<RECORD_SIZE)-1:0]		ept_ramreaddata_b_exp,
+	output wire	[(DATA_WIDTH<<RECORD_SIZE)/8-1:0]	ept_rambyteenable_b_exp,
+	output wire													ept_ramwrite_b_exp
 );
 
 	//----------------------------------
 	// Local defintions
 	//----------------------------------
 	localparam
-		RAM_ADDRESS_WIDTH 	= ADDRESS_WIDTH - 1,
+		RAM_ADDRESS_WIDTH 	= ADDRESS_WIDTH - RECORD_SIZE - 1,
 		TASK_ID_SIZE			= RAM_ADDRESS_WIDTH + 1,
-		OFFSET_SIZE				= 8;
+		OFFSET_SIZE				= 8,
+		RECORD_WIDTH			= DATA_WIDTH << RECORD_SIZE,
+		RECORD_BYTES			= RECORD_WIDTH / 8,
+		FIELD_BYTES				= DATA_WIDTH / 8,
+		IRQ_SOURCES				= 6,										// Done, Accumulator, Trace watermark, Bank swap, DMA, Overrun
+		DMA_CONTROL_SIZE		= 3;										// Enable, At stop, Trace source
+	
+	// Probe selects of the custom instruction (n)
+	localparam [2:0]
+		PROBE_TASK_ID			= 3'd0,
+		PROBE_TASK_SWITCH		= 3'd1,
+		PROBE_ISR				= 3'd2,
+		PROBE_CTX_SAVE			= 3'd3,
+		PROBE_CTX_RESTORE		= 3'd4;									// Above: no register write (counter read)
 		
-	// Memory Mapped Reference Addresses
+	// Memory Mapped Reference Addresses: the MSB selects the register block
 	localparam [ADDRESS_WIDTH-1:0]
-		MM_COUNTER_LO	= 8'h80,
-		MM_COUNTER_HI	= 8'h81,
-		MM_READY			= 8'h82,
-		MM_START			= 8'h83,
-		MM_STOP			= 8'h84,
-		MM_TASK_ID		= 8'h85,
-		MM_OFFSET		= 8'h86,
-		MM_ISR			= 8'h87,
-		MM_CTX_SAVE		= 8'h88,
-		MM_CTX_RESTORE	= 8'h89,
-		MM_EXECUTED		= 8'h8a,
-		MM_RESET			= 8'h8b;
+		MM_REGISTER_BASE	= 1'b1 << (ADDRESS_WIDTH-1),
+		MM_COUNTER_LO		= MM_REGISTER_BASE + 'h0,
+		MM_COUNTER_HI		= MM_REGISTER_BASE + 'h1,
+		MM_READY				= MM_REGISTER_BASE + 'h2,
+		MM_START				= MM_REGISTER_BASE + 'h3,
+		MM_STOP				= MM_REGISTER_BASE + 'h4,
+		MM_TASK_ID			= MM_REGISTER_BASE + 'h5,
+		MM_OFFSET			= MM_REGISTER_BASE + 'h6,
+		MM_ISR				= MM_REGISTER_BASE + 'h7,
+		MM_CTX_SAVE			= MM_REGISTER_BASE + 'h8,
+		MM_CTX_RESTORE		= MM_REGISTER_BASE + 'h9,
+		MM_EXECUTED			= MM_REGISTER_BASE + 'ha,
+		MM_RESET				= MM_REGISTER_BASE + 'hb,
+		MM_MODE				= MM_REGISTER_BASE + 'hc,
+		MM_TRACE_LEVEL		= MM_REGISTER_BASE + 'hd,
+		MM_TRACE_DATA		= MM_REGISTER_BASE + 'he,
+		MM_SWAP				= MM_REGISTER_BASE + 'hf,
+		MM_TASK_SWITCH		= MM_REGISTER_BASE + 'h10,
+		MM_OFFSET_IR		= MM_REGISTER_BASE + 'h11,
+		MM_OFFSET_CTX_SAVE	= MM_REGISTER_BASE + 'h12,
+		MM_OFFSET_ISR		= MM_REGISTER_BASE + 'h13,
+		MM_OFFSET_CTX_REST	= MM_REGISTER_BASE + 'h14,
+		MM_LOST_EVENTS		= MM_REGISTER_BASE + 'h15,
+		MM_IRQ_STATUS		= MM_REGISTER_BASE + 'h16,
+		MM_IRQ_MASK			= MM_REGISTER_BASE + 'h17,
+		MM_DMA_CONTROL		= MM_REGISTER_BASE + 'h18,
+		MM_DMA_ADDRESS		= MM_REGISTER_BASE + 'h19,
+		MM_DMA_PERIOD		= MM_REGISTER_BASE + 'h1a,
+		MM_FILL_RANGE		= MM_REGISTER_BASE + 'h1b,
+		MM_FILL				= MM_REGISTER_BASE + 'h1c,
+		MM_PREEMPT			= MM_REGISTER_BASE + 'h1d,
+		MM_HIST_LAYOUT		= MM_REGISTER_BASE + 'h1e,
+		MM_HIST_SELECT_LO	= MM_REGISTER_BASE + 'h1f,
+		MM_HIST_SELECT_HI	= MM_REGISTER_BASE + 'h20,
+		MM_HIST_ADDRESS	= MM_REGISTER_BASE + 'h21,
+		MM_HIST_DATA		= MM_REGISTER_BASE + 'h22,
+		MM_BUDGET_INDEX	= MM_REGISTER_BASE + 'h23,
+		MM_BUDGET			= MM_REGISTER_BASE + 'h24,
+		MM_OVERRUNS			= MM_REGISTER_BASE + 'h25,
+		MM_OVERRUN_FIRST	= MM_REGISTER_BASE + 'h26,
+		MM_OVERRUN_TIME_LO	= MM_REGISTER_BASE + 'h27,
+		MM_OVERRUN_TIME_HI	= MM_REGISTER_BASE + 'h28,
+		MM_SAMPLE_CONTROL	= MM_REGISTER_BASE + 'h29,
+		MM_SAMPLE_PERIOD	= MM_REGISTER_BASE + 'h2a,
+		MM_SAMPLE_ADDRESS	= MM_REGISTER_BASE + 'h2b,
+		MM_SAMPLE_HITS		= MM_REGISTER_BASE + 'h2c,
+		MM_SAMPLE_IDLE		= MM_REGISTER_BASE + 'h2d,
+		MM_TRIGGER_CONTROL	= MM_REGISTER_BASE + 'h2e,
+		MM_TRIGGER_START	= MM_REGISTER_BASE + 'h2f,
+		MM_TRIGGER_STOP	= MM_REGISTER_BASE + 'h30,
+		MM_TRIGGER_PRE		= MM_REGISTER_BASE + 'h31,
+		MM_TRIGGER_TIME_LO	= MM_REGISTER_BASE + 'h32,
+		MM_TRIGGER_TIME_HI	= MM_REGISTER_BASE + 'h33;
+	localparam REGISTERS = MM_TRIGGER_TIME_HI - MM_REGISTER_BASE + 1;								// Registers of the readdata multiplexer
 	
 	//----------------------------------
 	// Signal declaration
 	//----------------------------------
 	wire [COUNTER_SIZE-1:0] counterData;
-	wire [DATA_WIDTH-1:0] 
-		counterLow = counterData[DATA_WIDTH-1:0],
-		counterHigh = counterData[COUNTER_SIZE-1:DATA_WIDTH];
+	wire [DATA_WIDTH-1:0] counterLow = counterData[DATA_WIDTH-1:0];
 	wire write, ramWrite, start, stop, ready, ramDirectAccess;
-	wire [RAM_ADDRESS_WIDTH-1:0] ramAddress;
-	wire [DATA_WIDTH-1:0] ramWriteData;
+	// Register port: the Avalon slave or a probe of the custom instruction
+	reg  [ADDRESS_WIDTH-1:0] probeAddress;
+	wire [ADDRESS_WIDTH-1:0] address;
+	wire [DATA_WIDTH-1:0] writedata;
+	wire probeWrite, avalonHold;
+	wire [RAM_ADDRESS_WIDTH-1:0] ramAddress, ramWriteAddress;
+	wire [RECORD_WIDTH-1:0] ramWriteData;
+	wire [RECORD_SIZE-1:0] ramField;
+	wire [DATA_WIDTH-1:0] ramReadField, ramFrozenField;
+	wire [RECORD_BYTES-1:0] ramFieldEnable;
 	reg  [TASK_ID_SIZE-1:0] taskIDReg;
-	reg  [OFFSET_SIZE-1:0] offsetReg;
+	reg  [OFFSET_SIZE-1:0] offsetReg, offsetIrReg, offsetContextSaveReg, offsetIsrReg, offsetContextRestoreReg;
 	reg startReg, stopReg, isrHandlingReg, contextSavingReg, contextRestoringReg;
-	reg executedReg, resetReg;
+	reg executedReg, resetReg, taskSwitchReg;
 	wire doneTick, reset, setReset;
-	wire setTaskID, setOffset, isrHandling, contextSaving, contextRestoring;
+	wire setTaskID, setTaskSwitch, setOffset, isrHandling, contextSaving, contextRestoring;
+	wire setOffsetIr, setOffsetContextSave, setOffsetIsr, setOffsetContextRestore;
+	wire lostClear;
+	wire [DATA_WIDTH-1:0] lostEvents;
+	// Preemption stack
+	wire preemptClear, taskResume, preemptOverflow;
+	wire [RAM_ADDRESS_WIDTH-1:0] taskResumeID;
+	wire [4:0] preemptLevel;
+	// Latency histograms
+	reg histEnableReg, histLog2Reg;
+	reg [4:0] histShiftReg;
+	reg [2*DATA_WIDTH-1:0] histSelectReg;
+	reg [HIST_SIZE+2:0] histAddressReg;
+	wire histClear, setHistSelectLow, setHistSelectHigh, setHistAddress, histBusy, recordUpdate;
+	wire [RAM_ADDRESS_WIDTH-1:0] recordAddress;
+	wire [DATA_WIDTH-1:0] recordElapsed, histReadData;
+	// Budget watchdog
+	reg [RAM_ADDRESS_WIDTH-1:0] budgetIndexReg;
+	wire setBudgetIndex, setBudget, setOverruns, overrunClear, overrunTick, overrunValid;
+	wire [RAM_ADDRESS_WIDTH-1:0] taskAddress, overrunAddress;
+	wire [DATA_WIDTH-1:0] taskBudget, budgetData, overrunsData;
+	wire [COUNTER_SIZE-1:0] overrunTime;
+	// Sampling profiler
+	reg sampleEnableReg;
+	reg [3:0] sampleDitherReg;
+	reg [DATA_WIDTH-1:0] samplePeriodReg;
+	reg [RAM_ADDRESS_WIDTH-1:0] sampleAddressReg;
+	wire sampleClear, setSamplePeriod, setSampleAddress, sampleBusy, sampleRun, sampleActive;
+	wire [RAM_ADDRESS_WIDTH-1:0] sampleAddress;
+	wire [DATA_WIDTH-1:0] sampleHits, sampleIdle;
+	// Trigger unit
+	reg triggerPreReg;
+	reg [2:0] triggerStartModeReg, triggerStopModeReg;
+	reg [DATA_WIDTH-1:0] triggerStartValueReg, triggerStopValueReg;
+	reg [TRACE_SIZE:0] triggerKeepReg;
+	wire setTriggerControl, setTriggerStart, setTriggerStop, setTriggerPre;
+	wire triggerArm, triggerDisarm, triggerStart, triggerStop, triggerArmed, triggerFired;
+	wire triggerPre, measureStart, measureStop, probeTaskStart, irqEdge, eventTick, traceRetain;
+	wire [COUNTER_SIZE-1:0] triggerTime;
+	// Registered read path
+	reg [DATA_WIDTH-1:0] readdataReg, readdataNext;
+	reg ramReadReg, ramFrozenReadReg;
+	reg [RECORD_SIZE-1:0] ramFieldReg;
+	reg [COUNTER_SIZE-DATA_WIDTH-1:0] counterHighReg;
+	reg [COUNTER_SIZE-1:0] counterPreloadReg;
+	wire setPreloadLow, setPreloadHigh;
+	wire [REGISTERS*DATA_WIDTH-1:0] readRegisters;
+	wire [REGISTERS-1:0] readSelect;
+	wire read;
+	integer k;
+	// Trace
+	reg modeReg;
+	wire setMode, traceClear, tracePop, traceWrite, traceOverflow;
+	wire [DATA_WIDTH-1:0] traceData, traceReadData;
+	wire [TRACE_SIZE:0] traceLevel;
+	// Interrupt sender
+	reg [IRQ_SOURCES-1:0] irqStatusReg, irqMaskReg;
+	reg traceWatermarkReg;
+	wire [IRQ_SOURCES-1:0] irqTicks;
+	wire setIrqStatus, setIrqMask, accumulatorWarn, traceWatermark;
+	// Readout DMA
+	reg [DMA_CONTROL_SIZE-1:0] dmaControlReg;
+	reg [DATA_WIDTH-1:0] dmaAddressReg, dmaPeriodReg, dmaTimerReg;
+	wire setDmaControl, setDmaAddress, setDmaPeriod, dmaEnable, dmaAtStop, dmaTrace;
+	wire dmaTimerRun, dmaPeriodTick, dmaStopTick, dmaStart, dmaBusy, dmaDoneTick, dmaRamClear, dmaTracePop;
+	wire [RAM_ADDRESS_WIDTH-1:0] dmaRamAddress;
+	// RAM fill
+	reg fillBusyReg, fillFrozenReg;
+	reg [RAM_ADDRESS_WIDTH-1:0] fillAddressReg;
+	reg [ADDRESS_WIDTH-2:0] fillFirstReg, fillLastReg;
+	reg [DATA_WIDTH-1:0] fillDataReg;
+	reg [RECORD_BYTES-1:0] fillByteEnable;
+	wire setFillRange, fillStart, fillStall, fillActive, fillFrozen, fillHold;
+	integer f;
+	// Ping-pong banks
+	reg bankReg, swapPendingReg, swapArmedReg, ircReg;
+	wire setSwap, swapTick, ramBusy, ramFrozenAccess;
 	
 	//----------------------------------
 	// Synchronization DFFs
@@ -99,83 +356,423 @@ module eptAV
 			startReg						<= 0;
 			stopReg						<= 0;
 			taskIDReg					<= 0;
+			taskSwitchReg				<= 0;
 			offsetReg					<= 0;
+			offsetIrReg					<= 0;
+			offsetContextSaveReg		<= 0;
+			offsetIsrReg				<= 0;
+			offsetContextRestoreReg	<= 0;
 			isrHandlingReg				<= 0;
 			contextSavingReg			<= 0;
 			contextRestoringReg		<= 0;
 			executedReg					<= 0;
 			resetReg						<= 0;
+			modeReg						<= 0;
+			readdataReg					<= 0;
+			ramReadReg					<= 0;
+			ramFrozenReadReg			<= 0;
+			ramFieldReg					<= 0;
+			counterHighReg				<= 0;
+			counterPreloadReg			<= 0;
+			bankReg						<= 0;
+			swapPendingReg				<= 0;
+			swapArmedReg				<= 0;
+			ircReg						<= 0;
+			irqStatusReg				<= 0;
+			irqMaskReg					<= 0;
+			traceWatermarkReg			<= 0;
+			dmaControlReg				<= 0;
+			dmaAddressReg				<= 0;
+			dmaPeriodReg				<= 0;
+			dmaTimerReg					<= 0;
+			fillBusyReg					<= 0;
+			fillFrozenReg				<= 0;
+			fillAddressReg				<= 0;
+			fillFirstReg				<= 0;
+			fillLastReg					<= {(ADDRESS_WIDTH-1){1'b1}};						// Whole bank
+			fillDataReg					<= 0;
+			histEnableReg				<= 0;
+			histLog2Reg					<= 0;
+			histShiftReg				<= 0;
+			histSelectReg				<= 0;
+			histAddressReg				<= 0;
+			budgetIndexReg				<= 0;
+			sampleEnableReg			<= 0;
+			sampleDitherReg			<= 0;
+			samplePeriodReg			<= 0;
+			sampleAddressReg			<= 0;
+			triggerPreReg				<= 0;
+			triggerStartModeReg		<= 0;
+			triggerStopModeReg		<= 0;
+			triggerStartValueReg		<= 0;
+			triggerStopValueReg		<= 0;
+			triggerKeepReg				<= 0;
 		end
 		else begin
+			taskSwitchReg				<= setTaskSwitch;												// Single cycle switch pulse
 			if (write) begin
 				if (start) begin
-					startReg					<= ept_writedata[0];							// Set start register
+					startReg					<= writedata[0];							// Set start register
 				end
 				if (stop) begin
-					stopReg					<= ept_writedata[0];							// Set start register
+					stopReg					<= writedata[0];							// Set start register
 				end
 				if (setTaskID) begin
-					taskIDReg				<= ept_writedata[TASK_ID_SIZE-1:0];		// Set task ID register
+					taskIDReg				<= writedata[TASK_ID_SIZE-1:0];		// Set task ID register
+				end
+				if (setTaskSwitch) begin
+					taskIDReg				<= {1'b1, writedata[TASK_ID_SIZE-2:0]};	// Next task is active
 				end
 				if (setOffset) begin
-					offsetReg				<= ept_writedata[OFFSET_SIZE-1:0];		// Set IO Offset register
+					offsetReg				<= writedata[OFFSET_SIZE-1:0];		// Set IO Offset register
+				end
+				if (setOffsetIr) begin
+					offsetIrReg				<= writedata[OFFSET_SIZE-1:0];		// Set IR latency Offset register
+				end
+				if (setOffsetContextSave) begin
+					offsetContextSaveReg	<= writedata[OFFSET_SIZE-1:0];		// Set Context Saving Offset register
+				end
+				if (setOffsetIsr) begin
+					offsetIsrReg			<= writedata[OFFSET_SIZE-1:0];		// Set ISR Offset register
+				end
+				if (setOffsetContextRestore) begin
+					offsetContextRestoreReg	<= writedata[OFFSET_SIZE-1:0];	// Set Context Restoring Offset register
 				end
 				if (isrHandling) begin
-					isrHandlingReg			<= ept_writedata[0];							// Set Interrupt Service Routin activity
+					isrHandlingReg			<= writedata[0];							// Set Interrupt Service Routin activity
 				end
 				if (contextSaving) begin
-					contextSavingReg		<= ept_writedata[0];							// Set Context Saving activity
+					contextSavingReg		<= writedata[0];							// Set Context Saving activity
 				end	
 				if (contextRestoring) begin
-					contextRestoringReg	<= ept_writedata[0];							// Set Context Restoring activity
+					contextRestoringReg	<= writedata[0];							// Set Context Restoring activity
 				end
 				if (setReset) begin
-					resetReg					<= ept_writedata[0];							// Set Reset register
+					resetReg					<= writedata[0];							// Set Reset register
+				end
+				if (setMode) begin
+					modeReg					<= writedata[0];							// Set Trace mode
+				end
+				if (setPreloadLow) begin
+					counterPreloadReg[DATA_WIDTH-1:0]				<= writedata;				// Set Counter start value
+				end
+				if (setPreloadHigh) begin
+					counterPreloadReg[COUNTER_SIZE-1:DATA_WIDTH]	<= writedata[COUNTER_SIZE-DATA_WIDTH-1:0];
+				end
+				if (setDmaControl) begin
+					dmaControlReg			<= writedata[DMA_CONTROL_SIZE-1:0];
+				end
+				if (setDmaAddress) begin
+					dmaAddressReg			<= {writedata[DATA_WIDTH-1:2], 2'b00};
+				end
+				if (setDmaPeriod) begin
+					dmaPeriodReg			<= writedata;
+				end
+				if (setFillRange) begin
+					fillFirstReg			<= writedata[ADDRESS_WIDTH-2:0];
+					fillLastReg				<= writedata[DATA_WIDTH/2 +: ADDRESS_WIDTH-1];
+				end
+				if (histClear) begin
+					histEnableReg			<= writedata[DATA_WIDTH-1];
+					histShiftReg			<= writedata[12:8];
+					histLog2Reg				<= writedata[0];
+				end
+				if (setHistSelectLow) begin
+					histSelectReg[DATA_WIDTH-1:0]				<= writedata;
+				end
+				if (setHistSelectHigh) begin
+					histSelectReg[2*DATA_WIDTH-1:DATA_WIDTH]	<= writedata;
+				end
+				if (setHistAddress) begin
+					histAddressReg			<= writedata[HIST_SIZE+2:0];
+				end
+				if (setBudgetIndex) begin
+					budgetIndexReg			<= writedata[RAM_ADDRESS_WIDTH-1:0];
+				end
+				if (sampleClear) begin
+					sampleEnableReg		<= writedata[DATA_WIDTH-1];
+					sampleDitherReg		<= writedata[3:0];
+				end
+				if (setSamplePeriod) begin
+					samplePeriodReg		<= writedata;
 				end
+				if (setSampleAddress) begin
+					sampleAddressReg		<= writedata[RAM_ADDRESS_WIDTH-1:0];
+				end
+				if (setTriggerControl) begin
+					triggerPreReg			<= writedata[29];
+					triggerStopModeReg	<= writedata[6:4];
+					triggerStartModeReg	<= writedata[2:0];
+				end
+				if (setTriggerStart) begin
+					triggerStartValueReg	<= writedata;
+				end
+				if (setTriggerStop) begin
+					triggerStopValueReg	<= writedata;
+				end
+				if (setTriggerPre) begin
+					triggerKeepReg			<= writedata[TRACE_SIZE:0];
+				end
+			end
+			// RAM fill: one record per cycle from the record of the first word to the record of the last one
+			if (fillStart) begin
+				fillBusyReg				<= 1'b1;
+				fillFrozenReg			<= ~ready;
+				fillAddressReg			<= fillFirstReg[ADDRESS_WIDTH-2:RECORD_SIZE];
+				fillDataReg				<= writedata;
+			end
+			else if (fillActive) begin
+				fillAddressReg			<= fillAddressReg + 1'b1;
+				if (fillAddressReg == fillLastReg[ADDRESS_WIDTH-2:RECORD_SIZE]) begin
+					fillBusyReg			<= 1'b0;
+				end
+			end
+			// Readout period: ept_clock cycles while measuring
+			dmaTimerReg					<= (dmaTimerRun & ~dmaPeriodTick) ? dmaTimerReg + 1'b1 : 0;
+			// Registered read path: RAM fields are selected from the RAM output at the next cycle
+			ramReadReg					<= read & ramDirectAccess;
+			ramFrozenReadReg			<= read & ramFrozenAccess;
+			if (read) begin
+				readdataReg				<= readdataNext;
+				ramFieldReg				<= ramField;
+			end
+			// A task ID write at the resume cycle wins, ept.v compares it with the resumed task at the next cycle
+			if (taskResume & ~setTaskID & ~setTaskSwitch) begin
+				taskIDReg					<= {1'b1, taskResumeID};									// The suspended task runs again
+			end
+			// Counter snapshot: the HI word is latched with the LO word, a following HI read cannot see a carry
+			if (read & (address == MM_COUNTER_LO)) begin
+				counterHighReg			<= counterData[COUNTER_SIZE-1:DATA_WIDTH];
+			end
+			// Histogram readout: the next bucket
+			if (read & (address == MM_HIST_DATA)) begin
+				histAddressReg			<= histAddressReg + 1'b1;
+			end
+			// Sample readout: the next record
+			if (read & (address == MM_SAMPLE_HITS)) begin
+				sampleAddressReg		<= sampleAddressReg + 1'b1;
+			end
+			// Bank swap: requested now or armed to the next IRQ, never inside a record update
+			ircReg						<= ept_irc;
+			if (setSwap) begin
+				swapPendingReg			<= writedata[0];
+				swapArmedReg			<= writedata[1];
+			end
+			else if (swapTick) begin
+				bankReg					<= ~bankReg;
+				swapPendingReg			<= 1'b0;
+			end
+			else if (swapArmedReg & ept_irc & ~ircReg) begin
+				swapPendingReg			<= 1'b1;
+				swapArmedReg			<= 1'b0;
+			end
+			else if (dmaEnable & ~dmaTrace & (dmaStopTick | dmaPeriodTick)) begin
+				swapPendingReg			<= 1'b1;												// Records are read out at the swap
 			end
 			if (doneTick) begin
 				executedReg <= executedReg + 1;
 			end
+			// Interrupt status: the sources set their bit, a write clears the bits set in the data
+			irqStatusReg				<= (irqStatusReg & ~({IRQ_SOURCES{setIrqStatus}} & writedata[IRQ_SOURCES-1:0])) | irqTicks;
+			if (setIrqMask) begin
+				irqMaskReg				<= writedata[IRQ_SOURCES-1:0];
+			end
+			traceWatermarkReg			<= traceWatermark;
 		end
 	end
 	
+	//----------------------------------
+	// Probe custom instruction: a probe replaces the Avalon write of its register
+	//----------------------------------
+	always @* begin
+		case (ept_probe_select)
+			PROBE_TASK_ID:				probeAddress		= MM_TASK_ID;
+			PROBE_TASK_SWITCH:		probeAddress		= MM_TASK_SWITCH;
+			PROBE_ISR:					probeAddress		= MM_ISR;
+			PROBE_CTX_SAVE:			probeAddress		= MM_CTX_SAVE;
+			default:						probeAddress		= MM_CTX_RESTORE;
+		endcase
+	end
+	assign probeWrite			= ept_probe_valid & (ept_probe_select <= PROBE_CTX_RESTORE);
+	assign address				= (probeWrite) ? probeAddress : ept_address;
+	assign writedata			= (probeWrite) ? ept_probe_data : ept_writedata;
+	assign ept_probe_counter	= counterLow;
+	
 	//----------------------------------
 	// Controller logic
 	//----------------------------------
-	assign write 				= ept_write & ept_chipselect;
-	assign start 				= (ept_address == MM_START);										// Start the EPT
-	assign stop 				= (ept_address == MM_STOP);										// Stop the EPT
-	assign isrHandling		= (ept_address == MM_ISR) & write;
-	assign contextSaving		= (ept_address == MM_CTX_SAVE) & write;
-	assign contextRestoring	= (ept_address == MM_CTX_RESTORE) & write;					
-	assign setTaskID			= (ept_address == MM_TASK_ID) & write;
-	assign setOffset			= (ept_address == MM_OFFSET) & write;
-	assign setReset			= (ept_address == MM_RESET) & write;
+	assign avalonHold			= probeWrite | fillHold;														// The probe owns the register port
+	assign write 				= (ept_write & ept_chipselect & ~avalonHold) | probeWrite;
+	assign read 				= ept_read & ept_chipselect & ~avalonHold;
+	assign start 				= (address == MM_START);										// Start the EPT
+	assign stop 				= (address == MM_STOP);										// Stop the EPT
+	assign isrHandling		= (address == MM_ISR) & write;
+	assign contextSaving		= (address == MM_CTX_SAVE) & write;
+	assign contextRestoring	= (address == MM_CTX_RESTORE) & write;					
+	assign setTaskID			= (address == MM_TASK_ID) & write;
+	assign setTaskSwitch		= (address == MM_TASK_SWITCH) & write;
+	assign setOffset			= (address == MM_OFFSET) & write;
+	assign setOffsetIr		= (address == MM_OFFSET_IR) & write;
+	assign setOffsetContextSave	= (address == MM_OFFSET_CTX_SAVE) & write;
+	assign setOffsetIsr		= (address == MM_OFFSET_ISR) & write;
+	assign setOffsetContextRestore	= (address == MM_OFFSET_CTX_REST) & write;
+	assign setReset			= (address == MM_RESET) & write;
+	assign setMode				= (address == MM_MODE) & write;
+	assign traceClear			= ((address == MM_TRACE_LEVEL) & write) | (ready & measureStart);	// Flush on command and at measurement start
+	assign tracePop			= ((address == MM_TRACE_DATA) & read) | dmaTracePop;						// Single cycle read transfer
+	assign setSwap				= (address == MM_SWAP) & write;
+	assign lostClear			= (address == MM_LOST_EVENTS) & write;
+	assign preemptClear		= (address == MM_PREEMPT) & write;
+	assign histClear			= (address == MM_HIST_LAYOUT) & write;
+	assign setHistSelectLow	= (address == MM_HIST_SELECT_LO) & write;
+	assign setHistSelectHigh	= (address == MM_HIST_SELECT_HI) & write;
+	assign setHistAddress	= (address == MM_HIST_ADDRESS) & write;
+	assign setBudgetIndex	= (address == MM_BUDGET_INDEX) & write;
+	assign setBudget			= (address == MM_BUDGET) & write;
+	assign setOverruns		= (address == MM_OVERRUNS) & write;
+	assign overrunClear		= (address == MM_OVERRUN_FIRST) & write;
+	assign sampleClear		= (address == MM_SAMPLE_CONTROL) & write;
+	assign setSamplePeriod	= (address == MM_SAMPLE_PERIOD) & write;
+	assign setSampleAddress	= (address == MM_SAMPLE_ADDRESS) & write;
+	assign setTriggerControl	= (address == MM_TRIGGER_CONTROL) & write;
+	assign setTriggerStart	= (address == MM_TRIGGER_START) & write;
+	assign setTriggerStop	= (address == MM_TRIGGER_STOP) & write;
+	assign setTriggerPre		= (address == MM_TRIGGER_PRE) & write;
+	assign triggerArm			= setTriggerControl & writedata[DATA_WIDTH-1];
+	assign triggerDisarm		= setTriggerControl & ~writedata[DATA_WIDTH-1];
+	assign triggerPre			= (setTriggerControl) ? writedata[29] : triggerPreReg;				// Written together with the arm
+	assign probeTaskStart	= (setTaskID & writedata[TASK_ID_SIZE-1]) | setTaskSwitch;
+	assign irqEdge				= ept_irc & ~ircReg;
+	assign measureStart		= startReg | triggerStart;												// Software or trigger start
+	assign measureStop		= stopReg | triggerStop;
+	assign setPreloadLow		= (address == MM_COUNTER_LO) & write;
+	assign setPreloadHigh	= (address == MM_COUNTER_HI) & write;
+	assign swapTick			= swapPendingReg & ~ramBusy & ~dmaBusy & ~fillBusyReg;
+	assign setIrqStatus		= (address == MM_IRQ_STATUS) & write;
+	assign setIrqMask			= (address == MM_IRQ_MASK) & write;
+	assign traceWatermark	= (traceLevel >= (1 << (TRACE_SIZE-1)));												// Half of the ring buffer is filled
+	assign irqTicks			= {overrunTick, dmaDoneTick, swapTick & ~setSwap, traceWatermark & ~traceWatermarkReg, accumulatorWarn, doneTick};
+	assign setDmaControl		= (address == MM_DMA_CONTROL) & write;
+	assign setDmaAddress		= (address == MM_DMA_ADDRESS) & write;
+	assign setDmaPeriod		= (address == MM_DMA_PERIOD) & write;
+	assign dmaEnable			= dmaControlReg[0];
+	assign dmaAtStop			= dmaControlReg[1];
+	assign dmaTrace			= dmaControlReg[2];
+	assign dmaTimerRun		= ~ready & dmaEnable & (dmaPeriodReg != 0);
+	assign dmaPeriodTick		= dmaTimerRun & (dmaTimerReg == dmaPeriodReg - 1'b1);
+	assign dmaStopTick		= dmaAtStop & doneTick;
+	assign dmaStart			= dmaEnable & ((dmaTrace) ? (dmaStopTick | dmaPeriodTick) : (swapTick & ~setSwap));
+	assign setFillRange		= (address == MM_FILL_RANGE) & write;
+	assign fillStart			= (address == MM_FILL) & write & ~fillBusyReg & (fillFirstReg <= fillLastReg);
+	assign fillStall			= fillFrozenReg & dmaBusy;															// The DMA owns the frozen bank port
+	assign fillActive			= fillBusyReg & ~fillStall;
+	assign fillFrozen			= fillBusyReg & fillFrozenReg;
+	assign fillHold			= fillBusyReg & ~ept_address[ADDRESS_WIDTH-1];								// The fill owns the RAM ports
+	
+	// Fill byte enables: the fields of the record within the word range
+	always @* begin
+		for (f=0; f<(1<<RECORD_SIZE); f=f+1) begin
+			fillByteEnable[f*FIELD_BYTES +: FIELD_BYTES]	= {FIELD_BYTES{(({fillAddressReg, {RECORD_SIZE{1'b0}}} + f) >= fillFirstReg) &
+																					(({fillAddressReg, {RECORD_SIZE{1'b0}}} + f) <= fillLastReg)}};
+		end
+	end
 	assign reset				= (ept_reset | resetReg);											// Generate module reset from global OR command reset
 	
 	//----------------------------------
 	// I/O Assignments
 	//----------------------------------
 	// RAM Interfacing
-	assign ramDirectAccess				= ready & ~start & ~ept_address[ADDRESS_WIDTH-1];												// Direct RAM Access decoder
-	assign ept_ramaddress_exp			= (ramDirectAccess) ? ept_address[RAM_ADDRESS_WIDTH-1:0] : ramAddress;
-	assign ept_ramwritedata_exp		= (ramDirectAccess) ? ept_writedata : ramWriteData;
-	assign ept_ramwrite_exp				= (ramDirectAccess) ? write : ramWrite;
+	assign ramDirectAccess				= ready & ~start & ~address[ADDRESS_WIDTH-1];												// Direct RAM Access decoder
+	assign ramField						= address[RECORD_SIZE-1:0];																		// Word of the task record
+	assign ramReadField					= ept_ramreaddata_exp[ramFieldReg*DATA_WIDTH +: DATA_WIDTH];
+	assign ramFieldEnable				= {{(RECORD_BYTES-FIELD_BYTES){1'b0}}, {FIELD_BYTES{1'b1}}} << (ramField*FIELD_BYTES);
+	assign ept_ramaddress_exp			= (fillBusyReg & ~fillFrozenReg) ? {bankReg, fillAddressReg} :
+												  (ramDirectAccess) ? {bankReg, address[ADDRESS_WIDTH-2:RECORD_SIZE]} : {bankReg, ramAddress};
+	assign ept_ramwriteaddress_exp	= (fillBusyReg & ~fillFrozenReg) ? {bankReg, fillAddressReg} :
+												  (ramDirectAccess) ? {bankReg, address[ADDRESS_WIDTH-2:RECORD_SIZE]} : {bankReg, ramWriteAddress};
+	assign ept_ramwritedata_exp		= (fillBusyReg & ~fillFrozenReg) ? {(1 << RECORD_SIZE){fillDataReg}} :
+												  (ramDirectAccess) ? {(1 << RECORD_SIZE){writedata}} : ramWriteData;				// Replicated, the byte enables select the field
+	assign ept_rambyteenable_exp		= (fillBusyReg & ~fillFrozenReg) ? fillByteEnable :
+												  (ramDirectAccess) ? ramFieldEnable : {RECORD_BYTES{1'b1}};
+	assign ept_ramwrite_exp				= (fillBusyReg & ~fillFrozenReg) ? 1'b1 :
+												  (ramDirectAccess) ? write : ramWrite;
+	// Frozen bank is accessible while measuring
+	assign ramFrozenAccess				= ~ready & ~address[ADDRESS_WIDTH-1];
+	assign ramFrozenField				= ept_ramreaddata_b_exp[ramFieldReg*DATA_WIDTH +: DATA_WIDTH];
+	assign ept_ramaddress_b_exp		= (dmaBusy) ? {~bankReg, dmaRamAddress} :
+												  (fillFrozen) ? {~bankReg, fillAddressReg} : {~bankReg, address[ADDRESS_WIDTH-2:RECORD_SIZE]};
+	assign ept_ramwritedata_b_exp		= (dmaBusy) ? {RECORD_WIDTH{1'b0}} :
+												  (fillFrozen) ? {(1 << RECORD_SIZE){fillDataReg}} : {(1 << RECORD_SIZE){writedata}};
+	assign ept_rambyteenable_b_exp	= (dmaBusy) ? {RECORD_BYTES{1'b1}} :
+												  (fillFrozen) ? fillByteEnable : ramFieldEnable;
+	assign ept_ramwrite_b_exp			= (dmaBusy) ? dmaRamClear :
+												  (fillFrozen) ? 1'b1 : ramFrozenAccess & write;
 	assign ept_status						= ready;
-	// Avalon MM Readdata decoding
-	assign ept_readdata 					= (ramDirectAccess) ? ept_ramreaddata_exp :
-												  (ept_address == MM_COUNTER_LO) ? counterLow :
-												  (ept_address == MM_COUNTER_HI) ? counterHigh :
-												  (ept_address == MM_READY) ? {{(DATA_WIDTH-1){1'b0}}, ready} :
-												  (ept_address == MM_START) ? {{(DATA_WIDTH-1){1'b0}}, startReg} :
-												  (ept_address == MM_STOP) ? {{(DATA_WIDTH-1){1'b0}}, stopReg} :
-												  (ept_address == MM_TASK_ID) ? {{(DATA_WIDTH-TASK_ID_SIZE){1'b0}}, taskIDReg} :
-												  (ept_address == MM_OFFSET) ? {{(DATA_WIDTH-OFFSET_SIZE){1'b0}}, offsetReg} :
-												  (ept_address == MM_ISR) ? {{(DATA_WIDTH-1){1'b0}}, isrHandlingReg} :
-												  (ept_address == MM_CTX_SAVE) ? {{(DATA_WIDTH-1){1'b0}}, contextSavingReg} :
-												  (ept_address == MM_CTX_RESTORE) ? {{(DATA_WIDTH-TASK_ID_SIZE){1'b0}}, contextRestoringReg} :
-												  (ept_address == MM_EXECUTED) ? {{(DATA_WIDTH-1){1'b0}}, executedReg} :
-												  (ept_address == MM_RESET) ? {{(DATA_WIDTH-1){1'b0}}, resetReg} : 0;
+	assign ept_waitrequest				= ept_chipselect & avalonHold;																// Transfers wait for the probe and the fill
+	assign ept_irq							= |(irqStatusReg & irqMaskReg);
+	// Avalon MM Readdata: fixed latency of one cycle, the RAM fields come from the registered RAM output
+	assign ept_readdata 					= (ramReadReg) ? ramReadField :
+												  (ramFrozenReadReg) ? ramFrozenField : readdataReg;
+	// Register block readdata sources, ordered by the register offset
+	assign readRegisters					= {{(2*DATA_WIDTH-COUNTER_SIZE){1'b0}}, triggerTime,
+												   {(DATA_WIDTH-TRACE_SIZE-1){1'b0}}, triggerKeepReg,
+												   triggerStopValueReg,
+												   triggerStartValueReg,
+												   triggerArmed, triggerFired, triggerPreReg, {(DATA_WIDTH-10){1'b0}}, triggerStopModeReg, 1'b0, triggerStartModeReg,
+												   sampleIdle,
+												   sampleHits,
+												   {(DATA_WIDTH-RAM_ADDRESS_WIDTH){1'b0}}, sampleAddressReg,
+												   samplePeriodReg,
+												   sampleEnableReg, sampleBusy, {(DATA_WIDTH-6){1'b0}}, sampleDitherReg,
+												   {(2*DATA_WIDTH-COUNTER_SIZE){1'b0}}, overrunTime,
+												   overrunValid, {(DATA_WIDTH-RAM_ADDRESS_WIDTH-1){1'b0}}, overrunAddress,
+												   overrunsData,
+												   budgetData,
+												   {(DATA_WIDTH-RAM_ADDRESS_WIDTH){1'b0}}, budgetIndexReg,
+												   histReadData,
+												   {(DATA_WIDTH-HIST_SIZE-3){1'b0}}, histAddressReg,
+												   histSelectReg,
+												   histEnableReg, histBusy, {(DATA_WIDTH-15){1'b0}}, histShiftReg, 7'b0, histLog2Reg,
+												   preemptOverflow, {(DATA_WIDTH-6){1'b0}}, preemptLevel,
+												   {(DATA_WIDTH-1){1'b0}}, fillBusyReg,
+												   {(DATA_WIDTH/2-ADDRESS_WIDTH+1){1'b0}}, fillLastReg, {(DATA_WIDTH/2-ADDRESS_WIDTH+1){1'b0}}, fillFirstReg,
+												   dmaPeriodReg,
+												   dmaAddressReg,
+												   dmaBusy, {(DATA_WIDTH-DMA_CONTROL_SIZE-1){1'b0}}, dmaControlReg,
+												   {(DATA_WIDTH-IRQ_SOURCES){1'b0}}, irqMaskReg,
+												   {(DATA_WIDTH-IRQ_SOURCES){1'b0}}, irqStatusReg,
+												   lostEvents,
+												   {(DATA_WIDTH-OFFSET_SIZE){1'b0}}, offsetContextRestoreReg,
+												   {(DATA_WIDTH-OFFSET_SIZE){1'b0}}, offsetIsrReg,
+												   {(DATA_WIDTH-OFFSET_SIZE){1'b0}}, offsetContextSaveReg,
+												   {(DATA_WIDTH-OFFSET_SIZE){1'b0}}, offsetIrReg,
+												   {(DATA_WIDTH-TASK_ID_SIZE){1'b0}}, taskIDReg,										// Task switch
+												   {(DATA_WIDTH-2){1'b0}}, swapPendingReg | swapArmedReg, bankReg,
+												   traceReadData,																				// Oldest record, popped at the read
+												   traceOverflow, {(DATA_WIDTH-TRACE_SIZE-2){1'b0}}, traceLevel,
+												   {(DATA_WIDTH-1){1'b0}}, modeReg,
+												   {(DATA_WIDTH-1){1'b0}}, resetReg,
+												   {(DATA_WIDTH-1){1'b0}}, executedReg,
+												   {(DATA_WIDTH-1){1'b0}}, contextRestoringReg,
+												   {(DATA_WIDTH-1){1'b0}}, contextSavingReg,
+												   {(DATA_WIDTH-1){1'b0}}, isrHandlingReg,
+												   {(DATA_WIDTH-OFFSET_SIZE){1'b0}}, offsetReg,
+												   {(DATA_WIDTH-TASK_ID_SIZE){1'b0}}, taskIDReg,
+												   {(DATA_WIDTH-1){1'b0}}, stopReg,
+												   {(DATA_WIDTH-1){1'b0}}, startReg,
+												   {(DATA_WIDTH-1){1'b0}}, ready,
+												   {(2*DATA_WIDTH-COUNTER_SIZE){1'b0}}, counterHighReg,
+												   counterLow};
+	// One-hot register select: no select (0) outside the register block and beyond the last register
+	assign readSelect						= (address[ADDRESS_WIDTH-1]) ? {{(REGISTERS-1){1'b0}}, 1'b1} << address[ADDRESS_WIDTH-2:0] : {REGISTERS{1'b0}};
+	
+	// AND-OR readdata multiplexer
+	always @* begin
+		readdataNext							= 0;
+		for (k=0; k<REGISTERS; k=k+1) begin
+			readdataNext						= readdataNext | (readRegisters[k*DATA_WIDTH +: DATA_WIDTH] & {DATA_WIDTH{readSelect[k]}});
+		end
+	end
 	
 	//----------------------------------
 	// Instantiate Task Watcher Module
@@ -186,33 +783,285 @@ module eptAV
 		.DATA_WIDTH(DATA_WIDTH),
 		.RAM_SIZE(RAM_ADDRESS_WIDTH),									
 		.TASK_ID_SIZE(TASK_ID_SIZE),
-		.OFFSET_SIZE(OFFSET_SIZE)
+		.OFFSET_SIZE(OFFSET_SIZE),
+		.RECORD_SIZE(RECORD_SIZE),
+		.RECORD_WIDTH(RECORD_WIDTH),
+		.MEASURE_CLOCK(MEASURE_CLOCK),
+		.PREEMPT_DEPTH(PREEMPT_DEPTH)
 	)
 	ept1
 	(
 		// Clock - Reset
 		.clock_i(ept_clock),
+		.measureClock_i(ept_measure_clock),
 		.reset_i(reset),
 		// RAM Interfacing
 		.ramAddress_o(ramAddress),
+		.ramWriteAddress_o(ramWriteAddress),
 		.ramWriteData_o(ramWriteData),
 		.ramReadData_i(ept_ramreaddata_exp),
 		.ramRead_o(),
 		.ramWrite_o(ramWrite),
+		.ramBusy_o(ramBusy),
 		// Control input
-		.start_i(startReg),
-		.stop_i(stopReg),
+		.start_i(measureStart),
+		.stop_i(measureStop),
 		.taskID_i(taskIDReg),									// Storing the actual task ID -> MSB is the current task activity
+		.taskSwitch_i(taskSwitchReg),							// The running task is stopped, taskID_i is started
 		.offset_i(offsetReg),									// Offset duration of a control write operation
+		.offsetIrLatency_i(offsetIrReg),
+		.offsetContextSave_i(offsetContextSaveReg),
+		.offsetIsr_i(offsetIsrReg),
+		.offsetContextRestore_i(offsetContextRestoreReg),
 		.irqAssert_i(ept_irc),							// Posedge triggering at start
 		.isrHandling_i(isrHandlingReg),						// Posedge triggering at start()(), negedge at stop
 		.contextSave_i(contextSavingReg),  					// Posedge triggering at start()(), negedge at stop
 		.contextRestore_i(contextRestoringReg),				// Posedge triggering at start()(), negedge at stop
+		.traceEnable_i(modeReg),								// Record the detected events
+		.lostClear_i(lostClear),
+		.preemptClear_i(preemptClear),
+		.counterPreload_i(counterPreloadReg),						// Loaded at the start
+		.budget_i(taskBudget),
 		// Data I/O
 		.counterData_o(counterData),
+		.lostEvents_o(lostEvents),
+		.accumulatorWarn_o(accumulatorWarn),
+		.taskResume_o(taskResume),							// The Task ID register follows the resumed task
+		.taskResumeID_o(taskResumeID),
+		.preemptLevel_o(preemptLevel),
+		.preemptOverflow_o(preemptOverflow),
+		.taskAddress_o(taskAddress),
+		.overrunTick_o(overrunTick),
+		.sampleRun_o(sampleRun),
+		.sampleActive_o(sampleActive),
+		.sampleAddress_o(sampleAddress),
+		.eventTick_o(eventTick),
+		.recordUpdate_o(recordUpdate),
+		.recordAddress_o(recordAddress),
+		.recordElapsed_o(recordElapsed),
+		.traceWrite_o(traceWrite),
+		.traceData_o(traceData),
 		// Status output
 		.ready_o(ready),
 		.doneTick_o(doneTick)
 	);
 	
+	//----------------------------------
+	// Instantiate Trace Ring Buffer
+	//----------------------------------
+	trace #(.DATA_WIDTH(DATA_WIDTH), .TRACE_SIZE(TRACE_SIZE)) trace1
+	(
+		// Clock-reset
+		.clock_i(ept_clock),
+		.reset_i(reset),
+		// Control signals
+		.clear_i(traceClear),
+		.write_i(traceWrite),
+		.writeData_i(traceData),
+		.pop_i(tracePop),
+		.retain_i(traceRetain),
+		.keep_i(triggerKeepReg),
+		// Output(s)
+		.readData_o(traceReadData),
+		.level_o(traceLevel),
+		.overflow_o(traceOverflow)
+	);
+	
+	//----------------------------------
+	// Instantiate Readout DMA
+	//----------------------------------
+	generate
+		if (DMA) begin : readout_dma
+			dma #(.DATA_WIDTH(DATA_WIDTH), .RAM_SIZE(RAM_ADDRESS_WIDTH), .RECORD_SIZE(RECORD_SIZE), .TRACE_SIZE(TRACE_SIZE)) dma1
+			(
+				// Clock-reset
+				.clock_i(ept_clock),
+				.reset_i(reset),
+				// Control signals
+				.start_i(dmaStart),
+				.traceSource_i(dmaTrace),
+				.baseAddress_i(dmaAddressReg),
+				// Frozen record bank
+				.ramAddress_o(dmaRamAddress),
+				.ramReadData_i(ept_ramreaddata_b_exp),
+				.ramClear_o(dmaRamClear),
+				// Trace buffer
+				.traceReadData_i(traceReadData),
+				.traceLevel_i(traceLevel),
+				.tracePop_o(dmaTracePop),
+				// Avalon MM master
+				.masterAddress_o(ept_dma_address),
+				.masterWrite_o(ept_dma_write),
+				.masterWriteData_o(ept_dma_writedata),
+				.masterWaitRequest_i(ept_dma_waitrequest),
+				// Status output
+				.busy_o(dmaBusy),
+				.doneTick_o(dmaDoneTick)
+			);
+		end
+		else begin : no_dma
+			assign dmaRamAddress		= 0;
+			assign dmaRamClear		= 1'b0;
+			assign dmaTracePop		= 1'b0;
+			assign dmaBusy				= 1'b0;
+			assign dmaDoneTick		= 1'b0;
+			assign ept_dma_address	= 0;
+			assign ept_dma_write		= 1'b0;
+			assign ept_dma_writedata	= 0;
+		end
+	endgenerate
+	
+	//----------------------------------
+	// Instantiate Latency Histograms
+	//----------------------------------
+	generate
+		if (HISTOGRAM) begin : latency_histogram
+			histogram #(.DATA_WIDTH(DATA_WIDTH), .RAM_SIZE(RAM_ADDRESS_WIDTH), .HIST_SIZE(HIST_SIZE)) histogram1
+			(
+				// Clock-reset
+				.clock_i(ept_clock),
+				.reset_i(reset),
+				// Control signals
+				.enable_i(histEnableReg),
+				.log2_i(histLog2Reg),
+				.shift_i(histShiftReg),
+				.select_i(histSelectReg),
+				.clear_i(histClear),
+				// Record updates
+				.update_i(recordUpdate),
+				.address_i(recordAddress),
+				.elapsed_i(recordElapsed),
+				// Readout
+				.readAddress_i(histAddressReg),
+				.readData_o(histReadData),
+				// Status output
+				.busy_o(histBusy)
+			);
+		end
+		else begin : no_histogram
+			assign histReadData		= 0;
+			assign histBusy			= 1'b0;
+		end
+	endgenerate
+	
+	//----------------------------------
+	// Instantiate Budget Watchdog
+	//----------------------------------
+	generate
+		if (BUDGET) begin : budget_watchdog
+			budget #(.DATA_WIDTH(DATA_WIDTH), .COUNTER_SIZE(COUNTER_SIZE), .RAM_SIZE(RAM_ADDRESS_WIDTH)) budget1
+			(
+				// Clock-reset
+				.clock_i(ept_clock),
+				.reset_i(reset),
+				// Control signals
+				.clear_i(ready & measureStart),
+				.firstClear_i(overrunClear),
+				// Running task
+				.taskAddress_i(taskAddress),
+				.budget_o(taskBudget),
+				.overrunTick_i(overrunTick),
+				.counter_i(counterData),
+				// CPU access
+				.index_i(budgetIndexReg),
+				.budgetWrite_i(setBudget),
+				.overrunsWrite_i(setOverruns),
+				.writeData_i(writedata),
+				.budgetData_o(budgetData),
+				.overrunsData_o(overrunsData),
+				// First overrun
+				.firstValid_o(overrunValid),
+				.firstAddress_o(overrunAddress),
+				.firstTime_o(overrunTime)
+			);
+		end
+		else begin : no_budget
+			assign taskBudget			= 0;										// No overrun tick
+			assign budgetData			= 0;
+			assign overrunsData		= 0;
+			assign overrunValid		= 1'b0;
+			assign overrunAddress	= 0;
+			assign overrunTime		= 0;
+		end
+	endgenerate
+	
+	//----------------------------------
+	// Instantiate Sampling Profiler
+	//----------------------------------
+	generate
+		if (SAMPLING) begin : sampling_profiler
+			sampler #(.DATA_WIDTH(DATA_WIDTH), .RAM_SIZE(RAM_ADDRESS_WIDTH)) sampler1
+			(
+				// Clock-reset
+				.clock_i(ept_clock),
+				.reset_i(reset),
+				// Control signals
+				.enable_i(sampleEnableReg),
+				.period_i(samplePeriodReg),
+				.dither_i(sampleDitherReg),
+				.clear_i(sampleClear),
+				// Running activity
+				.run_i(sampleRun),
+				.active_i(sampleActive),
+				.address_i(sampleAddress),
+				// Readout
+				.readAddress_i(sampleAddressReg),
+				.readData_o(sampleHits),
+				.idle_o(sampleIdle),
+				// Status output
+				.busy_o(sampleBusy)
+			);
+		end
+		else begin : no_sampling
+			assign sampleHits			= 0;
+			assign sampleIdle			= 0;
+			assign sampleBusy			= 1'b0;
+		end
+	endgenerate
+	
+	//----------------------------------
+	// Instantiate Trigger Unit
+	//----------------------------------
+	generate
+		if (TRIGGER) begin : trigger_unit
+			trigger #(.DATA_WIDTH(DATA_WIDTH), .COUNTER_SIZE(COUNTER_SIZE), .TASK_ID_SIZE(TASK_ID_SIZE)) trigger1
+			(
+				// Clock-reset
+				.clock_i(ept_clock),
+				.reset_i(reset),
+				// Control signals
+				.arm_i(triggerArm),
+				.disarm_i(triggerDisarm),
+				.preTrigger_i(triggerPre),
+				.startMode_i(triggerStartModeReg),
+				.stopMode_i(triggerStopModeReg),
+				.startValue_i(triggerStartValueReg),
+				.stopValue_i(triggerStopValueReg),
+				// Conditions
+				.taskStart_i(probeTaskStart),
+				.taskID_i(writedata[TASK_ID_SIZE-2:0]),
+				.irqEdge_i(irqEdge),
+				.event_i(eventTick),
+				.counter_i(counterData),
+				.done_i(doneTick),
+				// Measurement control
+				.start_o(triggerStart),
+				.stop_o(triggerStop),
+				// Status output
+				.retain_o(traceRetain),
+				.armed_o(triggerArmed),
+				.triggered_o(triggerFired),
+				.time_o(triggerTime)
+			);
+		end
+		else begin : no_trigger
+			assign triggerStart		= 1'b0;
+			assign triggerStop		= 1'b0;
+			assign traceRetain		= 1'b0;
+			assign triggerArmed		= 1'b0;
+			assign triggerFired		= 1'b0;
+			assign triggerTime		= 0;
+		end
+	endgenerate
+	
 endmodule
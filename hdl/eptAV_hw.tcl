@@ -0,0 +1,216 @@
+# ===============================================================
+# Execution Performance Tester: Platform Designer component
+# ===============================================================
+# The HDL parameters are exported to the generated system.h as
+#   <INSTANCE>_ADDRESS_WIDTH, <INSTANCE>_RECORD_SIZE, <INSTANCE>_TRACE_SIZE, <INSTANCE>_MEASURE_CLOCK_FREQ,
+#   <INSTANCE>_DMA (only with the readout DMA), <INSTANCE>_PREEMPT_DEPTH,
+#   <INSTANCE>_HISTOGRAM and <INSTANCE>_HIST_SIZE (only with the latency histograms),
+#   <INSTANCE>_BUDGET (only with the budget watchdog), <INSTANCE>_SAMPLING (only with the sampling profiler),
+#   <INSTANCE>_TRIGGER (only with the trigger unit)
+# The probe conduit connects the probe custom instruction (eptCI_hw.tcl, PROBE_CI = 1)
+# The driver (software/driver/ept.h) derives every mask and offset from them,
+# the instance is expected to be named "ept" (EPT_BASE, EPT_ADDRESS_WIDTH, ...)
+
+package require -exact qsys 16.1
+
+# ---------------------------------
+# Module
+# ---------------------------------
+set_module_property NAME eptAV
+set_module_property DISPLAY_NAME "Execution Performance Tester"
+set_module_property DESCRIPTION "Task and exception timing measurement of a NIOSii/e processor"
+set_module_property GROUP "Debug and Performance"
+set_module_property VERSION 1.0
+set_module_property AUTHOR ResLabDev
+set_module_property EDITABLE true
+set_module_property INSTANTIATE_IN_SYSTEM_MODULE true
+set_module_property ELABORATION_CALLBACK elaborate
+
+# ---------------------------------
+# Files
+# ---------------------------------
+add_fileset QUARTUS_SYNTH QUARTUS_SYNTH "" ""
+set_fileset_property QUARTUS_SYNTH TOP_LEVEL eptAV
+add_fileset_file eptAV.v VERILOG PATH eptAV.v TOP_LEVEL_FILE
+add_fileset_file ept.v VERILOG PATH ept.v
+add_fileset_file counter.v VERILOG PATH counter.v
+add_fileset_file timebase.v VERILOG PATH timebase.v
+add_fileset_file trace.v VERILOG PATH trace.v
+add_fileset_file dma.v VERILOG PATH dma.v
+add_fileset_file histogram.v VERILOG PATH histogram.v
+add_fileset_file budget.v VERILOG PATH budget.v
+add_fileset_file sampler.v VERILOG PATH sampler.v
+add_fileset_file trigger.v VERILOG PATH trigger.v
+
+# ---------------------------------
+# Parameters
+# ---------------------------------
+add_parameter ADDRESS_WIDTH INTEGER 11 "Word address width: 2^(ADDRESS_WIDTH-RECORD_SIZE-1) task records"
+set_parameter_property ADDRESS_WIDTH ALLOWED_RANGES 9:16
+set_parameter_property ADDRESS_WIDTH HDL_PARAMETER true
+add_parameter DATA_WIDTH INTEGER 32
+set_parameter_property DATA_WIDTH ALLOWED_RANGES 32
+set_parameter_property DATA_WIDTH HDL_PARAMETER true
+add_parameter COUNTER_SIZE INTEGER 40 "Cycle counter width"
+set_parameter_property COUNTER_SIZE ALLOWED_RANGES 33:64
+set_parameter_property COUNTER_SIZE HDL_PARAMETER true
+add_parameter RECORD_SIZE INTEGER 3 "Words of a task record: 2^RECORD_SIZE"
+set_parameter_property RECORD_SIZE ALLOWED_RANGES 3
+set_parameter_property RECORD_SIZE HDL_PARAMETER true
+add_parameter TRACE_SIZE INTEGER 9 "Trace ring buffer depth: 2^TRACE_SIZE records"
+set_parameter_property TRACE_SIZE ALLOWED_RANGES 4:14
+set_parameter_property TRACE_SIZE HDL_PARAMETER true
+add_parameter MEASURE_CLOCK INTEGER 0 "Cycle counter clock: 0 = clock, 1 = measure_clock (e.g. a faster PLL output)"
+set_parameter_property MEASURE_CLOCK ALLOWED_RANGES {0:clock 1:measure_clock}
+set_parameter_property MEASURE_CLOCK HDL_PARAMETER true
+add_parameter DMA INTEGER 0 "Readout DMA: copies the results into system memory on the dma_master interface"
+set_parameter_property DMA ALLOWED_RANGES {0:off 1:on}
+set_parameter_property DMA HDL_PARAMETER true
+add_parameter PREEMPT_DEPTH INTEGER 4 "Preemption stack depth: suspended tasks, 0 = off"
+set_parameter_property PREEMPT_DEPTH ALLOWED_RANGES 0:16
+set_parameter_property PREEMPT_DEPTH HDL_PARAMETER true
+add_parameter HISTOGRAM INTEGER 0 "Latency histograms: bucket counts of 4 selected tasks and the exception records"
+set_parameter_property HISTOGRAM ALLOWED_RANGES {0:off 1:on}
+set_parameter_property HISTOGRAM HDL_PARAMETER true
+add_parameter HIST_SIZE INTEGER 5 "Buckets of a histogram: 2^HIST_SIZE"
+set_parameter_property HIST_SIZE ALLOWED_RANGES 3:8
+set_parameter_property HIST_SIZE HDL_PARAMETER true
+add_parameter BUDGET INTEGER 0 "Budget watchdog: per-task cycle budgets, overrun counters and the overrun IRQ"
+set_parameter_property BUDGET ALLOWED_RANGES {0:off 1:on}
+set_parameter_property BUDGET HDL_PARAMETER true
+add_parameter SAMPLING INTEGER 0 "Sampling profiler: periodic hit counts of the running task or exception phase"
+set_parameter_property SAMPLING ALLOWED_RANGES {0:off 1:on}
+set_parameter_property SAMPLING HDL_PARAMETER true
+add_parameter TRIGGER INTEGER 0 "Trigger unit: starts and stops the measurement on a task, IRQ, cycle or event condition"
+set_parameter_property TRIGGER ALLOWED_RANGES {0:off 1:on}
+set_parameter_property TRIGGER HDL_PARAMETER true
+add_parameter PROBE_CI INTEGER 0 "Probe custom instruction: eptCI connected to the probe conduit"
+set_parameter_property PROBE_CI ALLOWED_RANGES {0:off 1:on}
+add_parameter CLOCK_RATE LONG 0
+set_parameter_property CLOCK_RATE SYSTEM_INFO {CLOCK_RATE clock}
+set_parameter_property CLOCK_RATE VISIBLE false
+add_parameter MEASURE_CLOCK_RATE LONG 0
+set_parameter_property MEASURE_CLOCK_RATE SYSTEM_INFO {CLOCK_RATE measure_clock}
+set_parameter_property MEASURE_CLOCK_RATE VISIBLE false
+
+# ---------------------------------
+# Interfaces
+# ---------------------------------
+add_interface clock clock end
+add_interface_port clock ept_clock clk Input 1
+
+add_interface reset reset end
+set_interface_property reset associatedClock clock
+set_interface_property reset synchronousEdges DEASSERT
+add_interface_port reset ept_reset reset Input 1
+
+add_interface avalon_slave avalon end
+set_interface_property avalon_slave addressUnits WORDS
+set_interface_property avalon_slave associatedClock clock
+set_interface_property avalon_slave associatedReset reset
+set_interface_property avalon_slave readWaitTime 0
+set_interface_property avalon_slave writeWaitTime 0
+set_interface_property avalon_slave readLatency 1
+add_interface_port avalon_slave ept_address address Input ADDRESS_WIDTH
+add_interface_port avalon_slave ept_writedata writedata Input DATA_WIDTH
+add_interface_port avalon_slave ept_readdata readdata Output DATA_WIDTH
+add_interface_port avalon_slave ept_chipselect chipselect Input 1
+add_interface_port avalon_slave ept_write write Input 1
+add_interface_port avalon_slave ept_read read Input 1
+add_interface_port avalon_slave ept_waitrequest waitrequest Output 1
+
+add_interface measure_clock clock end
+add_interface_port measure_clock ept_measure_clock clk Input 1
+
+add_interface irq interrupt end
+set_interface_property irq associatedAddressablePoint avalon_slave
+set_interface_property irq associatedClock clock
+set_interface_property irq associatedReset reset
+add_interface_port irq ept_irq irq Output 1
+
+add_interface dma_master avalon start
+set_interface_property dma_master addressUnits SYMBOLS
+set_interface_property dma_master associatedClock clock
+set_interface_property dma_master associatedReset reset
+add_interface_port dma_master ept_dma_address address Output DATA_WIDTH
+add_interface_port dma_master ept_dma_write write Output 1
+add_interface_port dma_master ept_dma_writedata writedata Output DATA_WIDTH
+add_interface_port dma_master ept_dma_waitrequest waitrequest Input 1
+
+add_interface irc conduit end
+add_interface_port irc ept_irc irc Input 1
+
+add_interface status conduit end
+add_interface_port status ept_status status Output 1
+
+add_interface probe conduit end
+add_interface_port probe ept_probe_valid valid Input 1
+add_interface_port probe ept_probe_select select Input 3
+add_interface_port probe ept_probe_data data Input DATA_WIDTH
+add_interface_port probe ept_probe_counter counter Output DATA_WIDTH
+
+add_interface ram conduit end
+add_interface ram_b conduit end
+
+# ---------------------------------
+# Elaboration
+# ---------------------------------
+proc elaborate {} {
+	set addressWidth [get_parameter_value ADDRESS_WIDTH]
+	set dataWidth [get_parameter_value DATA_WIDTH]
+	set recordSize [get_parameter_value RECORD_SIZE]
+	set traceSize [get_parameter_value TRACE_SIZE]
+	set measureClock [get_parameter_value MEASURE_CLOCK]
+	set dma [get_parameter_value DMA]
+	set probeCi [get_parameter_value PROBE_CI]
+	set ramAddressWidth [expr {$addressWidth - $recordSize}]
+	set ramDataWidth [expr {$dataWidth << $recordSize}]
+
+	# RAM ports: a record per word, the MSB of the address selects the bank
+	add_interface_port ram ept_ramwriteaddress_exp writeaddress Output $ramAddressWidth
+	foreach {interface suffix} {ram "" ram_b "_b"} {
+		add_interface_port $interface ept_ramaddress${suffix}_exp address${suffix} Output $ramAddressWidth
+		add_interface_port $interface ept_ramwritedata${suffix}_exp writedata${suffix} Output $ramDataWidth
+		add_interface_port $interface ept_ramreaddata${suffix}_exp readdata${suffix} Input $ramDataWidth
+		add_interface_port $interface ept_rambyteenable${suffix}_exp byteenable${suffix} Output [expr {$ramDataWidth / 8}]
+		add_interface_port $interface ept_ramwrite${suffix}_exp write${suffix} Output 1
+	}
+
+	# Measurement clock: the driver converts the counter with its frequency
+	if {$measureClock} {
+		set measureRate [get_parameter_value MEASURE_CLOCK_RATE]
+	} else {
+		set_interface_property measure_clock ENABLED false
+		set measureRate [get_parameter_value CLOCK_RATE]
+	}
+
+	# Driver constants in system.h
+	set_module_assignment embeddedsw.CMacro.ADDRESS_WIDTH $addressWidth
+	set_module_assignment embeddedsw.CMacro.RECORD_SIZE $recordSize
+	set_module_assignment embeddedsw.CMacro.TRACE_SIZE $traceSize
+	set_module_assignment embeddedsw.CMacro.PREEMPT_DEPTH [get_parameter_value PREEMPT_DEPTH]
+	if {$measureRate > 0} {
+		set_module_assignment embeddedsw.CMacro.MEASURE_CLOCK_FREQ $measureRate
+	}
+	if {$dma} {
+		set_module_assignment embeddedsw.CMacro.DMA 1
+	} else {
+		set_interface_property dma_master ENABLED false
+	}
+	if {[get_parameter_value HISTOGRAM]} {
+		set_module_assignment embeddedsw.CMacro.HISTOGRAM 1
+		set_module_assignment embeddedsw.CMacro.HIST_SIZE [get_parameter_value HIST_SIZE]
+	}
+	if {[get_parameter_value BUDGET]} {
+		set_module_assignment embeddedsw.CMacro.BUDGET 1
+	}
+	if {[get_parameter_value SAMPLING]} {
+		set_module_assignment embeddedsw.CMacro.SAMPLING 1
+	}
+	if {[get_parameter_value TRIGGER]} {
+		set_module_assignment embeddedsw.CMacro.TRIGGER 1
+	}
+	if {!$probeCi} {
+		set_interface_property probe ENABLED false
+	}
+}
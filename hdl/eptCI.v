@@ -0,0 +1,73 @@
+//=====================================
+// Probe custom instruction (NIOSii)
+//=====================================
+
+/*** @Brief: ***
+* Multicycle custom instruction with a fixed latency of 1 cycle, connected to eptAV on the probe conduit
+* The probe is presented at the start cycle: the same clock edge as the register write of an Avalon probe,
+* no interconnect and no wait state, the instruction always takes the same number of cycles
+* n selects the probe, dataa is the written data, result is the counter LO word at the start cycle
+*   - 0: Task ID, 1: Task switch, 2: ISR handling, 3: Context saving, 4: Context restoring
+*   - 5: Counter LO read only (no probe)
+****************/
+
+/*** Instantiation ***
+	eptCI #(.DATA_WIDTH(DATA_WIDTH)) eptCI1
+	(
+		// Custom instruction slave
+		.clk(clock),
+		.clk_en(clk_en),
+		.reset(reset),
+		.start(start),
+		.n(3),
+		.dataa(DATA_WIDTH),
+		.result(DATA_WIDTH),
+		// Conduit to eptAV
+		.probeValid_o(),
+		.probeSelect_o(3),
+		.probeData_o(DATA_WIDTH),
+		.probeCounter_i(DATA_WIDTH)
+	);
+*/
+
+module eptCI
+#(
+	parameter
+		DATA_WIDTH		= 32
+)
+(
+	// Custom instruction slave
+	input wire 								clk,									// The clock of eptAV
+	input wire 								clk_en,
+	input wire 								reset,
+	input wire 								start,
+	input wire [2:0]						n,
+	input wire [DATA_WIDTH-1:0]		dataa,
+	output wire [DATA_WIDTH-1:0]		result,
+	// Conduit to eptAV
+	output wire 							probeValid_o,
+	output wire [2:0]						probeSelect_o,
+	output wire [DATA_WIDTH-1:0]		probeData_o,
+	input wire [DATA_WIDTH-1:0]		probeCounter_i
+);
+
+	// Signal declaration
+	reg [DATA_WIDTH-1:0] resultReg;
+
+	// Counter sampled at the start cycle: the result is valid at the fixed latency
+	always @ (posedge clk, posedge reset) begin
+		if (reset) begin
+			resultReg					<= 0;
+		end
+		else if (clk_en & start) begin
+			resultReg					<= probeCounter_i;
+		end
+	end
+
+	// Output assignment
+	assign probeValid_o				= clk_en & start;
+	assign probeSelect_o				= n;
+	assign probeData_o				= dataa;
+	assign result						= resultReg;
+
+endmodule
@@ -0,0 +1,56 @@
+# ===============================================================
+# Execution Performance Tester: probe custom instruction component
+# ===============================================================
+# Connect the custom instruction slave to the NIOSii custom instruction master, the probe conduit
+# to the eptAV probe conduit (eptAV PROBE_CI = 1), both on the clock of eptAV
+# The generated system.h macro is ALT_CI_<INSTANCE>(n, A, B), the instance is expected to be named
+# "ept_ci": the driver (software/driver/driver.h) issues the probes with ALT_CI_EPT_CI when it is defined
+
+package require -exact qsys 16.1
+
+# ---------------------------------
+# Module
+# ---------------------------------
+set_module_property NAME eptCI
+set_module_property DISPLAY_NAME "Execution Performance Tester Probe Instruction"
+set_module_property DESCRIPTION "Fixed latency task and exception probes of a NIOSii/e processor"
+set_module_property GROUP "Debug and Performance"
+set_module_property VERSION 1.0
+set_module_property AUTHOR ResLabDev
+set_module_property EDITABLE true
+set_module_property INSTANTIATE_IN_SYSTEM_MODULE true
+
+# ---------------------------------
+# Files
+# ---------------------------------
+add_fileset QUARTUS_SYNTH QUARTUS_SYNTH "" ""
+set_fileset_property QUARTUS_SYNTH TOP_LEVEL eptCI
+add_fileset_file eptCI.v VERILOG PATH eptCI.v TOP_LEVEL_FILE
+
+# ---------------------------------
+# Parameters
+# ---------------------------------
+add_parameter DATA_WIDTH INTEGER 32
+set_parameter_property DATA_WIDTH ALLOWED_RANGES 32
+set_parameter_property DATA_WIDTH HDL_PARAMETER true
+
+# ---------------------------------
+# Interfaces
+# ---------------------------------
+add_interface probe_ci nios_custom_instruction end
+set_interface_property probe_ci clockCycle 1
+set_interface_property probe_ci clockCycleType Multicycle
+set_interface_property probe_ci operands 1
+add_interface_port probe_ci clk clk Input 1
+add_interface_port probe_ci clk_en clk_en Input 1
+add_interface_port probe_ci reset reset Input 1
+add_interface_port probe_ci start start Input 1
+add_interface_port probe_ci n n Input 3
+add_interface_port probe_ci dataa dataa Input DATA_WIDTH
+add_interface_port probe_ci result result Output DATA_WIDTH
+
+add_interface probe conduit end
+add_interface_port probe probeValid_o valid Output 1
+add_interface_port probe probeSelect_o select Output 3
+add_interface_port probe probeData_o data Output DATA_WIDTH
+add_interface_port probe probeCounter_i counter Input DATA_WIDTH
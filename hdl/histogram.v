@@ -0,0 +1,183 @@
+//=========================================
+// Latency histograms of the record updates
+//=========================================
+
+/*** @Brief: ***
+* Counts the elapsed cycles of every record update of the watched records into 2^HIST_SIZE buckets
+*   - Slots 0-3: the task IDs of select_i {Enable, Task ID} (16 bits each), slots 4-7: the exception records
+*     (IR latency, Context Save, ISR, Context Restore)
+*   - Linear layout: bucket = elapsed >> shift, log2 layout: bucket 0 < 2^shift, bucket b covers
+*     [2^(shift+b-1), 2^(shift+b)), the last bucket collects every longer update
+*   - Update pipeline: bucket select -> RAM read -> increment and write, a back-to-back update of the same
+*     bucket is forwarded, the counts saturate
+*   - clear_i zeroes every bucket (one per cycle, busy_o), updates are not counted meanwhile
+*   - readData_o shows the bucket at readAddress_i, refreshed in the cycles without an update read
+****************/
+
+/*** Instantiation ***
+	histogram #(.DATA_WIDTH(DATA_WIDTH), .RAM_SIZE(RAM_SIZE), .HIST_SIZE(HIST_SIZE)) histogram1
+	(
+		// Clock-reset
+		.clock_i(clock),
+		.reset_i(reset),
+		// Control signals
+		.enable_i(enable),
+		.log2_i(log2),							// 0: linear, 1: log2 buckets
+		.shift_i(5),							// Bucket width (linear) or first bucket bound (log2): 2^shift cycles
+		.select_i(4 * 16),						// {Enable, Task ID} of the task slots 3-0
+		.clear_i(clear),
+		// Record updates
+		.update_i(update),
+		.address_i(RAM_SIZE),					// Record of the update
+		.elapsed_i(DATA_WIDTH),				// Saturated elapsed cycles
+		// Readout
+		.readAddress_i(HIST_SIZE + 3),			// {Slot, Bucket}
+		.readData_o(DATA_WIDTH),
+		// Status output
+		.busy_o()								// Clear in progress
+	);
+*/
+
+module histogram
+#(
+	parameter
+		DATA_WIDTH		= 32,
+		RAM_SIZE			= 7,										// Address width of a result bank
+		HIST_SIZE		= 5										// Buckets of a slot: 2^HIST_SIZE
+)
+(
+	// Clock-reset
+	input wire 								clock_i,
+	input wire 								reset_i,
+	// Control signals
+	input wire 								enable_i,
+	input wire 								log2_i,
+	input wire [4:0]						shift_i,
+	input wire [63:0]						select_i,
+	input wire 								clear_i,
+	// Record updates
+	input wire 								update_i,
+	input wire [RAM_SIZE-1:0]			address_i,
+	input wire [DATA_WIDTH-1:0]		elapsed_i,
+	// Readout
+	input wire [HIST_SIZE+2:0]			readAddress_i,
+	output reg [DATA_WIDTH-1:0]		readData_o,
+	// Status output
+	output wire 							busy_o
+);
+
+	localparam
+		INDEX_SIZE					= HIST_SIZE + 3,							// {Slot, Bucket}
+		RESERVED_PARAMETER_SIZE	= 4;
+	localparam [HIST_SIZE-1:0] BUCKET_MAX = ~('b0);
+	localparam [DATA_WIDTH-1:0] COUNT_MAX = ~('b0);
+	localparam [RAM_SIZE-1:0] RAM_ADDRESS_RESERVED = ~('b0) - RESERVED_PARAMETER_SIZE + 1;
+
+	// Signal declaration
+	reg [DATA_WIDTH-1:0] histRam [0:(1<<INDEX_SIZE)-1];
+	reg [DATA_WIDTH-1:0] ramReadDataReg, forwardDataReg;
+	reg [INDEX_SIZE-1:0] readIndexReg, writeIndexReg, clearIndexReg;
+	reg readValidReg, writeValidReg, forwardReg, readoutReg, clearReg;
+	reg [2:0] slot;
+	reg slotHit;
+	reg [HIST_SIZE-1:0] bucket;
+	reg [DATA_WIDTH-1:0] scaled;
+	wire [DATA_WIDTH-1:0] count, countNext;
+	wire [INDEX_SIZE-1:0] ramReadIndex;
+	integer i, b;
+
+	// Slot of the updated record: a selected task ID or an exception record
+	always @* begin
+		slot							= 3'd0;
+		slotHit						= 1'b0;
+		if (address_i >= RAM_ADDRESS_RESERVED) begin
+			slot						= 3'd4 + (address_i - RAM_ADDRESS_RESERVED);
+			slotHit					= 1'b1;
+		end
+		else begin
+			for (i=3; i>=0; i=i-1) begin
+				if (select_i[i*16+15] & (select_i[i*16 +: 15] == address_i)) begin
+					slot				= i;
+					slotHit			= 1'b1;
+				end
+			end
+		end
+	end
+
+	// Bucket of the elapsed cycles
+	always @* begin
+		scaled						= elapsed_i >> shift_i;
+		bucket						= 0;
+		if (~log2_i) begin
+			bucket					= (scaled > BUCKET_MAX) ? BUCKET_MAX : scaled[HIST_SIZE-1:0];
+		end
+		else begin
+			for (b=0; b<DATA_WIDTH; b=b+1) begin
+				if (scaled[b]) begin
+					bucket			= (b + 1 > BUCKET_MAX) ? BUCKET_MAX : b + 1;		// Highest set bit
+				end
+			end
+		end
+	end
+
+	// Bucket memory: the update read has priority over the readout on the read port
+	always @ (posedge clock_i) begin
+		if (clearReg) begin
+			histRam[clearIndexReg]		<= 0;
+		end
+		else if (writeValidReg) begin
+			histRam[writeIndexReg]		<= countNext;
+		end
+		ramReadDataReg					<= histRam[ramReadIndex];
+	end
+
+	always @ (posedge clock_i, posedge reset_i) begin
+		if (reset_i) begin
+			readIndexReg				<= 0;
+			readValidReg				<= 0;
+			writeIndexReg				<= 0;
+			writeValidReg				<= 0;
+			forwardReg					<= 0;
+			forwardDataReg				<= 0;
+			readoutReg					<= 0;
+			clearReg						<= 0;
+			clearIndexReg				<= 0;
+			readData_o					<= 0;
+		end
+		else begin
+			// Bucket select -> RAM read
+			readIndexReg				<= {slot, bucket};
+			readValidReg				<= update_i & slotHit & enable_i & ~clearReg;
+			// RAM read -> increment and write, the bucket written at the read edge is forwarded
+			writeIndexReg				<= readIndexReg;
+			writeValidReg				<= readValidReg;
+			forwardReg					<= writeValidReg & (writeIndexReg == readIndexReg);
+			forwardDataReg				<= countNext;
+			// Readout: the read port served the readout address at the previous cycle
+			readoutReg					<= ~readValidReg;
+			if (readoutReg) begin
+				readData_o				<= ramReadDataReg;
+			end
+			// Clear sweep
+			if (clear_i) begin
+				clearReg					<= 1'b1;
+				clearIndexReg			<= 0;
+			end
+			else if (clearReg) begin
+				clearIndexReg			<= clearIndexReg + 1'b1;
+				if (&clearIndexReg) begin
+					clearReg				<= 1'b0;
+				end
+			end
+		end
+	end
+
+	// Control logic
+	assign ramReadIndex				= (readValidReg) ? readIndexReg : readAddress_i;
+	assign count						= (forwardReg) ? forwardDataReg : ramReadDataReg;
+	assign countNext					= (count == COUNT_MAX) ? COUNT_MAX : count + 1'b1;		// Saturated
+
+	// Output assignment
+	assign busy_o						= clearReg;
+
+endmodule
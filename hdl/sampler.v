@@ -0,0 +1,159 @@
+//=========================================
+// Statistical sampling profiler
+//=========================================
+
+/*** @Brief: ***
+* Takes a snapshot of the running activity every sampling interval and counts the hits per record address
+*   - Snapshot: address_i is the running task or the exception record of the current phase (active_i),
+*     a sample without a task and an exception is counted by idle_o
+*   - Interval: period_i + a pseudo-random dither of dither_i bits (16 bit Galois LFSR, stepped at each sample),
+*     at least PERIOD_MIN cycles, the dither avoids the aliasing with a periodic timer interrupt
+*   - Samples are taken while run_i (measuring), the counts saturate
+*   - Update pipeline: sample -> RAM read -> increment and write (the interval covers the pipeline)
+*   - clear_i zeroes every count and the idle count (one address per cycle, busy_o), no sample is taken meanwhile
+*   - readData_o shows the count at readAddress_i, refreshed in the cycles without an update read
+****************/
+
+/*** Instantiation ***
+	sampler #(.DATA_WIDTH(DATA_WIDTH), .RAM_SIZE(RAM_SIZE)) sampler1
+	(
+		// Clock-reset
+		.clock_i(clock),
+		.reset_i(reset),
+		// Control signals
+		.enable_i(enable),
+		.period_i(DATA_WIDTH),					// Sampling interval in clock_i cycles
+		.dither_i(4),							// Dither bits added to the interval (0: fixed interval)
+		.clear_i(clear),
+		// Running activity
+		.run_i(run),							// Measurement in progress
+		.active_i(active),						// A task or an exception runs
+		.address_i(RAM_SIZE),					// Record address of the running activity
+		// Readout
+		.readAddress_i(RAM_SIZE),
+		.readData_o(DATA_WIDTH),
+		.idle_o(DATA_WIDTH),
+		// Status output
+		.busy_o()								// Clear in progress
+	);
+*/
+
+module sampler
+#(
+	parameter
+		DATA_WIDTH		= 32,
+		RAM_SIZE			= 7										// Address width of a result bank
+)
+(
+	// Clock-reset
+	input wire 								clock_i,
+	input wire 								reset_i,
+	// Control signals
+	input wire 								enable_i,
+	input wire [DATA_WIDTH-1:0]		period_i,
+	input wire [3:0]						dither_i,
+	input wire 								clear_i,
+	// Running activity
+	input wire 								run_i,
+	input wire 								active_i,
+	input wire [RAM_SIZE-1:0]			address_i,
+	// Readout
+	input wire [RAM_SIZE-1:0]			readAddress_i,
+	output reg [DATA_WIDTH-1:0]		readData_o,
+	output reg [DATA_WIDTH-1:0]		idle_o,
+	// Status output
+	output wire 							busy_o
+);
+
+	localparam PERIOD_MIN = 4;
+	localparam [15:0]
+		LFSR_SEED		= 16'hace1,
+		LFSR_TAPS		= 16'hb400;											// x^16 + x^14 + x^13 + x^11 + 1
+	localparam [DATA_WIDTH-1:0] COUNT_MAX = ~('b0);
+
+	// Signal declaration
+	reg [DATA_WIDTH-1:0] hitRam [0:(1<<RAM_SIZE)-1];
+	reg [DATA_WIDTH-1:0] ramReadDataReg, intervalReg;
+	reg [RAM_SIZE-1:0] readIndexReg, writeIndexReg, clearIndexReg;
+	reg readValidReg, writeValidReg, readoutReg, clearReg;
+	reg [15:0] lfsrReg;
+	wire [DATA_WIDTH-1:0] countNext, interval, dither;
+	wire [RAM_SIZE-1:0] ramReadIndex;
+	wire sampleTick;
+
+	// Hit memory: the update read has priority over the readout on the read port
+	always @ (posedge clock_i) begin
+		if (clearReg) begin
+			hitRam[clearIndexReg]			<= 0;
+		end
+		else if (writeValidReg) begin
+			hitRam[writeIndexReg]			<= countNext;
+		end
+		ramReadDataReg						<= hitRam[ramReadIndex];
+	end
+
+	always @ (posedge clock_i, posedge reset_i) begin
+		if (reset_i) begin
+			intervalReg						<= 0;
+			lfsrReg							<= LFSR_SEED;
+			readIndexReg					<= 0;
+			readValidReg					<= 0;
+			writeIndexReg					<= 0;
+			writeValidReg					<= 0;
+			readoutReg						<= 0;
+			clearReg							<= 0;
+			clearIndexReg					<= 0;
+			readData_o						<= 0;
+			idle_o							<= 0;
+		end
+		else begin
+			// Sampling interval: the next one is drawn at each sample
+			if (~(enable_i & run_i) | clearReg | sampleTick) begin
+				intervalReg					<= interval - 1'b1;
+			end
+			else begin
+				intervalReg					<= intervalReg - 1'b1;
+			end
+			if (sampleTick) begin
+				lfsrReg						<= (lfsrReg >> 1) ^ (lfsrReg[0] ? LFSR_TAPS : 16'h0);
+			end
+			// Sample -> RAM read
+			readIndexReg					<= address_i;
+			readValidReg					<= sampleTick & active_i;
+			// RAM read -> increment and write
+			writeIndexReg					<= readIndexReg;
+			writeValidReg					<= readValidReg;
+			if (sampleTick & ~active_i & (idle_o != COUNT_MAX)) begin
+				idle_o						<= idle_o + 1'b1;
+			end
+			// Readout: the read port served the readout address at the previous cycle
+			readoutReg						<= ~readValidReg;
+			if (readoutReg) begin
+				readData_o					<= ramReadDataReg;
+			end
+			// Clear sweep
+			if (clear_i) begin
+				clearReg						<= 1'b1;
+				clearIndexReg				<= 0;
+				idle_o						<= 0;
+			end
+			else if (clearReg) begin
+				clearIndexReg				<= clearIndexReg + 1'b1;
+				if (&clearIndexReg) begin
+					clearReg					<= 1'b0;
+				end
+			end
+		end
+	end
+
+	// Control logic
+	assign sampleTick						= enable_i & run_i & ~clearReg & (intervalReg == 0);
+	assign dither							= {{(DATA_WIDTH-16){1'b0}}, lfsrReg & ~(16'hffff << dither_i)};
+	assign interval						= ((period_i < PERIOD_MIN) ? PERIOD_MIN : period_i) + dither;
+	assign ramReadIndex					= (readValidReg) ? readIndexReg : readAddress_i;
+	assign countNext						= (ramReadDataReg == COUNT_MAX) ? COUNT_MAX : ramReadDataReg + 1'b1;		// Saturated
+
+	// Output assignment
+	assign busy_o							= clearReg;
+
+endmodule
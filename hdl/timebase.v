@@ -0,0 +1,145 @@
+//===================================================
+// Measurement time base with optional clock crossing
+//===================================================
+
+/*** @Brief: ***
+* Cycle counter of the measurement: clear_i restarts it from preload_i, it counts while enable_i is set
+* MEASURE_CLOCK = 0: counter.v on clock_i, the time unit is a clock_i cycle
+* MEASURE_CLOCK = 1: a free running counter on measureClock_i (e.g. a faster PLL output) crosses to
+* clock_i in Gray code through a 2-FF synchronizer, the time unit is a measureClock_i cycle
+*   - A single bit changes at each measureClock_i edge: a sample caught during the change resolves
+*     to the previous or to the next count, never to a wrong one
+*   - The crossing latency is constant and cancels in every measured difference
+*   - clear_i stores the sampled count less preload_i as the base, no control signal crosses to measureClock_i
+****************/
+
+/*** Instantiation ***
+	timebase #(.COUNTER_SIZE(COUNTER_SIZE), .MEASURE_CLOCK(MEASURE_CLOCK)) timebase1
+	(
+		// Clock-reset
+		.clock_i(clock),
+		.measureClock_i(measureClock),		// Unused at MEASURE_CLOCK = 0
+		.reset_i(reset),
+		// Control signals
+		.clear_i(clear),						// Restart from preload_i
+		.enable_i(enable),
+		.preload_i(COUNTER_SIZE),				// Start value, e.g. below a wrap boundary for a self-test
+		// Output(s)
+		.counterOut_o(COUNTER_SIZE)			// Elapsed measurement clock cycles in the clock_i domain
+	);
+*/
+
+module timebase
+#(
+	parameter
+		COUNTER_SIZE	= 40,
+		MEASURE_CLOCK	= 0										// 0: count clock_i, 1: count measureClock_i
+)
+(
+	// Clock-reset
+	input wire 								clock_i,
+	input wire 								measureClock_i,
+	input wire 								reset_i,
+	// Control signals
+	input wire 								clear_i,
+	input wire 								enable_i,
+	input wire	[COUNTER_SIZE-1:0]	preload_i,
+	// Output(s)
+	output wire	[COUNTER_SIZE-1:0]	counterOut_o
+);
+
+	generate
+		if (MEASURE_CLOCK == 0) begin : bus_clock
+			// Instantiate Counter: loaded with the preload at the clear
+			counter #(.COUNTER_SIZE(COUNTER_SIZE)) counter1
+			(
+				// Clock-reset
+				.clock_i(clock_i),
+				.reset_i(reset_i),
+				// Control signals
+				.enable_i(enable_i),
+				.load_i(clear_i),
+				.loadData_i(preload_i),
+				// Output(s)
+				.counterOut_o(counterOut_o)
+			);
+		end
+		else begin : measure_clock
+			// Signal declaration
+			wire [COUNTER_SIZE-1:0] measureCount, measureCountNext, sampleBinary;
+			reg [COUNTER_SIZE-1:0] grayReg;
+			(* altera_attribute = "-name SYNCHRONIZER_IDENTIFICATION FORCED_IF_ASYNCHRONOUS" *)
+			reg [COUNTER_SIZE-1:0] graySync1Reg, graySync2Reg;
+			reg [COUNTER_SIZE-1:0] sampleReg, baseReg, counterReg;
+			reg [1:0] measureResetReg;
+			wire measureReset;
+			genvar b;
+
+			// Reset synchronizer: asynchronous assertion, deassertion at a measureClock_i edge
+			always @ (posedge measureClock_i, posedge reset_i) begin
+				if (reset_i) begin
+					measureResetReg			<= 2'b11;
+				end
+				else begin
+					measureResetReg			<= {measureResetReg[0], 1'b0};
+				end
+			end
+			assign measureReset			= measureResetReg[1];
+
+			// Free running counter, its Gray code is registered: no combinational glitch reaches the crossing
+			counter #(.COUNTER_SIZE(COUNTER_SIZE)) counter1
+			(
+				// Clock-reset
+				.clock_i(measureClock_i),
+				.reset_i(measureReset),
+				// Control signals
+				.enable_i(1'b1),
+				.load_i(1'b0),
+				.loadData_i({COUNTER_SIZE{1'b0}}),
+				// Output(s)
+				.counterOut_o(measureCount)
+			);
+			assign measureCountNext		= measureCount + 1'b1;
+
+			always @ (posedge measureClock_i, posedge measureReset) begin
+				if (measureReset) begin
+					grayReg					<= 0;
+				end
+				else begin
+					grayReg					<= measureCountNext ^ (measureCountNext >> 1);		// Follows the counter at the same edge
+				end
+			end
+
+			// Clock crossing and Gray to binary conversion in the clock_i domain
+			always @ (posedge clock_i, posedge reset_i) begin
+				if (reset_i) begin
+					graySync1Reg			<= 0;
+					graySync2Reg			<= 0;
+					sampleReg				<= 0;
+					baseReg					<= 0;
+					counterReg				<= 0;
+				end
+				else begin
+					graySync1Reg			<= grayReg;
+					graySync2Reg			<= graySync1Reg;
+					sampleReg				<= sampleBinary;
+					if (clear_i) begin
+						baseReg				<= sampleReg - preload_i;								// Time preload_i of the measurement
+						counterReg			<= preload_i;
+					end
+					else if (enable_i) begin
+						counterReg			<= sampleReg - baseReg;
+					end
+				end
+			end
+
+			// Binary bit b is the parity of the Gray bits from b upwards
+			for (b=0; b<COUNTER_SIZE; b=b+1) begin : gray_decode
+				assign sampleBinary[b]	= ^graySync2Reg[COUNTER_SIZE-1:b];
+			end
+
+			assign counterOut_o			= counterReg;
+		end
+	endgenerate
+
+endmodule
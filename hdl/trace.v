@@ -0,0 +1,111 @@
+//===============================
+// Ring buffer for trace events
+//===============================
+
+/*** @Brief: ***
+* On-chip ring buffer of event records with fill level and sticky overflow flag
+* New records are dropped while the buffer is full (the oldest records are kept)
+* Retention (retain_i): the newest keep_i records are kept, a new record drops the oldest one (pre-trigger)
+* readData_o always shows the oldest record, pop_i advances to the next one
+****************/
+
+/*** Instantiation ***
+	trace #(.DATA_WIDTH(DATA_WIDTH), .TRACE_SIZE(TRACE_SIZE)) trace1
+	(
+		// Clock-reset
+		.clock_i(clock),
+		.reset_i(reset),
+		// Control signals
+		.clear_i(clear),						// Flush the buffer and the overflow flag
+		.write_i(write),
+		.writeData_i(DATA_WIDTH),
+		.pop_i(pop),
+		.retain_i(retain),						// Keep the newest records
+		.keep_i(TRACE_SIZE + 1),				// Records kept at retention
+		// Output(s)
+		.readData_o(DATA_WIDTH),				// Oldest record
+		.level_o(TRACE_SIZE + 1),				// Number of stored records
+		.overflow_o()							// Record(s) dropped since the last clear
+	);
+*/
+
+module trace
+#(
+	parameter
+		DATA_WIDTH		= 32,
+		TRACE_SIZE		= 9										// Buffer depth: 2^TRACE_SIZE records
+)
+(
+	// Clock-reset
+	input wire 								clock_i,
+	input wire 								reset_i,
+	// Control signals
+	input wire 								clear_i,
+	input wire 								write_i,
+	input wire [DATA_WIDTH-1:0]		writeData_i,
+	input wire 								pop_i,
+	input wire 								retain_i,
+	input wire [TRACE_SIZE:0]			keep_i,
+	// Output(s)
+	output wire [DATA_WIDTH-1:0]		readData_o,
+	output wire [TRACE_SIZE:0]			level_o,
+	output reg 								overflow_o
+);
+
+	// Signal declaration
+	reg [DATA_WIDTH-1:0] traceRam [0:(1<<TRACE_SIZE)-1];
+	reg [DATA_WIDTH-1:0] readDataReg;
+	reg [TRACE_SIZE:0] writePointerReg, readPointerReg;
+	wire [TRACE_SIZE:0] readPointerNext;
+	wire full, empty, drop, store;
+
+	// Buffer memory: registered read port on the next read pointer (block RAM)
+	always @ (posedge clock_i) begin
+		if (store) begin
+			traceRam[writePointerReg[TRACE_SIZE-1:0]] <= writeData_i;
+		end
+		if (store & (writePointerReg == readPointerNext)) begin
+			readDataReg <= writeData_i;								// Write-through into an empty buffer
+		end
+		else begin
+			readDataReg <= traceRam[readPointerNext[TRACE_SIZE-1:0]];
+		end
+	end
+
+	// Pointers
+	always @ (posedge clock_i, posedge reset_i) begin
+		if (reset_i) begin
+			writePointerReg	<= 0;
+			readPointerReg		<= 0;
+			overflow_o			<= 0;
+		end
+		else if (clear_i) begin
+			writePointerReg	<= 0;
+			readPointerReg		<= 0;
+			overflow_o			<= 0;
+		end
+		else begin
+			if (write_i) begin
+				if (~store) begin
+					overflow_o			<= 1'b1;				// Record is dropped
+				end
+				else begin
+					writePointerReg	<= writePointerReg + 1;
+				end
+			end
+			readPointerReg		<= readPointerNext;
+		end
+	end
+
+	// Control logic
+	assign full					= level_o[TRACE_SIZE];
+	assign empty				= (level_o == 0);
+	assign drop					= write_i & retain_i & ~pop_i & ~empty & (level_o >= keep_i);	// The oldest record gives way
+	assign store				= write_i & (~full | drop);
+	assign readPointerNext	= ((pop_i | drop) & ~empty) ? readPointerReg + 1 : readPointerReg;
+
+	// Output assignment
+	assign level_o				= writePointerReg - readPointerReg;
+	assign readData_o			= readDataReg;
+
+endmodule
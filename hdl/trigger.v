@@ -0,0 +1,173 @@
+//=========================================
+// Measurement trigger unit
+//=========================================
+
+/*** @Brief: ***
+* Starts and stops the measurement on hardware conditions, modelled on the trigger of a logic analyzer
+*   - arm_i arms the unit (at ready status), disarm_i or the end of the measurement (done_i) disarms it
+*   - Start conditions: at once, the start probe of a task ID, an IRQ edge, or startValue_i cycles after the arm
+*   - Stop conditions (after the trigger): none (software stop), the start probe of a task ID, an IRQ edge,
+*     stopValue_i cycles or stopValue_i detected events
+*   - Pre-trigger retention: the measurement starts at the arm, the trace buffer keeps the newest records
+*     meanwhile (retain_o), the trigger only marks its counter value (time_o)
+*   - start_o and stop_o are single cycle pulses one cycle after the condition, the probe of the matched
+*     task ID reaches ept.v with the start and is measured
+****************/
+
+/*** Instantiation ***
+	trigger #(.DATA_WIDTH(DATA_WIDTH), .COUNTER_SIZE(COUNTER_SIZE), .TASK_ID_SIZE(TASK_ID_SIZE)) trigger1
+	(
+		// Clock-reset
+		.clock_i(clock),
+		.reset_i(reset),
+		// Control signals
+		.arm_i(arm),
+		.disarm_i(disarm),
+		.preTrigger_i(pre),						// Start at the arm, the condition marks the trigger
+		.startMode_i(3),
+		.stopMode_i(3),
+		.startValue_i(DATA_WIDTH),				// Task ID or cycles after the arm
+		.stopValue_i(DATA_WIDTH),				// Task ID, cycles or events after the trigger
+		// Conditions
+		.taskStart_i(probe),					// Start probe of taskID_i
+		.taskID_i(TASK_ID_SIZE - 1),
+		.irqEdge_i(irq),
+		.event_i(event),						// A detected event of ept.v
+		.counter_i(COUNTER_SIZE),
+		.done_i(done),							// The measurement is stopped
+		// Measurement control
+		.start_o(),
+		.stop_o(),
+		// Status output
+		.retain_o(),							// Pre-trigger: the trace keeps the newest records
+		.armed_o(),
+		.triggered_o(),							// Sticky until the next arm
+		.time_o(COUNTER_SIZE)					// Counter value at the trigger (pre-trigger), else 0
+	);
+*/
+
+module trigger
+#(
+	parameter
+		DATA_WIDTH		= 32,
+		COUNTER_SIZE	= 40,
+		TASK_ID_SIZE	= 8
+)
+(
+	// Clock-reset
+	input wire 								clock_i,
+	input wire 								reset_i,
+	// Control signals
+	input wire 								arm_i,
+	input wire 								disarm_i,
+	input wire 								preTrigger_i,
+	input wire [2:0]						startMode_i,
+	input wire [2:0]						stopMode_i,
+	input wire [DATA_WIDTH-1:0]		startValue_i,
+	input wire [DATA_WIDTH-1:0]		stopValue_i,
+	// Conditions
+	input wire 								taskStart_i,
+	input wire [TASK_ID_SIZE-2:0]		taskID_i,
+	input wire 								irqEdge_i,
+	input wire 								event_i,
+	input wire [COUNTER_SIZE-1:0]		counter_i,
+	input wire 								done_i,
+	// Measurement control
+	output reg 								start_o,
+	output reg 								stop_o,
+	// Status output
+	output wire 							retain_o,
+	output wire 							armed_o,
+	output reg 								triggered_o,
+	output reg [COUNTER_SIZE-1:0]		time_o
+);
+
+	// State Definitions
+	localparam [1:0]
+		STATE_IDLE			= 2'd0,
+		STATE_ARMED			= 2'd1,					// Waiting for the start condition
+		STATE_TRIGGERED	= 2'd2;					// Waiting for the stop condition
+	// Conditions
+	localparam [2:0]
+		START_NOW			= 3'd0,
+		START_TASK			= 3'd1,
+		START_IRQ			= 3'd2,
+		START_DELAY			= 3'd3,
+		STOP_NONE			= 3'd0,
+		STOP_TASK			= 3'd1,
+		STOP_IRQ				= 3'd2,
+		STOP_CYCLES			= 3'd3,
+		STOP_EVENTS			= 3'd4;
+
+	// Signal declaration
+	reg [1:0] stateReg;
+	reg [DATA_WIDTH-1:0] countReg;
+	wire startHit, stopHit, countEvents;
+
+	always @ (posedge clock_i, posedge reset_i) begin
+		if (reset_i) begin
+			stateReg						<= STATE_IDLE;
+			countReg						<= 0;
+			start_o						<= 0;
+			stop_o						<= 0;
+			triggered_o					<= 0;
+			time_o						<= 0;
+		end
+		else begin
+			start_o						<= 1'b0;
+			stop_o						<= 1'b0;
+			if (disarm_i | done_i) begin
+				stateReg					<= STATE_IDLE;
+			end
+			else begin
+				case (stateReg)
+					STATE_IDLE: begin
+						if (arm_i) begin
+							countReg			<= 0;
+							triggered_o		<= 1'b0;
+							time_o			<= 0;
+							start_o			<= preTrigger_i;								// The pre-trigger records are captured
+							stateReg			<= STATE_ARMED;
+						end
+					end
+					STATE_ARMED: begin
+						countReg				<= countReg + 1'b1;							// Cycles after the arm
+						if (startHit) begin
+							countReg			<= 0;
+							triggered_o		<= 1'b1;
+							time_o			<= (preTrigger_i) ? counter_i : 0;
+							start_o			<= ~preTrigger_i;
+							stateReg			<= STATE_TRIGGERED;
+						end
+					end
+					STATE_TRIGGERED: begin
+						countReg				<= countReg + (~countEvents | event_i);	// Cycles or events after the trigger
+						if (stopHit) begin
+							stop_o			<= 1'b1;
+							stateReg			<= STATE_IDLE;
+						end
+					end
+					default: begin
+						stateReg				<= STATE_IDLE;
+					end
+				endcase
+			end
+		end
+	end
+
+	// Control logic
+	assign startHit				= (startMode_i == START_NOW) |
+										  ((startMode_i == START_TASK) & taskStart_i & (taskID_i == startValue_i[TASK_ID_SIZE-2:0])) |
+										  ((startMode_i == START_IRQ) & irqEdge_i) |
+										  ((startMode_i == START_DELAY) & (countReg >= startValue_i));
+	assign stopHit					= ((stopMode_i == STOP_TASK) & taskStart_i & (taskID_i == stopValue_i[TASK_ID_SIZE-2:0])) |
+										  ((stopMode_i == STOP_IRQ) & irqEdge_i) |
+										  ((stopMode_i == STOP_CYCLES) & (countReg >= stopValue_i)) |
+										  (countEvents & (countReg >= stopValue_i));
+	assign countEvents			= (stopMode_i == STOP_EVENTS);
+
+	// Output assignment
+	assign retain_o				= (stateReg == STATE_ARMED) & preTrigger_i;
+	assign armed_o					= (stateReg != STATE_IDLE);
+
+endmodule
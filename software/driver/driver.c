@@ -3,16 +3,366 @@
 //==========================================
 
 #include "driver.h"
+#ifdef EPT_IRQ
+#include "sys/alt_irq.h"
 
-// Concatenate Execution Performance Cycle Counter
+// Registered EPT interrupt handler
+static eptIrqHandler_t eptIrqHandler;
+static void *eptIrqContext;
+
+static void eptIrqService(void *isrContext);
+#endif
+
+static alt_u64 eptRecordWideGet(int taskID, int lowOffset);
+#ifdef EPT_HISTOGRAM
+static alt_u64 eptHistBound(alt_u32 layout, int bin);
+#endif
+
+// Concatenate Execution Performance Cycle Counter: the LO read latches the HI word, LO has to be read first
 alt_u64 eptCounterConcat(eptCounter_t *eptCounter)
 {
+	alt_u32 low = eptCounter->Low;
+
+	return ((BYTE_TO_QWORD_CONVERT(eptCounter->High)) << 32) | (WORD_TO_QWORD_CONVERT(low));
+}
+
+// Consistent cycle counter snapshot in two bus reads: the LO read latches the HI word
+alt_u64 eptNow(void)
+{
+	alt_u32 low = DRV_EPT_CTR_LO_GET;
+
+	return (BYTE_TO_QWORD_CONVERT(DRV_EPT_CTR_HI_GET) << 32) | WORD_TO_QWORD_CONVERT(low);
+}
 
-	return ((BYTE_TO_QWORD_CONVERT(eptCounter->High)) << 32) | (WORD_TO_QWORD_CONVERT(eptCounter->Low));
+// Consistent 64 bit summarized cycles of a task record
+alt_u64 eptTaskSumGet(int taskID)
+{
+	return eptRecordWideGet(taskID, EPT_RECORD_SUM_LO_OF);
 }
 
-// Calculate elapsed time in milliseconds
-double elapsedTimeMillisec(alt_u64 elapsedCycle)
+// Consistent 64 bit inclusive cycles of a task record: own and nested region cycles
+alt_u64 eptTaskInclusiveGet(int taskID)
 {
-	return (((double)elapsedCycle / (double)SYSTEM_CLOCK) * 1000);
+	return eptRecordWideGet(taskID, EPT_RECORD_INCL_LO_OF);
+}
+
+// Decode the stored trace records into events, the measurement may keep running
+// The decoder state has to be cleared at each start of the measurement
+int eptTraceDrain(eptTrace_t *trace, eptEvent_t *event, int eventMax)
+{
+	alt_u32 level = DRV_EPT_TRACE_LEVEL_GET;
+	alt_u32 record;
+	int events = 0;
+
+	if (level & EPT_TRACE_OVERFLOW) trace->overflow = 1;
+	level &= EPT_TRACE_LEVEL_MASK;
+	while (level-- && (events < eventMax))
+	{
+		record = DRV_EPT_TRACE_DATA_GET;
+		if (EPT_TRACE_TYPE(record) == EPT_EVENT_EXTENSION)
+		{
+			trace->extension = WORD_TO_QWORD_CONVERT(record & EPT_TRACE_EXTENSION_MASK) << EPT_TRACE_DELTA_SIZE;
+			continue;
+		}
+		trace->timestamp += trace->extension | EPT_TRACE_DELTA(record);
+		trace->extension = 0;
+		event[events].type = EPT_TRACE_TYPE(record);
+		event[events].taskID = EPT_TRACE_ID(record);
+		event[events].timestamp = trace->timestamp;
+		events++;
+	}
+
+	return events;
+}
+
+// Fixed-point conversion of cycles by a TIME_FACTOR: (cycles * factor) >> TIME_Q from 32 bit partial products
+// The result is truncated, no division and no floating point operation is needed
+alt_u64 timeConvert(alt_u64 cycles, alt_u64 factor)
+{
+	alt_u64 cyclesLow = cycles & WORD_MASK, cyclesHigh = cycles >> 32;
+	alt_u64 factorLow = factor & WORD_MASK, factorHigh = factor >> 32;
+
+	return ((cyclesHigh * factorHigh) << 32) + (cyclesHigh * factorLow) + (cyclesLow * factorHigh) + ((cyclesLow * factorLow) >> 32);
+}
+
+// Cycles in the best fitting time unit for reporting: the fraction is the remainder of the next smaller unit
+eptTime_t eptTimeGet(alt_u64 cycles)
+{
+	eptTime_t time = {0, 0, "ns"};
+	alt_u64 small = CYCLES_TO_NS(cycles);
+	alt_u64 large;
+
+	if (small < 1000)
+	{
+		time.integer = (alt_u32)small;
+		return time;
+	}
+	large = CYCLES_TO_US(cycles);
+	time.unit = "us";
+	if (large >= 1000)
+	{
+		small = large;
+		large = CYCLES_TO_MS(cycles);
+		time.unit = "ms";
+	}
+	// The truncated units are aligned by the remainder
+	while (large * 1000 > small)
+	{
+		large--;
+	}
+	while (small - large * 1000 >= 1000)
+	{
+		large++;
+	}
+	time.integer = (alt_u32)large;
+	time.fraction = (alt_u32)(small - large * 1000);
+
+	return time;
+}
+
+#ifdef EPT_DMA
+// Readout DMA: the results are copied into buffer (completion word, then the data) at the events of control (EPT_DMA_*),
+// period in bus clock cycles while measuring (0: off). The buffer holds EPT_DMA_RECORD_WORDS + 1 words for the records
+void eptDmaSetup(volatile alt_u32 *buffer, alt_u32 control, alt_u32 period)
+{
+	DRV_EPT_DMA_CONTROL_SET(0);									// A running copy is completed
+	if (buffer)
+	{
+		buffer[0] = 0;												// No completion yet
+	}
+	DRV_EPT_DMA_ADDRESS_SET((alt_u32)(unsigned long)buffer);
+	DRV_EPT_DMA_PERIOD_SET(period);
+	DRV_EPT_DMA_CONTROL_SET(control);
+}
+#endif
+
+#ifdef EPT_HISTOGRAM
+// Latency histograms: the buckets are cleared, layout (EPT_HIST_*) is applied to the exception records and
+// to the EPT_HIST_TASK_SLOTS tasks of taskID (-1: unused slot)
+void eptHistSetup(alt_u32 layout, const int *taskID)
+{
+	alt_u32 select[EPT_HIST_TASK_SLOTS / 2] = {0, 0};
+	int i;
+
+	for (i=0; i<EPT_HIST_TASK_SLOTS; i++)
+	{
+		if (taskID[i] >= 0)
+		{
+			select[i / 2] |= (EPT_HIST_SELECT_ENABLE | (taskID[i] & EPT_RAM_ADDRESS_MAX)) << ((i % 2) * EPT_HIST_SELECT_SHIFT);
+		}
+	}
+	DRV_EPT_HIST_SELECT_LO_SET(select[0]);
+	DRV_EPT_HIST_SELECT_HI_SET(select[1]);
+	DRV_EPT_HIST_LAYOUT_SET(layout);
+	while (DRV_EPT_HIST_LAYOUT_GET & EPT_HIST_BUSY);				// One bucket per clock cycle
+}
+
+// Read the buckets of a slot (0-3: selected tasks, 4-7: IR latency, Context Save, ISR, Context Restore)
+void eptHistGet(int slot, eptHist_t *hist)
+{
+	int i;
+
+	hist->layout = DRV_EPT_HIST_LAYOUT_GET;
+	hist->count = 0;
+	DRV_EPT_HIST_ADDRESS_SET(slot, 0);
+	for (i=0; i<EPT_HIST_BINS; i++)
+	{
+		hist->bin[i] = DRV_EPT_HIST_DATA_GET;						// The index increments at each read
+		hist->count += hist->bin[i];
+	}
+}
+
+// Estimated cycles below which permille of the updates are: linear interpolation inside the bucket,
+// the lower bound of the last (open) bucket is returned for the updates beyond the range
+alt_u32 eptHistPercentile(const eptHist_t *hist, int permille)
+{
+	alt_u64 rank = (alt_u64)hist->count * permille;
+	alt_u64 below = 0, lower, upper;
+	int i;
+
+	for (i=0; i<EPT_HIST_BINS; i++)
+	{
+		if (hist->bin[i] && ((below + hist->bin[i]) * 1000 >= rank))
+		{
+			lower = eptHistBound(hist->layout, i);
+			if (i == EPT_HIST_BINS - 1)
+			{
+				return (lower > WORD_MASK) ? WORD_MASK : (alt_u32)lower;
+			}
+			upper = eptHistBound(hist->layout, i + 1);
+			lower += ((upper - lower) * (rank - below * 1000)) / ((alt_u64)hist->bin[i] * 1000);
+			return (lower > WORD_MASK) ? WORD_MASK : (alt_u32)lower;
+		}
+		below += hist->bin[i];
+	}
+
+	return 0;														// No update
+}
+#endif
+
+#ifdef EPT_BUDGET
+// Budget of a task in counter cycles (0: none), the overrun count of the task restarts
+void eptBudgetSet(int taskID, alt_u32 cycles)
+{
+	DRV_EPT_BUDGET_INDEX_SET(taskID);
+	DRV_EPT_BUDGET_SET(cycles);
+	DRV_EPT_OVERRUNS_SET(0);
+}
+
+// Invocations of a task that exceeded its budget
+alt_u32 eptOverrunsGet(int taskID)
+{
+	DRV_EPT_BUDGET_INDEX_SET(taskID);
+
+	return DRV_EPT_OVERRUNS_GET;								// The entry follows the index at the next cycle
+}
+
+// First overrun since the start (or the last DRV_EPT_OVERRUN_CLEAR): task and counter value at the overrun
+int eptOverrunFirstGet(int *taskID, alt_u64 *timestamp)
+{
+	alt_u32 status = DRV_EPT_OVERRUN_FIRST_GET;
+
+	if (!(status & EPT_OVERRUN_VALID))
+	{
+		return 0;
+	}
+	*taskID = status & EPT_OVERRUN_ID_MASK;
+	*timestamp = (WORD_TO_QWORD_CONVERT(DRV_EPT_OVERRUN_TIME_HI_GET) << 32) | WORD_TO_QWORD_CONVERT(DRV_EPT_OVERRUN_TIME_LO_GET);
+
+	return 1;
+}
+#endif
+
+#ifdef EPT_SAMPLING
+// Sampling profiler: the counts are cleared, the running task or exception phase is sampled while measuring
+// Each interval gets dither random bits (0-15) against the aliasing with a periodic interrupt, their mean is
+// taken off the period
+void eptSampleSetup(alt_u32 period, int dither)
+{
+	alt_u32 spread = ((1u << (dither & EPT_SAMPLE_DITHER_MASK)) - 1) / 2;
+
+	if (period && (period < EPT_SAMPLE_PERIOD_MIN + spread))
+	{
+		period = EPT_SAMPLE_PERIOD_MIN + spread;
+	}
+	DRV_EPT_SAMPLE_PERIOD_SET(period - spread);
+	DRV_EPT_SAMPLE_CONTROL_SET((period) ? EPT_SAMPLE_ENABLE | dither : 0);
+	while (DRV_EPT_SAMPLE_CONTROL_GET & EPT_SAMPLE_BUSY);			// One record per clock cycle
+}
+
+// Read the hit counts: the share of a record is hits / count
+void eptSampleGet(eptSample_t *sample)
+{
+	int i;
+
+	sample->idle = DRV_EPT_SAMPLE_IDLE_GET;
+	sample->count = sample->idle;
+	DRV_EPT_SAMPLE_ADDRESS_SET(0);
+	for (i=0; i<EPT_SAMPLE_RECORDS; i++)
+	{
+		sample->hits[i] = DRV_EPT_SAMPLE_HITS_GET;					// The index increments at each read
+		sample->count += sample->hits[i];
+	}
+}
+#endif
+
+#ifdef EPT_TRIGGER
+// Trigger unit: the start condition starts the measurement, the stop condition stops it
+// With EPT_TRIGGER_PRE the measurement starts at the arm, the trace keeps the newest preRecords records until the trigger
+void eptTriggerArm(alt_u32 control, alt_u32 startValue, alt_u32 stopValue, alt_u32 preRecords)
+{
+	DRV_EPT_TRIGGER_START_SET(startValue);
+	DRV_EPT_TRIGGER_STOP_SET(stopValue);
+	DRV_EPT_TRIGGER_PRE_SET((preRecords > EPT_TRACE_DEPTH) ? EPT_TRACE_DEPTH : preRecords);
+	DRV_EPT_TRIGGER_CONTROL_SET(control | EPT_TRIGGER_ARM);
+}
+
+// The armed trigger is cancelled, a running measurement keeps running
+void eptTriggerDisarm(void)
+{
+	DRV_EPT_TRIGGER_CONTROL_SET(0);
+}
+
+// Pre-trigger: the trace records before the timestamp precede the trigger
+int eptTriggerTimeGet(alt_u64 *timestamp)
+{
+	if (!(DRV_EPT_TRIGGER_CONTROL_GET & EPT_TRIGGER_TRIGGERED))
+	{
+		return 0;
+	}
+	*timestamp = (WORD_TO_QWORD_CONVERT(DRV_EPT_TRIGGER_TIME_HI_GET) << 32) | WORD_TO_QWORD_CONVERT(DRV_EPT_TRIGGER_TIME_LO_GET);
+
+	return 1;
+}
+#endif
+
+#ifdef EPT_IRQ
+// Event driven collection: the handler is called with the pending sources of mask (EPT_IRQ_*), a NULL handler disables the interrupt
+int eptIrqRegister(alt_u32 mask, eptIrqHandler_t handler, void *context)
+{
+	int status;
+
+	DRV_EPT_IRQ_MASK_SET(0);
+	eptIrqHandler = handler;
+	eptIrqContext = context;
+	status = alt_ic_isr_register(EPT_IRQ_INTERRUPT_CONTROLLER_ID, EPT_IRQ, (handler) ? eptIrqService : NULL, NULL, NULL);
+	if (status || !handler)
+	{
+		return status;
+	}
+	DRV_EPT_IRQ_CLEAR(EPT_IRQ_ALL);								// Earlier events are not reported
+	DRV_EPT_IRQ_MASK_SET(mask);
+
+	return 0;
+}
+#endif
+
+// === Functions with Internal Access ===
+// 64 bit field of a task record (LO, HI): the HI word is read again until it is stable around LO
+static alt_u64 eptRecordWideGet(int taskID, int lowOffset)
+{
+	alt_u32 high, low;
+
+	do
+	{
+		high = DRV_EPT_RECORD_GET(taskID, lowOffset + 1);
+		low = DRV_EPT_RECORD_GET(taskID, lowOffset);
+	} while (high != DRV_EPT_RECORD_GET(taskID, lowOffset + 1));
+
+	return (WORD_TO_QWORD_CONVERT(high) << 32) | WORD_TO_QWORD_CONVERT(low);
+}
+
+#ifdef EPT_HISTOGRAM
+// Lower bound of a histogram bucket in cycles: bin << Shift (linear), 0 and 2^(Shift+bin-1) (log2)
+static alt_u64 eptHistBound(alt_u32 layout, int bin)
+{
+	int shift = (layout >> EPT_HIST_SHIFT_POS) & EPT_HIST_SHIFT_MASK;
+
+	if (!(layout & EPT_HIST_LOG2))
+	{
+		return (alt_u64)bin << shift;
+	}
+	if (bin == 0)
+	{
+		return 0;
+	}
+	shift += bin - 1;
+
+	return 1ULL << ((shift > 32) ? 32 : shift);						// The elapsed cycles are 32 bit
+}
+#endif
+
+#ifdef EPT_IRQ
+// EPT interrupt service routine: the pending sources are cleared before the handler runs
+static void eptIrqService(void *isrContext)
+{
+	alt_u32 status = DRV_EPT_IRQ_STATUS_GET & DRV_EPT_IRQ_MASK_GET;
+
+	DRV_EPT_IRQ_CLEAR(status);
+	if (eptIrqHandler)
+	{
+		eptIrqHandler(eptIrqContext, status);
+	}
+	(void)isrContext;
 }
+#endif
@@ -12,10 +12,30 @@
 // Constant Definitions
 #define BYTE_TO_QWORD_CONVERT(data)			(((alt_u64)data & BYTE_MASK))
 #define WORD_TO_QWORD_CONVERT(data)			(((alt_u64)data & WORD_MASK))
-#define SYSTEM_CLOCK						50000000LL									// 50 MHz clock cycle
+#ifdef ALT_CPU_FREQ
+	#define SYSTEM_CLOCK					((alt_u64)ALT_CPU_FREQ)						// System clock from the BSP
+#else
+	#define SYSTEM_CLOCK					50000000LL									// 50 MHz clock cycle
+#endif
+#ifdef EPT_MEASURE_CLOCK_FREQ
+	#define MEASURE_CLOCK					((alt_u64)EPT_MEASURE_CLOCK_FREQ)			// EPT cycle counter clock from system.h
+#else
+	#define MEASURE_CLOCK					SYSTEM_CLOCK								// Counter on the system clock
+#endif
 #define IR_TIMING_PARAM						4											// Interrupt timing parameters
 #define TASK_ID_MAX							(EPT_RAM_ADDRESS_MAX+1 - IR_TIMING_PARAM)	// Maximum number of TASK ID
 
+// Fixed-point time conversion: time units per counter cycle in Q32 format, evaluated at compile time
+#define TIME_Q								32
+#define TIME_FACTOR(unitPerSec)				(((((alt_u64)(unitPerSec)) << TIME_Q) + (MEASURE_CLOCK / 2)) / MEASURE_CLOCK)
+#define TIME_FACTOR_NS						TIME_FACTOR(1000000000ULL)
+#define TIME_FACTOR_US						TIME_FACTOR(1000000ULL)
+#define TIME_FACTOR_MS						TIME_FACTOR(1000ULL)
+#define CYCLES_TO_NS(cycles)				timeConvert(cycles, TIME_FACTOR_NS)			// Cycles to nanoseconds
+#define CYCLES_TO_US(cycles)				timeConvert(cycles, TIME_FACTOR_US)			// Cycles to microseconds
+#define CYCLES_TO_MS(cycles)				timeConvert(cycles, TIME_FACTOR_MS)			// Cycles to milliseconds
+#define TIME_FRACTION_DIGITS				3											// Digits of eptTime_t fraction
+
 //------------------------
 // System Timer
 //------------------------
@@ -39,26 +59,98 @@
 //-------------------------------
 #define DRV_EPT_RAM_SET(address, data)		EPT_WRITE_RAM(EPT_BASE, address, data)		// Set onchip RAM data
 #define DRV_EPT_RAM_GET(address)			EPT_READ_RAM(EPT_BASE, address)				// Get onchip RAM data
-#define DRV_EPT_CTR_LO_GET 					EPT_READ_CTR_LO(EPT_BASE)					// Get Counter Low
-#define DRV_EPT_CTR_HI_GET 					EPT_READ_CTR_HI(EPT_BASE)					// Get Counter High
+#define DRV_EPT_RECORD_GET(task, field)		EPT_READ_RECORD(EPT_BASE, task, field)		// Get task record field
+#define DRV_EPT_CTR_LO_GET 					EPT_READ_CTR_LO(EPT_BASE)					// Get Counter Low, latch Counter High
+#define DRV_EPT_CTR_HI_GET 					EPT_READ_CTR_HI(EPT_BASE)					// Get Counter High latched at the last Low read
+#define DRV_EPT_CTR_LO_SET(data)			EPT_WRITE_CTR_LO(EPT_BASE, data)			// Set Counter preload Low
+#define DRV_EPT_CTR_HI_SET(data)			EPT_WRITE_CTR_HI(EPT_BASE, data)			// Set Counter preload High
 #define DRV_EPT_STATUS_GET 					EPT_READ_STATUS(EPT_BASE)					// Get IsReady Status
 #define DRV_EPT_START_SET(data)				EPT_WRITE_START(EPT_BASE, data)				// Set Start register
 #define DRV_EPT_STOP_SET(data)				EPT_WRITE_STOP(EPT_BASE, data)				// Set Stop register
-#define DRV_EPT_TASK_SET(data)				EPT_WRITE_TASK(EPT_BASE, data)				// Set Task ID
 #define DRV_EPT_TASK_GET					EPT_READ_TASK(EPT_BASE)						// Get Task ID
 #define DRV_EPT_IOOF_SET(data)				EPT_WRITE_IOOF(EPT_BASE, data)				// Set IO offset
 #define DRV_EPT_IOOF_GET					EPT_READ_IOOF(EPT_BASE)						// Get IO offset
+#define DRV_EPT_IOOF_IR_SET(param, data)	EPT_WRITE_IOOF_IR(EPT_BASE, param, data)	// Set exception IO offset
+#define DRV_EPT_IOOF_IR_GET(param)			EPT_READ_IOOF_IR(EPT_BASE, param)			// Get exception IO offset
+#define DRV_EPT_EXEC_GET					EPT_READ_EXEC(EPT_BASE)						// Get Executed
+#define DRV_EPT_RESET_SET(data)				EPT_WRITE_RESET(EPT_BASE, data)				// Set Reset
+#define DRV_EPT_MODE_SET(data)				EPT_WRITE_MODE(EPT_BASE, data)				// Set Mode
+#define DRV_EPT_MODE_GET					EPT_READ_MODE(EPT_BASE)						// Get Mode
+#define DRV_EPT_TRACE_LEVEL_GET				EPT_READ_TRACE_LEVEL(EPT_BASE)				// Get Trace level and overflow
+#define DRV_EPT_TRACE_CLEAR					EPT_WRITE_TRACE_CLEAR(EPT_BASE)				// Flush the Trace buffer
+#define DRV_EPT_TRACE_DATA_GET				EPT_READ_TRACE_DATA(EPT_BASE)				// Pop the oldest Trace record
+#define DRV_EPT_SWAP_SET(data)				EPT_WRITE_SWAP(EPT_BASE, data)				// Set Bank swap command
+#define DRV_EPT_SWAP_GET					EPT_READ_SWAP(EPT_BASE)						// Get Bank swap status
+#define DRV_EPT_LOST_EVENTS_GET				EPT_READ_LOST_EVENTS(EPT_BASE)				// Get Lost events
+#define DRV_EPT_LOST_CLEAR					EPT_WRITE_LOST_CLEAR(EPT_BASE)				// Clear Lost events
+#define DRV_EPT_IRQ_STATUS_GET				EPT_READ_IRQ_STATUS(EPT_BASE)				// Get Interrupt status
+#define DRV_EPT_IRQ_CLEAR(data)				EPT_WRITE_IRQ_CLEAR(EPT_BASE, data)			// Clear Interrupt status bits
+#define DRV_EPT_IRQ_MASK_GET				EPT_READ_IRQ_MASK(EPT_BASE)					// Get Interrupt mask
+#define DRV_EPT_IRQ_MASK_SET(data)			EPT_WRITE_IRQ_MASK(EPT_BASE, data)			// Set Interrupt mask
+#define DRV_EPT_DMA_CONTROL_GET				EPT_READ_DMA_CONTROL(EPT_BASE)				// Get DMA control and busy status
+#define DRV_EPT_DMA_CONTROL_SET(data)		EPT_WRITE_DMA_CONTROL(EPT_BASE, data)		// Set DMA control
+#define DRV_EPT_DMA_ADDRESS_GET				EPT_READ_DMA_ADDRESS(EPT_BASE)				// Get DMA destination
+#define DRV_EPT_DMA_ADDRESS_SET(data)		EPT_WRITE_DMA_ADDRESS(EPT_BASE, data)		// Set DMA destination
+#define DRV_EPT_DMA_PERIOD_GET				EPT_READ_DMA_PERIOD(EPT_BASE)				// Get DMA period
+#define DRV_EPT_DMA_PERIOD_SET(data)		EPT_WRITE_DMA_PERIOD(EPT_BASE, data)		// Set DMA period
+#define DRV_EPT_FILL_RANGE_SET(first, last)	EPT_WRITE_FILL_RANGE(EPT_BASE, first, last)	// Set RAM fill word range
+#define DRV_EPT_FILL(data)					EPT_WRITE_FILL(EPT_BASE, data)				// Start RAM fill
+#define DRV_EPT_FILL_BUSY_GET				EPT_READ_FILL(EPT_BASE)						// Get RAM fill busy status
+#define DRV_EPT_PREEMPT_GET					EPT_READ_PREEMPT(EPT_BASE)					// Get Preemption status
+#define DRV_EPT_PREEMPT_CLEAR				EPT_WRITE_PREEMPT_CLEAR(EPT_BASE)			// Clear Preemption overflow
+#define DRV_EPT_HIST_LAYOUT_GET				EPT_READ_HIST_LAYOUT(EPT_BASE)				// Get Histogram layout and busy status
+#define DRV_EPT_HIST_LAYOUT_SET(data)		EPT_WRITE_HIST_LAYOUT(EPT_BASE, data)		// Set Histogram layout, clear the buckets
+#define DRV_EPT_HIST_SELECT_LO_SET(data)	EPT_WRITE_HIST_SELECT_LO(EPT_BASE, data)	// Set Histogram task slots 0-1
+#define DRV_EPT_HIST_SELECT_HI_SET(data)	EPT_WRITE_HIST_SELECT_HI(EPT_BASE, data)	// Set Histogram task slots 2-3
+#define DRV_EPT_HIST_ADDRESS_SET(slot, bin)	EPT_WRITE_HIST_ADDRESS(EPT_BASE, slot, bin)	// Set Histogram readout index
+#define DRV_EPT_HIST_DATA_GET				EPT_READ_HIST_DATA(EPT_BASE)				// Get Histogram bucket, next index
+#define DRV_EPT_BUDGET_INDEX_SET(data)		EPT_WRITE_BUDGET_INDEX(EPT_BASE, data)		// Set Budget table index
+#define DRV_EPT_BUDGET_GET					EPT_READ_BUDGET(EPT_BASE)					// Get Budget of the indexed task
+#define DRV_EPT_BUDGET_SET(data)			EPT_WRITE_BUDGET(EPT_BASE, data)			// Set Budget of the indexed task
+#define DRV_EPT_OVERRUNS_GET				EPT_READ_OVERRUNS(EPT_BASE)					// Get Overruns of the indexed task
+#define DRV_EPT_OVERRUNS_SET(data)			EPT_WRITE_OVERRUNS(EPT_BASE, data)			// Set Overruns of the indexed task
+#define DRV_EPT_OVERRUN_FIRST_GET			EPT_READ_OVERRUN_FIRST(EPT_BASE)			// Get First overrun status
+#define DRV_EPT_OVERRUN_CLEAR				EPT_WRITE_OVERRUN_CLEAR(EPT_BASE)			// Arm the first overrun capture
+#define DRV_EPT_OVERRUN_TIME_LO_GET			EPT_READ_OVERRUN_TIME_LO(EPT_BASE)			// Get First overrun counter LOW
+#define DRV_EPT_OVERRUN_TIME_HI_GET			EPT_READ_OVERRUN_TIME_HI(EPT_BASE)			// Get First overrun counter HIGH
+#define DRV_EPT_SAMPLE_CONTROL_GET			EPT_READ_SAMPLE_CONTROL(EPT_BASE)			// Get Sampling control and busy status
+#define DRV_EPT_SAMPLE_CONTROL_SET(data)	EPT_WRITE_SAMPLE_CONTROL(EPT_BASE, data)	// Set Sampling control, clear the counts
+#define DRV_EPT_SAMPLE_PERIOD_GET			EPT_READ_SAMPLE_PERIOD(EPT_BASE)			// Get Sampling period
+#define DRV_EPT_SAMPLE_PERIOD_SET(data)		EPT_WRITE_SAMPLE_PERIOD(EPT_BASE, data)		// Set Sampling period
+#define DRV_EPT_SAMPLE_ADDRESS_SET(data)	EPT_WRITE_SAMPLE_ADDRESS(EPT_BASE, data)	// Set Sample readout index
+#define DRV_EPT_SAMPLE_HITS_GET				EPT_READ_SAMPLE_HITS(EPT_BASE)				// Get Sample hit count, next index
+#define DRV_EPT_SAMPLE_IDLE_GET				EPT_READ_SAMPLE_IDLE(EPT_BASE)				// Get Idle sample count
+#define DRV_EPT_TRIGGER_CONTROL_GET			EPT_READ_TRIGGER_CONTROL(EPT_BASE)			// Get Trigger control and status
+#define DRV_EPT_TRIGGER_CONTROL_SET(data)	EPT_WRITE_TRIGGER_CONTROL(EPT_BASE, data)	// Set Trigger control, arm or disarm
+#define DRV_EPT_TRIGGER_START_SET(data)		EPT_WRITE_TRIGGER_START(EPT_BASE, data)		// Set Trigger start value
+#define DRV_EPT_TRIGGER_STOP_SET(data)		EPT_WRITE_TRIGGER_STOP(EPT_BASE, data)		// Set Trigger stop value
+#define DRV_EPT_TRIGGER_PRE_SET(data)		EPT_WRITE_TRIGGER_PRE(EPT_BASE, data)		// Set Pre-trigger records
+#define DRV_EPT_TRIGGER_TIME_LO_GET			EPT_READ_TRIGGER_TIME_LO(EPT_BASE)			// Get Trigger counter LOW
+#define DRV_EPT_TRIGGER_TIME_HI_GET			EPT_READ_TRIGGER_TIME_HI(EPT_BASE)			// Get Trigger counter HIGH
+
+// Probes: the probe custom instruction when it is in the system (ALT_CI_EPT_CI), else Avalon writes
+#ifdef ALT_CI_EPT_CI
+#define DRV_EPT_NOW32						EPT_CI_READ_CTR_LO							// Single instruction timestamp
+#define DRV_EPT_TASK_SET(data)				EPT_CI_WRITE_TASK(data)						// Set Task ID
+#define DRV_EPT_TASK_SWITCH_SET(data)		EPT_CI_WRITE_TASK_SWITCH(data)				// Stop the running task, start the Task ID
+#define DRV_EPT_ISR_SET(data)				EPT_CI_WRITE_ISR(data)						// Set Interrupt Service Routine trigger
+#define DRV_EPT_CTXSAV_SET(data)			EPT_CI_WRITE_CTX_SAVE(data)					// Set Context Saving trigger
+#define DRV_EPT_CTXRES_SET(data)			EPT_CI_WRITE_CTX_REST(data)					// Set Context Restoring trigger
+#else
+#define DRV_EPT_NOW32						EPT_READ_CTR_LO(EPT_BASE)					// Single read timestamp for intervals below 2^32 cycles
+#define DRV_EPT_TASK_SET(data)				EPT_WRITE_TASK(EPT_BASE, data)				// Set Task ID
+#define DRV_EPT_TASK_SWITCH_SET(data)		EPT_WRITE_TASK_SWITCH(EPT_BASE, data)		// Stop the running task, start the Task ID
 #define DRV_EPT_ISR_SET(data)				EPT_WRITE_ISR(EPT_BASE, data)				// Set Interrupt Service Routine trigger
 #define DRV_EPT_CTXSAV_SET(data)			EPT_WRITE_CTX_SAVE(EPT_BASE, data)			// Set Context Saving trigger
 #define DRV_EPT_CTXRES_SET(data)			EPT_WRITE_CTX_REST(EPT_BASE, data)			// Set Context Restoring trigger
-#define DRV_EPT_EXEC_GET					EPT_READ_EXEC(EPT_BASE)						// Get Executed
-#define DRV_EPT_RESET_SET(data)				EPT_WRITE_RESET(EPT_BASE, data)				// Set Reset
+#endif
 
 // Direct Memory Mapped Access
 #define DRV_EPT_RAM_PTR						EPT_RAM_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))						// RAM address pointer
 #define DRV_EPT_RAM_IR_PTR					EPT_RAM_IR_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))					// Pointer to Interrupt Timing data in the RAM
 #define DRV_EPT_CTR_PTR						EPT_CTR_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))						// Counter address pointer
 #define DRV_EPT_TASK_PTR					EPT_TASK_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))						// Task ID address pointer
+#define DRV_EPT_TASK_SWITCH_PTR				EPT_TASK_SWITCH_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))				// Task switch address pointer
 #define DRV_EPT_ISR_PTR						EPT_ISR_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))						// ISR address pointer
 #define DRV_EPT_CTXSAV_PTR					EPT_CTX_SAVE_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))					// Context Save address pointer
 #define DRV_EPT_CTXRES_PTR					EPT_CTX_RESTORE_PTR(EPT_BASE, (SYSTEM_BUS_WIDTH / 8))				// Context Restore address pointer
@@ -72,14 +164,59 @@
 												DRV_EPT_STOP_SET(1);\
 												DRV_EPT_STOP_SET(0);\
 											}													// Stop trigger command
+#define DRV_EPT_PRELOAD(cycles)				{\
+												DRV_EPT_CTR_LO_SET((alt_u64)(cycles));\
+												DRV_EPT_CTR_HI_SET((alt_u64)(cycles) >> 32);\
+											}													// Counter value at the next start
 #define DRV_EPT_RESET						{\
 												DRV_EPT_RESET_SET(1);\
 												DRV_EPT_RESET_SET(0);\
 											}
 
+// Time for reporting: Integer.Fraction Unit
+typedef struct eptTime
+{
+	alt_u32 integer;
+	alt_u32 fraction;							// TIME_FRACTION_DIGITS decimal digits
+	const char *unit;							// "ns", "us" or "ms"
+} eptTime_t;
+
+// EPT interrupt handler: called from the ISR with the pending sources (EPT_IRQ_*), which are already cleared
+typedef void (*eptIrqHandler_t)(void *context, alt_u32 status);
+
 // Function Prototypes
 alt_u64 eptCounterConcat(eptCounter_t *eptCounter);			// Concatenate Execution Performance Cycle Counter
-double elapsedTimeMillisec(alt_u64 elapsedCycle);		// Calculate elapsed time in milliseconds
+alt_u64 eptNow(void);										// Consistent cycle counter snapshot (measurement running)
+alt_u64 eptTaskSumGet(int taskID);							// Consistent 64 bit summarized cycles of a task record
+alt_u64 eptTaskInclusiveGet(int taskID);						// Consistent 64 bit inclusive cycles of a task record
+int eptTraceDrain(eptTrace_t *trace, eptEvent_t *event, int eventMax);	// Decode the stored trace records into events
+alt_u64 timeConvert(alt_u64 cycles, alt_u64 factor);		// Fixed-point conversion of cycles by a TIME_FACTOR
+eptTime_t eptTimeGet(alt_u64 cycles);						// Cycles in the best fitting time unit for reporting
+#ifdef EPT_DMA
+void eptDmaSetup(volatile alt_u32 *buffer, alt_u32 control, alt_u32 period);	// Readout into buffer without the CPU
+#endif
+#ifdef EPT_HISTOGRAM
+void eptHistSetup(alt_u32 layout, const int *taskID);		// Clear the histograms, select the layout and the EPT_HIST_TASK_SLOTS tasks
+void eptHistGet(int slot, eptHist_t *hist);					// Read the buckets of a slot
+alt_u32 eptHistPercentile(const eptHist_t *hist, int permille);	// Estimated cycles below which permille of the updates are
+#endif
+#ifdef EPT_BUDGET
+void eptBudgetSet(int taskID, alt_u32 cycles);				// Budget of a task (0: none), its overrun count is cleared
+alt_u32 eptOverrunsGet(int taskID);							// Overruns of a task
+int eptOverrunFirstGet(int *taskID, alt_u64 *timestamp);		// First overrun since the start: 1 if there was one
+#endif
+#ifdef EPT_SAMPLING
+void eptSampleSetup(alt_u32 period, int dither);			// Clear the counts, sample every period cycles on average (0: off)
+void eptSampleGet(eptSample_t *sample);						// Read the hit counts of every record and the idle samples
+#endif
+#ifdef EPT_TRIGGER
+void eptTriggerArm(alt_u32 control, alt_u32 startValue, alt_u32 stopValue, alt_u32 preRecords);	// Arm the trigger (EPT_TRIGGER_*) at ready status
+void eptTriggerDisarm(void);								// Disarm the trigger, the measurement is not stopped
+int eptTriggerTimeGet(alt_u64 *timestamp);					// Pre-trigger: counter value at the trigger, 1 if it triggered
+#endif
+#ifdef EPT_IRQ
+int eptIrqRegister(alt_u32 mask, eptIrqHandler_t handler, void *context);	// Event driven collection: handle the sources of mask
+#endif
 
 
 #endif	// DRIVER_H_
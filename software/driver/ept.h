@@ -4,25 +4,100 @@
 
 /*  @Brief:
 *		- NIOSii/e based (non-vectored IR, no cache and branch prediction)
-*		- No multitask measurement support
+*		- Preemption stack: a task started while another one runs suspends it until its stop (EPT_PREEMPT_DEPTH)
 *	 	- Detects task execution
 *      	- Measures exception timings: IR latency, context saving, ISR handling, context restoring
+*		- Per-task records in RAM: {RAMaddr, Field} -> Field 0: Sum LO, 1: Sum HI, 2: Count, 3: Min, 4: Max,
+*		  5: Inclusive LO, 6: Inclusive HI (with the nested regions), 7: Parent {Valid[31], Multiple[30], Parent ID}
+*		- Trace mode: delta timestamped event records in a ring buffer, drained while measuring
+*		  Record: {Type[31:28], Task ID[27:21], Delta[20:0]}, Type 0xf: extension {Delta >> 21} of the next record
+*		- Ping-pong result banks: the RAM window shows the frozen bank while measuring, the active one at ready status
+*		- Optional readout DMA: the frozen bank (cleared after the copy) or the trace records are written into
+*		  system memory: {Sequence[31:16], Words[15:0]} completion word, then the data from the next word
+*		- Optional latency histograms: every update of 4 selected tasks and of the exception records is counted
+*		  into 2^EPT_HIST_SIZE linear or log2 buckets of its elapsed cycles
+*		- Optional budget watchdog: the running task is checked against its cycle budget at every cycle, the
+*		  overruns are counted per task and raise EPT_IRQ_OVERRUN, the first one is captured with its timestamp
+*		- Optional sampling profiler: the running task or exception phase is sampled every (dithered) period,
+*		  the hits are counted per record without any probe cost
+*		- Optional trigger unit: the armed unit starts and stops the measurement on a task start probe, an IRQ
+*		  edge, a cycle or event count, the pre-trigger mode keeps the newest trace records before the trigger
 *	@Interfacing
 *		Operation			|	Address(RAMaddr)	|	WriteData	|	ReadData
 *		 -----------------------------------------------------------------------
-*	 	1. Acess RAM			0x0(RAMaddr)			data			data
-*      	2. CounterLO			0x80					X				Counter data
-*      	3. CounterHI			0x81					X				Counter data
-*      	4. Ready Status			0x82					X				Status
-*      	5. Start				0x83					0x1				X
-*      	6. Stop					0x84					0x1				X
-*		7. Task ID				0x85					Task ID			X
-*		8. IO Offset			0x86					Offset			X
-*		9. ISR handling			0x87					0x1				X
-*	   10. Context saving		0x88					0x1				X
-*	   11. Context restoring	0x89					0x1				X
-*	   12. Executed				0x8a					X				Executed
-*	   13. Module reset			0x8b					0x1				X
+*	 	1. Acess RAM			0x0(RAMaddr,Field)		data			data
+*      	2. CounterLO			0x400					Preload LO		Counter data	-> Read: latches the HI word
+*      	3. CounterHI			0x401					Preload HI		Counter data	-> Read: HI word at the last LO read
+*																					-> Write: the counter starts from the preload
+*      	4. Ready Status			0x402					X				Status
+*      	5. Start				0x403					0x1				X
+*      	6. Stop					0x404					0x1				X
+*		7. Task ID				0x405					Task ID			X
+*		8. IO Offset			0x406					Offset			X
+*		9. ISR handling			0x407					0x1				X
+*	   10. Context saving		0x408					0x1				X
+*	   11. Context restoring	0x409					0x1				X
+*	   12. Executed				0x40a					X				Executed
+*	   13. Module reset			0x40b					0x1				X
+*	   14. Mode					0x40c					Mode			Mode			-> Bit 0: Trace enable
+*	   15. Trace level			0x40d					X (clear)		Level			-> Bit 31: Overflow
+*	   16. Trace data			0x40e					X				Oldest record	-> Read pops the record
+*	   17. Swap banks			0x40f					Command			Status			-> Command bit 0: Now, bit 1: At the next IRQ
+*																					-> Status bit 0: Active bank, bit 1: Pending
+*	   18. Task switch			0x410					Task ID			Task ID			-> Stops the running task, starts Task ID
+*	   19. IR latency offset	0x411					Offset			Offset
+*	   20. Ctx save offset		0x412					Offset			Offset
+*	   21. ISR offset			0x413					Offset			Offset
+*	   22. Ctx restore offset	0x414					Offset			Offset
+*	   23. Lost events			0x415					X (clear)		Lost events		-> Edges merged into an unprocessed one
+*	   24. IRQ status			0x416					Clear bits		Status			-> Bit 0: Done, 1: Accumulator at half range,
+*																					   2: Trace level at half depth, 3: Banks swapped,
+*																					   4: DMA copy complete, 5: Budget overrun
+*	   25. IRQ mask				0x417					Mask			Mask			-> ept_irq: a status bit enabled in the mask
+*	   26. DMA control			0x418					Control			Status			-> Bit 0: Enable, 1: At stop, 2: Trace source
+*																					-> Status bit 31: Busy
+*	   27. DMA address			0x419					Address			Address			-> Destination buffer
+*	   28. DMA period			0x41a					Cycles			Cycles			-> Readout period while measuring, 0: off
+*	   29. Fill range			0x41b					Range			Range			-> {Last word[31:16], First word[15:0]}, default: all
+*	   30. Fill					0x41c					Data			Busy			-> Write: the RAM window range is filled in hardware
+*	   31. Preemption			0x41d					X (clear)		Status			-> Bit 31: Overflow, [4:0]: Suspended tasks
+*	   32. Histogram layout		0x41e					Layout			Layout			-> Bit 31: Enable, 30: Busy (read), [12:8]: Shift,
+*																						   0: Log2 buckets. Write: clears every bucket
+*	   33. Histogram tasks LO	0x41f					Select			Select			-> Slot 0-1: {Enable[31], ID[30:16], Enable[15], ID[14:0]}
+*	   34. Histogram tasks HI	0x420					Select			Select			-> Slot 2-3, slot 4-7: exception records
+*	   35. Histogram address	0x421					Index			Index			-> {Slot, Bucket} of the next data read
+*	   36. Histogram data		0x422					X				Count			-> Read increments the index
+*	   37. Budget index			0x423					Task ID			Task ID			-> Entry of the budget and overruns registers
+*	   38. Budget				0x424					Cycles			Cycles			-> Budget of the indexed task, 0: no budget
+*	   39. Overruns				0x425					Count			Count			-> Overruns of the indexed task, saturating
+*	   40. First overrun		0x426					X (clear)		Status			-> Bit 31: Valid, Task ID. Cleared at the start
+*	   41. Overrun time LO		0x427					X				Counter LO		-> Counter value at the first overrun
+*	   42. Overrun time HI		0x428					X				Counter HI
+*	   43. Sampling control		0x429					Control			Control			-> Bit 31: Enable, 30: Busy (read), [3:0]: Dither bits
+*																						   Write: clears every count
+*	   44. Sampling period		0x42a					Cycles			Cycles			-> Sampling interval in bus clock cycles (at least 4)
+*	   45. Sample address		0x42b					Index			Index			-> Record address of the next hits read
+*	   46. Sample hits			0x42c					X				Count			-> Read increments the index
+*	   47. Idle samples			0x42d					X				Count			-> Samples without a task and an exception
+*	   48. Trigger control		0x42e					Control			Status			-> Bit 31: Arm (read: Armed), 30: Triggered (read),
+*																						   29: Pre-trigger, [6:4]: Stop, [2:0]: Start condition
+*	   49. Trigger start		0x42f					Value			Value			-> Task ID or cycles after the arm
+*	   50. Trigger stop			0x430					Value			Value			-> Task ID, cycles or events after the trigger
+*	   51. Pre-trigger			0x431					Records			Records			-> Trace records kept before the trigger
+*	   52. Trigger time LO		0x432					X				Counter LO		-> Counter value at the trigger (pre-trigger)
+*	   53. Trigger time HI		0x433					X				Counter HI
+*	@Parameters
+*		The addresses above are shown for the default ADDRESS_WIDTH = 11: 128 task records, register base 0x400
+*		ADDRESS_WIDTH, RECORD_SIZE and TRACE_SIZE of eptAV.v are exported to system.h by eptAV_hw.tcl
+*		(EPT_ADDRESS_WIDTH, EPT_RECORD_SIZE, EPT_TRACE_SIZE), every mask and offset below is derived from them
+*		EPT_MEASURE_CLOCK_FREQ is the cycle counter clock: the bus clock, or the measurement clock at MEASURE_CLOCK = 1
+*		EPT_DMA is defined with the readout DMA (DMA = 1)
+*		EPT_HISTOGRAM and EPT_HIST_SIZE are defined with the latency histograms (HISTOGRAM = 1)
+*		EPT_BUDGET is defined with the budget watchdog (BUDGET = 1)
+*		EPT_SAMPLING is defined with the sampling profiler (SAMPLING = 1)
+*		EPT_TRIGGER is defined with the trigger unit (TRIGGER = 1)
+*		ALT_CI_EPT_CI(n, A) is defined with the probe custom instruction (eptCI instance "ept_ci"): n selects the
+*		probe, A is the written data, the result is the counter LO word (EPT_CI_* below)
 */
 
 #ifndef EPT_H_
@@ -31,52 +106,276 @@
 #include "io.h"
 #include "alt_types.h"
 
+//---------------------------------------
+// Hardware parameters (system.h or default)
+//---------------------------------------
+#ifndef EPT_ADDRESS_WIDTH
+	#define EPT_ADDRESS_WIDTH					11						// Avalon word address width
+#endif
+#ifndef EPT_RECORD_SIZE
+	#define EPT_RECORD_SIZE						3						// Words of a task record: 2^EPT_RECORD_SIZE
+#endif
+#ifndef EPT_TRACE_SIZE
+	#define EPT_TRACE_SIZE						9						// Trace ring buffer depth: 2^EPT_TRACE_SIZE records
+#endif
+#ifndef EPT_PREEMPT_DEPTH
+	#define EPT_PREEMPT_DEPTH					4						// Suspended tasks of the preemption stack, 0: off
+#endif
+#ifndef EPT_HIST_SIZE
+	#define EPT_HIST_SIZE						5						// Buckets of a histogram slot: 2^EPT_HIST_SIZE
+#endif
+
 //------------
 // Data Masks
 //------------
-#define EPT_RAM_SIZE							7
-#define EPT_RAM_ADDRESS_MASK					0x7f
-#define EPT_RAM_ADDRESS_MAX						0x7f
+#define EPT_RAM_SIZE							(EPT_ADDRESS_WIDTH - EPT_RECORD_SIZE - 1)
+#define EPT_RAM_ADDRESS_MAX						((1 << EPT_RAM_SIZE) - 1)				// Last task record
+#define EPT_RECORD_WORDS						(1 << EPT_RECORD_SIZE)					// Words of a task record
+#define EPT_RAM_WORD_MAX						((1 << (EPT_ADDRESS_WIDTH - 1)) - 1)	// Last RAM word
+#define EPT_RAM_ADDRESS_MASK					EPT_RAM_WORD_MAX
+#define EPT_TASK_ACTIVE							(1 << EPT_RAM_SIZE)						// Task ID MSB: the task is running
+#define EPT_TASK_ID_MASK						((EPT_TASK_ACTIVE << 1) - 1)
 #define WORD_MASK								0xffffffffLL
 #define BYTE_MASK								0x000000ffLL
+#define EPT_COUNTER_SIZE						40						// Cycle counter width
+#define EPT_COUNTER_MASK						((1ULL << EPT_COUNTER_SIZE) - 1)
+#define EPT_MODE_TRACE							0x1						// Trace mode enable
+#define EPT_TRACE_DEPTH							(1 << EPT_TRACE_SIZE)	// Ring buffer depth in records
+#define EPT_TRACE_LEVEL_MASK					((EPT_TRACE_DEPTH << 1) - 1)			// Number of stored records
+#define EPT_TRACE_OVERFLOW						0x80000000				// Record(s) dropped
+#define EPT_TRACE_DELTA_SIZE					(EPT_TRACE_TYPE_SHIFT - EPT_RAM_SIZE)
+#define EPT_TRACE_DELTA_MASK					((1 << EPT_TRACE_DELTA_SIZE) - 1)
+#define EPT_TRACE_ID_MASK						EPT_RAM_ADDRESS_MAX
+#define EPT_TRACE_EXTENSION_MASK				0x0fffffff				// Upper Delta bits of an extension record
+#define EPT_TRACE_TYPE_SHIFT					28
+#define EPT_SWAP_NOW							0x1						// Swap the result banks
+#define EPT_SWAP_IRQ							0x2						// Swap the result banks at the next IRQ
+#define EPT_SWAP_BANK							0x1						// Active bank
+#define EPT_SWAP_PENDING						0x2						// Requested swap is not done yet
+#define EPT_IRQ_DONE							0x1						// Measurement is stopped, the results are ready
+#define EPT_IRQ_ACCUMULATOR						0x2						// A stored Sum or Count reached half of its range
+#define EPT_IRQ_TRACE							0x4						// Trace buffer is half full
+#define EPT_IRQ_SWAP							0x8						// Result banks are swapped: the frozen bank is ready
+#define EPT_IRQ_DMA								0x10					// Readout DMA completion word is written
+#define EPT_IRQ_OVERRUN							0x20					// A running task exceeded its budget
+#define EPT_IRQ_ALL								0x3f
+#define EPT_DMA_ENABLE							0x1						// Records: every bank swap is copied
+#define EPT_DMA_AT_STOP							0x2						// Readout at the stop of the measurement
+#define EPT_DMA_TRACE							0x4						// Source: trace records (instead of the frozen bank)
+#define EPT_DMA_CONTROL_MASK					0x7
+#define EPT_DMA_BUSY							0x80000000				// Copy is in progress
+#define EPT_DMA_SEQUENCE(word)					((word) >> 16)			// Completion word: number of the copy
+#define EPT_DMA_WORDS(word)						((word) & 0xffff)		// Completion word: copied data words
+#define EPT_DMA_RECORD_WORDS					(EPT_RAM_WORD_MAX + 1)	// Data words of a record bank copy
+#define EPT_FILL_BUSY							0x1						// RAM fill is in progress: RAM accesses are held, no start
+#define EPT_FILL_LAST_SHIFT						16						// Fill range: last word position
+#define EPT_PREEMPT_OVERFLOW					0x80000000				// A preempted task was dropped at the full stack
+#define EPT_PREEMPT_LEVEL_MASK					0x1f					// Number of suspended tasks
+#define EPT_PARENT_VALID						0x80000000				// Parent link: the region was nested in the Parent ID
+#define EPT_PARENT_MULTIPLE						0x40000000				// Parent link: the region was nested in different parents
+#define EPT_PARENT_ID_MASK						EPT_RAM_ADDRESS_MAX
+#define EPT_HIST_BINS							(1 << EPT_HIST_SIZE)	// Buckets of a histogram slot
+#define EPT_HIST_SLOTS							8						// Slot 0-3: selected tasks, 4-7: exception records
+#define EPT_HIST_TASK_SLOTS						4
+#define EPT_HIST_ENABLE							0x80000000				// Layout: the updates are counted
+#define EPT_HIST_BUSY							0x40000000				// Layout: the buckets are being cleared
+#define EPT_HIST_LOG2							0x1						// Layout: bucket b >= 1 is [2^(Shift+b-1), 2^(Shift+b))
+#define EPT_HIST_SHIFT_POS						8						// Layout: bucket width (linear) or first bound (log2): 2^Shift
+#define EPT_HIST_SHIFT_MASK						0x1f
+#define EPT_HIST_LAYOUT_MASK					(EPT_HIST_ENABLE | (EPT_HIST_SHIFT_MASK << EPT_HIST_SHIFT_POS) | EPT_HIST_LOG2)
+#define EPT_HIST_SELECT_ENABLE					0x8000					// Task slot: {Enable, Task ID} halfword
+#define EPT_HIST_SELECT_SHIFT					16
+#define EPT_OVERRUN_VALID						0x80000000				// First overrun: captured since the start or the clear
+#define EPT_OVERRUN_ID_MASK						EPT_RAM_ADDRESS_MAX
+#define EPT_SAMPLE_ENABLE						0x80000000				// Sampling control: samples are taken while measuring
+#define EPT_SAMPLE_BUSY							0x40000000				// Sampling control: the counts are being cleared
+#define EPT_SAMPLE_DITHER_MASK					0xf						// Sampling control: random bits added to the interval
+#define EPT_SAMPLE_PERIOD_MIN					4						// Shortest sampling interval
+#define EPT_SAMPLE_RECORDS						(EPT_RAM_ADDRESS_MAX + 1)	// Hit counts: task IDs, then the exception records
+#define EPT_TRIGGER_ARM							0x80000000				// Trigger control: arm (write 0: disarm), read: armed
+#define EPT_TRIGGER_TRIGGERED					0x40000000				// Trigger control: the start condition was met since the arm
+#define EPT_TRIGGER_PRE							0x20000000				// Trigger control: the measurement starts at the arm
+#define EPT_TRIGGER_START_NOW					0x0						// Start condition: at the arm
+#define EPT_TRIGGER_START_TASK					0x1						// Start condition: start probe of the task ID
+#define EPT_TRIGGER_START_IRQ					0x2						// Start condition: rising edge of the IRQ input
+#define EPT_TRIGGER_START_DELAY					0x3						// Start condition: cycles after the arm
+#define EPT_TRIGGER_START_MASK					0x7
+#define EPT_TRIGGER_STOP_NONE					0x00					// Stop condition: software stop
+#define EPT_TRIGGER_STOP_TASK					0x10					// Stop condition: start probe of the task ID
+#define EPT_TRIGGER_STOP_IRQ					0x20					// Stop condition: rising edge of the IRQ input
+#define EPT_TRIGGER_STOP_CYCLES					0x30					// Stop condition: cycles after the trigger
+#define EPT_TRIGGER_STOP_EVENTS					0x40					// Stop condition: detected events (trace records) after the trigger
+#define EPT_TRIGGER_STOP_MASK					0x70
+#define EPT_TRIGGER_CONTROL_MASK				(EPT_TRIGGER_ARM | EPT_TRIGGER_PRE | EPT_TRIGGER_STOP_MASK | EPT_TRIGGER_START_MASK)
+#define EPT_TRIGGER_PRE_MASK					EPT_TRACE_LEVEL_MASK	// Pre-trigger records: up to the ring buffer depth
+#define EPT_TRACE_TYPE(record)					((record) >> EPT_TRACE_TYPE_SHIFT)									// Event type of a trace record
+#define EPT_TRACE_ID(record)					(((record) >> EPT_TRACE_DELTA_SIZE) & EPT_TRACE_ID_MASK)			// Task ID of a trace record
+#define EPT_TRACE_DELTA(record)					((record) & EPT_TRACE_DELTA_MASK)									// Cycles since the previous record
 
 //--------------------------------------------------------
 // Execution Performance Tester register address offsets
 //--------------------------------------------------------
 #define	EPT_RAM_OF								0x00
-#define	EPT_RAM_IR_OF							0x7C
-#define EPT_CTR_LO_OF							0x80					// Counter LOW address offset
-#define EPT_CTR_HI_OF							0x81					// Counter HIGH address offset
-#define EPT_STATUS_OF							0x82					// IsReady Status address offset
-#define EPT_START_OF							0x83					// Start address offset
-#define EPT_STOP_OF								0x84					// Stop address offset
-#define EPT_TASK_ID_OF							0x85					// Stop address offset
-#define EPT_IO_OFFSET_OF						0x86					// Stop address offset
-#define EPT_ISR_OF								0x87					// Stop address offset
-#define EPT_CTX_SAVE_OF							0x88					// Stop address offset
-#define EPT_CTX_REST_OF							0x89					// Stop address offset
-#define EPT_EXEC_OF								0x8a					// Stop address offset
-#define EPT_RESET_OF							0x8b					// Stop address offset
+#define EPT_IR_RECORDS							4						// Reserved records of the IR timing parameters
+#define	EPT_RAM_IR_OF							((EPT_RAM_ADDRESS_MAX + 1 - EPT_IR_RECORDS) << EPT_RECORD_SIZE)	// Record of the first IR timing parameter
+#define EPT_REGISTER_OF							(1 << (EPT_ADDRESS_WIDTH - 1))			// Register block after the RAM
+#define EPT_CTR_LO_OF							(EPT_REGISTER_OF + 0x00)	// Counter LOW address offset
+#define EPT_CTR_HI_OF							(EPT_REGISTER_OF + 0x01)	// Counter HIGH address offset
+#define EPT_STATUS_OF							(EPT_REGISTER_OF + 0x02)	// IsReady Status address offset
+#define EPT_START_OF							(EPT_REGISTER_OF + 0x03)	// Start address offset
+#define EPT_STOP_OF								(EPT_REGISTER_OF + 0x04)	// Stop address offset
+#define EPT_TASK_ID_OF							(EPT_REGISTER_OF + 0x05)	// Task ID address offset
+#define EPT_IO_OFFSET_OF						(EPT_REGISTER_OF + 0x06)	// IO offset address offset
+#define EPT_ISR_OF								(EPT_REGISTER_OF + 0x07)	// ISR address offset
+#define EPT_CTX_SAVE_OF							(EPT_REGISTER_OF + 0x08)	// Context Save address offset
+#define EPT_CTX_REST_OF							(EPT_REGISTER_OF + 0x09)	// Context Restore address offset
+#define EPT_EXEC_OF								(EPT_REGISTER_OF + 0x0a)	// Executed address offset
+#define EPT_RESET_OF							(EPT_REGISTER_OF + 0x0b)	// Reset address offset
+#define EPT_MODE_OF								(EPT_REGISTER_OF + 0x0c)	// Mode address offset
+#define EPT_TRACE_LEVEL_OF						(EPT_REGISTER_OF + 0x0d)	// Trace level address offset
+#define EPT_TRACE_DATA_OF						(EPT_REGISTER_OF + 0x0e)	// Trace data address offset
+#define EPT_SWAP_OF								(EPT_REGISTER_OF + 0x0f)	// Bank swap address offset
+#define EPT_TASK_SWITCH_OF						(EPT_REGISTER_OF + 0x10)	// Task switch address offset
+#define EPT_IO_OFFSET_IR_OF						(EPT_REGISTER_OF + 0x11)	// First exception IO offset address offset, in eptIR_t order
+#define EPT_LOST_EVENTS_OF						(EPT_REGISTER_OF + 0x15)	// Lost events address offset
+#define EPT_IRQ_STATUS_OF						(EPT_REGISTER_OF + 0x16)	// Interrupt status address offset
+#define EPT_IRQ_MASK_OF							(EPT_REGISTER_OF + 0x17)	// Interrupt mask address offset
+#define EPT_DMA_CONTROL_OF						(EPT_REGISTER_OF + 0x18)	// DMA control address offset
+#define EPT_DMA_ADDRESS_OF						(EPT_REGISTER_OF + 0x19)	// DMA destination address offset
+#define EPT_DMA_PERIOD_OF						(EPT_REGISTER_OF + 0x1a)	// DMA period address offset
+#define EPT_FILL_RANGE_OF						(EPT_REGISTER_OF + 0x1b)	// RAM fill range address offset
+#define EPT_FILL_OF								(EPT_REGISTER_OF + 0x1c)	// RAM fill command address offset
+#define EPT_PREEMPT_OF							(EPT_REGISTER_OF + 0x1d)	// Preemption status address offset
+#define EPT_HIST_LAYOUT_OF						(EPT_REGISTER_OF + 0x1e)	// Histogram layout address offset
+#define EPT_HIST_SELECT_LO_OF					(EPT_REGISTER_OF + 0x1f)	// Histogram task slots 0-1 address offset
+#define EPT_HIST_SELECT_HI_OF					(EPT_REGISTER_OF + 0x20)	// Histogram task slots 2-3 address offset
+#define EPT_HIST_ADDRESS_OF						(EPT_REGISTER_OF + 0x21)	// Histogram readout index address offset
+#define EPT_HIST_DATA_OF						(EPT_REGISTER_OF + 0x22)	// Histogram bucket count address offset
+#define EPT_BUDGET_INDEX_OF						(EPT_REGISTER_OF + 0x23)	// Budget table index address offset
+#define EPT_BUDGET_OF							(EPT_REGISTER_OF + 0x24)	// Budget of the indexed task address offset
+#define EPT_OVERRUNS_OF							(EPT_REGISTER_OF + 0x25)	// Overruns of the indexed task address offset
+#define EPT_OVERRUN_FIRST_OF					(EPT_REGISTER_OF + 0x26)	// First overrun status address offset
+#define EPT_OVERRUN_TIME_LO_OF					(EPT_REGISTER_OF + 0x27)	// First overrun counter LOW address offset
+#define EPT_OVERRUN_TIME_HI_OF					(EPT_REGISTER_OF + 0x28)	// First overrun counter HIGH address offset
+#define EPT_SAMPLE_CONTROL_OF					(EPT_REGISTER_OF + 0x29)	// Sampling control address offset
+#define EPT_SAMPLE_PERIOD_OF					(EPT_REGISTER_OF + 0x2a)	// Sampling period address offset
+#define EPT_SAMPLE_ADDRESS_OF					(EPT_REGISTER_OF + 0x2b)	// Sample readout index address offset
+#define EPT_SAMPLE_HITS_OF						(EPT_REGISTER_OF + 0x2c)	// Sample hit count address offset
+#define EPT_SAMPLE_IDLE_OF						(EPT_REGISTER_OF + 0x2d)	// Idle sample count address offset
+#define EPT_TRIGGER_CONTROL_OF					(EPT_REGISTER_OF + 0x2e)	// Trigger control address offset
+#define EPT_TRIGGER_START_OF					(EPT_REGISTER_OF + 0x2f)	// Trigger start value address offset
+#define EPT_TRIGGER_STOP_OF						(EPT_REGISTER_OF + 0x30)	// Trigger stop value address offset
+#define EPT_TRIGGER_PRE_OF						(EPT_REGISTER_OF + 0x31)	// Pre-trigger records address offset
+#define EPT_TRIGGER_TIME_LO_OF					(EPT_REGISTER_OF + 0x32)	// Trigger counter LOW address offset
+#define EPT_TRIGGER_TIME_HI_OF					(EPT_REGISTER_OF + 0x33)	// Trigger counter HIGH address offset
+
+// Task record field offsets
+#define EPT_RECORD_SUM_LO_OF					0						// Summarized cycles LOW
+#define EPT_RECORD_SUM_HI_OF					1						// Summarized cycles HIGH
+#define EPT_RECORD_COUNT_OF						2						// Number of invocations
+#define EPT_RECORD_MIN_OF						3						// Shortest invocation
+#define EPT_RECORD_MAX_OF						4						// Longest invocation
+#define EPT_RECORD_INCL_LO_OF					5						// Summarized cycles with the nested regions LOW
+#define EPT_RECORD_INCL_HI_OF					6						// Summarized cycles with the nested regions HIGH
+#define EPT_RECORD_PARENT_OF					7						// Parent link of the last invocation
+
+// Exception timing parameters: IR record and IO offset register index
+#define EPT_IR_LATENCY							0
+#define EPT_IR_CTX_SAVE							1
+#define EPT_IR_ISR								2
+#define EPT_IR_CTX_REST							3
+
+// Trace event types
+#define EPT_EVENT_TASK_START					0x0
+#define EPT_EVENT_TASK_STOP						0x1
+#define EPT_EVENT_IRQ							0x2
+#define EPT_EVENT_CTX_SAVE_START				0x3
+#define EPT_EVENT_CTX_SAVE_STOP					0x4
+#define EPT_EVENT_ISR_START						0x5
+#define EPT_EVENT_ISR_STOP						0x6
+#define EPT_EVENT_CTX_REST_START				0x7
+#define EPT_EVENT_CTX_REST_STOP					0x8
+#define EPT_EVENT_TASK_SWITCH					0x9						// Running task is stopped, Task ID is started
+#define EPT_EVENT_EXTENSION						0xf						// Upper Delta bits of the next record
 
 //---------------------------------------------------------------
 // Execution Performance Tester Register Write / Read Operations
 //---------------------------------------------------------------
 #define EPT_WRITE_RAM(base, address, data)		(IOWR(base, (address & EPT_RAM_ADDRESS_MASK), (data & WORD_MASK)))		// Write data to onchip RAM
 #define EPT_READ_RAM(base, address)				(IORD(base, (address & EPT_RAM_ADDRESS_MASK)))							// Read data to onchip RAM
+#define EPT_READ_RECORD(base, task, field)		(IORD(base, ((((task) << EPT_RECORD_SIZE) | (field)) & EPT_RAM_ADDRESS_MASK)))	// Read a task record field
 #define EPT_READ_CTR_LO(base)					(IORD(base, EPT_CTR_LO_OF))												// Read counter LOW
 #define EPT_READ_CTR_HI(base)					(IORD(base, EPT_CTR_HI_OF))												// Read counter HIGH
+#define EPT_WRITE_CTR_LO(base, data)			(IOWR(base, EPT_CTR_LO_OF, ((data) & WORD_MASK)))						// Write counter preload LOW
+#define EPT_WRITE_CTR_HI(base, data)			(IOWR(base, EPT_CTR_HI_OF, ((data) & BYTE_MASK)))						// Write counter preload HIGH
 #define EPT_READ_STATUS(base)					(IORD(base, EPT_STATUS_OF))												// Read IsReady Status
 #define EPT_WRITE_START(base, data)				(IOWR(base, EPT_START_OF, (data & 1)))									// Write Start trigger
 #define EPT_WRITE_STOP(base, data)				(IOWR(base, EPT_STOP_OF, (data & 1)))									// Read IsReady Status
-#define EPT_WRITE_TASK(base, data)				(IOWR(base, EPT_TASK_ID_OF, (data & BYTE_MASK)))						// Write Task ID
-#define EPT_READ_TASK(base)						(IORD(base, EPT_TASK_ID_OF) & BYTE_MASK)								// Read Task ID
+#define EPT_WRITE_TASK(base, data)				(IOWR(base, EPT_TASK_ID_OF, ((data) & EPT_TASK_ID_MASK)))					// Write Task ID
+#define EPT_READ_TASK(base)						(IORD(base, EPT_TASK_ID_OF) & EPT_TASK_ID_MASK)							// Read Task ID
+#define EPT_WRITE_TASK_SWITCH(base, data)		(IOWR(base, EPT_TASK_SWITCH_OF, ((data) & EPT_RAM_ADDRESS_MAX)))			// Write Task switch
 #define EPT_WRITE_IOOF(base, data)				(IOWR(base, EPT_IO_OFFSET_OF, (data & BYTE_MASK)))						// Write IO offset
 #define EPT_READ_IOOF(base)						(IORD(base, EPT_IO_OFFSET_OF) & BYTE_MASK)								// Read IO offset
+#define EPT_WRITE_IOOF_IR(base, param, data)	(IOWR(base, (EPT_IO_OFFSET_IR_OF + (param)), (data & BYTE_MASK)))		// Write exception IO offset
+#define EPT_READ_IOOF_IR(base, param)			(IORD(base, (EPT_IO_OFFSET_IR_OF + (param))) & BYTE_MASK)				// Read exception IO offset
 #define EPT_WRITE_ISR(base, data)				(IOWR(base, EPT_ISR_OF, (data & 1)))									// Write Interrupt Service Routine trigger
 #define EPT_WRITE_CTX_SAVE(base, data)			(IOWR(base, EPT_CTX_SAVE_OF, (data & 1)))								// Write Context Saving trigger
 #define EPT_WRITE_CTX_REST(base, data)			(IOWR(base, EPT_CTX_REST_OF, (data & 1)))								// Write Context Restoring trigger
 #define EPT_READ_EXEC(base)						(IORD(base, EPT_EXEC_OF))												// Read Executed
 #define EPT_WRITE_RESET(base, data)				(IOWR(base, EPT_RESET_OF, (data & 1)))									// Write Reset
+#define EPT_WRITE_MODE(base, data)				(IOWR(base, EPT_MODE_OF, (data & EPT_MODE_TRACE)))						// Write Mode
+#define EPT_READ_MODE(base)						(IORD(base, EPT_MODE_OF))												// Read Mode
+#define EPT_READ_TRACE_LEVEL(base)				(IORD(base, EPT_TRACE_LEVEL_OF))										// Read Trace level and overflow
+#define EPT_WRITE_TRACE_CLEAR(base)				(IOWR(base, EPT_TRACE_LEVEL_OF, 0))										// Flush the Trace buffer
+#define EPT_READ_TRACE_DATA(base)				(IORD(base, EPT_TRACE_DATA_OF))											// Pop the oldest Trace record
+#define EPT_WRITE_SWAP(base, data)				(IOWR(base, EPT_SWAP_OF, (data & (EPT_SWAP_NOW | EPT_SWAP_IRQ))))		// Write Bank swap command
+#define EPT_READ_SWAP(base)						(IORD(base, EPT_SWAP_OF))												// Read Bank swap status
+#define EPT_READ_LOST_EVENTS(base)				(IORD(base, EPT_LOST_EVENTS_OF))										// Read Lost events
+#define EPT_WRITE_LOST_CLEAR(base)				(IOWR(base, EPT_LOST_EVENTS_OF, 0))										// Clear Lost events
+#define EPT_READ_IRQ_STATUS(base)				(IORD(base, EPT_IRQ_STATUS_OF) & EPT_IRQ_ALL)							// Read Interrupt status
+#define EPT_WRITE_IRQ_CLEAR(base, data)			(IOWR(base, EPT_IRQ_STATUS_OF, ((data) & EPT_IRQ_ALL)))				// Clear Interrupt status bits
+#define EPT_READ_IRQ_MASK(base)					(IORD(base, EPT_IRQ_MASK_OF) & EPT_IRQ_ALL)								// Read Interrupt mask
+#define EPT_WRITE_IRQ_MASK(base, data)			(IOWR(base, EPT_IRQ_MASK_OF, ((data) & EPT_IRQ_ALL)))					// Write Interrupt mask
+#define EPT_READ_DMA_CONTROL(base)				(IORD(base, EPT_DMA_CONTROL_OF))										// Read DMA control and busy status
+#define EPT_WRITE_DMA_CONTROL(base, data)		(IOWR(base, EPT_DMA_CONTROL_OF, ((data) & EPT_DMA_CONTROL_MASK)))		// Write DMA control
+#define EPT_READ_DMA_ADDRESS(base)				(IORD(base, EPT_DMA_ADDRESS_OF))										// Read DMA destination
+#define EPT_WRITE_DMA_ADDRESS(base, data)		(IOWR(base, EPT_DMA_ADDRESS_OF, (data)))								// Write DMA destination
+#define EPT_READ_DMA_PERIOD(base)				(IORD(base, EPT_DMA_PERIOD_OF))										// Read DMA period
+#define EPT_WRITE_DMA_PERIOD(base, data)		(IOWR(base, EPT_DMA_PERIOD_OF, (data)))									// Write DMA period
+#define EPT_WRITE_FILL_RANGE(base, first, last)	(IOWR(base, EPT_FILL_RANGE_OF, (((last) << EPT_FILL_LAST_SHIFT) | (first))))	// Write RAM fill word range
+#define EPT_WRITE_FILL(base, data)				(IOWR(base, EPT_FILL_OF, (data)))										// Start RAM fill with the data
+#define EPT_READ_FILL(base)						(IORD(base, EPT_FILL_OF) & EPT_FILL_BUSY)								// Read RAM fill busy status
+#define EPT_READ_PREEMPT(base)					(IORD(base, EPT_PREEMPT_OF))											// Read Preemption status
+#define EPT_WRITE_PREEMPT_CLEAR(base)			(IOWR(base, EPT_PREEMPT_OF, 0))											// Clear Preemption overflow
+#define EPT_READ_HIST_LAYOUT(base)				(IORD(base, EPT_HIST_LAYOUT_OF))										// Read Histogram layout and busy status
+#define EPT_WRITE_HIST_LAYOUT(base, data)		(IOWR(base, EPT_HIST_LAYOUT_OF, ((data) & EPT_HIST_LAYOUT_MASK)))		// Write Histogram layout, clear the buckets
+#define EPT_WRITE_HIST_SELECT_LO(base, data)	(IOWR(base, EPT_HIST_SELECT_LO_OF, (data)))								// Write Histogram task slots 0-1
+#define EPT_WRITE_HIST_SELECT_HI(base, data)	(IOWR(base, EPT_HIST_SELECT_HI_OF, (data)))								// Write Histogram task slots 2-3
+#define EPT_WRITE_HIST_ADDRESS(base, slot, bin)	(IOWR(base, EPT_HIST_ADDRESS_OF, (((slot) << EPT_HIST_SIZE) | (bin))))	// Write Histogram readout index
+#define EPT_READ_HIST_DATA(base)				(IORD(base, EPT_HIST_DATA_OF))											// Read Histogram bucket, next index
+#define EPT_WRITE_BUDGET_INDEX(base, data)		(IOWR(base, EPT_BUDGET_INDEX_OF, ((data) & EPT_RAM_ADDRESS_MAX)))		// Write Budget table index
+#define EPT_READ_BUDGET(base)					(IORD(base, EPT_BUDGET_OF))												// Read Budget of the indexed task
+#define EPT_WRITE_BUDGET(base, data)			(IOWR(base, EPT_BUDGET_OF, (data)))										// Write Budget of the indexed task
+#define EPT_READ_OVERRUNS(base)					(IORD(base, EPT_OVERRUNS_OF))											// Read Overruns of the indexed task
+#define EPT_WRITE_OVERRUNS(base, data)			(IOWR(base, EPT_OVERRUNS_OF, (data)))									// Write Overruns of the indexed task
+#define EPT_READ_OVERRUN_FIRST(base)			(IORD(base, EPT_OVERRUN_FIRST_OF))										// Read First overrun status
+#define EPT_WRITE_OVERRUN_CLEAR(base)			(IOWR(base, EPT_OVERRUN_FIRST_OF, 0))									// Arm the first overrun capture
+#define EPT_READ_OVERRUN_TIME_LO(base)			(IORD(base, EPT_OVERRUN_TIME_LO_OF))									// Read First overrun counter LOW
+#define EPT_READ_OVERRUN_TIME_HI(base)			(IORD(base, EPT_OVERRUN_TIME_HI_OF))									// Read First overrun counter HIGH
+#define EPT_READ_SAMPLE_CONTROL(base)			(IORD(base, EPT_SAMPLE_CONTROL_OF))										// Read Sampling control and busy status
+#define EPT_WRITE_SAMPLE_CONTROL(base, data)	(IOWR(base, EPT_SAMPLE_CONTROL_OF, ((data) & (EPT_SAMPLE_ENABLE | EPT_SAMPLE_DITHER_MASK))))	// Write Sampling control, clear the counts
+#define EPT_READ_SAMPLE_PERIOD(base)			(IORD(base, EPT_SAMPLE_PERIOD_OF))										// Read Sampling period
+#define EPT_WRITE_SAMPLE_PERIOD(base, data)		(IOWR(base, EPT_SAMPLE_PERIOD_OF, (data)))								// Write Sampling period
+#define EPT_WRITE_SAMPLE_ADDRESS(base, data)	(IOWR(base, EPT_SAMPLE_ADDRESS_OF, ((data) & EPT_RAM_ADDRESS_MAX)))		// Write Sample readout index
+#define EPT_READ_SAMPLE_HITS(base)				(IORD(base, EPT_SAMPLE_HITS_OF))										// Read Sample hit count, next index
+#define EPT_READ_SAMPLE_IDLE(base)				(IORD(base, EPT_SAMPLE_IDLE_OF))										// Read Idle sample count
+#define EPT_READ_TRIGGER_CONTROL(base)			(IORD(base, EPT_TRIGGER_CONTROL_OF))									// Read Trigger control and status
+#define EPT_WRITE_TRIGGER_CONTROL(base, data)	(IOWR(base, EPT_TRIGGER_CONTROL_OF, ((data) & EPT_TRIGGER_CONTROL_MASK)))	// Write Trigger control, arm or disarm
+#define EPT_WRITE_TRIGGER_START(base, data)		(IOWR(base, EPT_TRIGGER_START_OF, (data)))								// Write Trigger start value
+#define EPT_WRITE_TRIGGER_STOP(base, data)		(IOWR(base, EPT_TRIGGER_STOP_OF, (data)))								// Write Trigger stop value
+#define EPT_WRITE_TRIGGER_PRE(base, data)		(IOWR(base, EPT_TRIGGER_PRE_OF, ((data) & EPT_TRIGGER_PRE_MASK)))		// Write Pre-trigger records
+#define EPT_READ_TRIGGER_TIME_LO(base)			(IORD(base, EPT_TRIGGER_TIME_LO_OF))									// Read Trigger counter LOW
+#define EPT_READ_TRIGGER_TIME_HI(base)			(IORD(base, EPT_TRIGGER_TIME_HI_OF))									// Read Trigger counter HIGH
 
 //---------------------------
 // Memory Mapped interfacing
@@ -85,10 +384,30 @@
 #define EPT_RAM_IR_PTR(base, regnum)			((volatile void *)(base + EPT_RAM_IR_OF * regnum))		// EPT RAM Pointer to IR timing
 #define EPT_CTR_PTR(base, regnum)				((volatile void *)(base + EPT_CTR_LO_OF * regnum))		// EPT Counter Pointer
 #define EPT_TASK_PTR(base, regnum)				((volatile void *)(base + EPT_TASK_ID_OF * regnum))		// EPT Task ID pointer
+#define EPT_TASK_SWITCH_PTR(base, regnum)		((volatile void *)(base + EPT_TASK_SWITCH_OF * regnum))	// EPT Task switch pointer
 #define EPT_ISR_PTR(base, regnum)				((volatile void *)(base + EPT_ISR_OF * regnum))			// EPT ISR pointer
 #define EPT_CTX_SAVE_PTR(base, regnum)			((volatile void *)(base + EPT_CTX_SAVE_OF * regnum))	// EPT Context Save pointer
 #define EPT_CTX_REST_PTR(base, regnum)			((volatile void *)(base + EPT_CTX_REST_OF * regnum))	// EPT Context Restore pointer
 
+//----------------------------
+// Probe custom instruction (n)
+//----------------------------
+#define EPT_CI_N_TASK_ID						0						// Task ID
+#define EPT_CI_N_TASK_SWITCH					1						// Task switch
+#define EPT_CI_N_ISR							2						// ISR handling
+#define EPT_CI_N_CTX_SAVE						3						// Context saving
+#define EPT_CI_N_CTX_REST						4						// Context restoring
+#define EPT_CI_N_CTR_LO							5						// No probe: counter LO result only
+
+#ifdef ALT_CI_EPT_CI
+#define EPT_CI_WRITE_TASK(data)					((void)ALT_CI_EPT_CI(EPT_CI_N_TASK_ID, ((data) & EPT_TASK_ID_MASK)))			// Task ID probe
+#define EPT_CI_WRITE_TASK_SWITCH(data)			((void)ALT_CI_EPT_CI(EPT_CI_N_TASK_SWITCH, ((data) & EPT_RAM_ADDRESS_MAX)))	// Task switch probe
+#define EPT_CI_WRITE_ISR(data)					((void)ALT_CI_EPT_CI(EPT_CI_N_ISR, ((data) & 1)))								// ISR handling probe
+#define EPT_CI_WRITE_CTX_SAVE(data)				((void)ALT_CI_EPT_CI(EPT_CI_N_CTX_SAVE, ((data) & 1)))						// Context saving probe
+#define EPT_CI_WRITE_CTX_REST(data)				((void)ALT_CI_EPT_CI(EPT_CI_N_CTX_REST, ((data) & 1)))						// Context restoring probe
+#define EPT_CI_READ_CTR_LO						((alt_u32)ALT_CI_EPT_CI(EPT_CI_N_CTR_LO, 0))									// Read counter LOW
+#endif
+
 //----------------------
 // Type definitions
 //----------------------
@@ -100,15 +419,60 @@ typedef struct eptCounter
 	alt_u8 High;
 } eptCounter_t;
 
+// Task Record
+typedef struct eptTask
+{
+	alt_u32 sumLo;				// Summarized cycles LOW
+	alt_u32 sumHi;				// Summarized cycles HIGH
+	alt_u32 count;				// Number of invocations
+	alt_u32 min;				// Shortest invocation
+	alt_u32 max;				// Longest invocation
+	alt_u32 inclLo;				// Summarized cycles with the nested regions LOW
+	alt_u32 inclHi;				// Summarized cycles with the nested regions HIGH
+	alt_u32 parent;				// Parent link: {Valid, Multiple, Parent ID}
+} eptTask_t;
+
 // Interrupt Timing Data
 typedef struct eptIR
 {
-	alt_u32 irLatency;
-	alt_u32 ctxSave;
-	alt_u32 isrHandle;
-	alt_u32 ctxRestore;
+	eptTask_t irLatency;
+	eptTask_t ctxSave;
+	eptTask_t isrHandle;
+	eptTask_t ctxRestore;
 } eptIR_t;
 
+// Latency histogram of a slot
+typedef struct eptHist
+{
+	alt_u32 layout;				// Layout at the readout: {Enable, Shift, Log2}
+	alt_u32 bin[EPT_HIST_BINS];	// Updates counted into the buckets
+	alt_u32 count;				// Updates of the slot
+} eptHist_t;
+
+// Sampling profiler counts
+typedef struct eptSample
+{
+	alt_u32 hits[EPT_SAMPLE_RECORDS];	// Samples of the records: task IDs, IR latency, Context Save, ISR, Context Restore
+	alt_u32 idle;				// Samples without a task and an exception
+	alt_u32 count;				// Every sample
+} eptSample_t;
+
+// Decoded trace event
+typedef struct eptEvent
+{
+	alt_u32 type;
+	alt_u32 taskID;
+	alt_u64 timestamp;			// Counter value at the event
+} eptEvent_t;
+
+// Trace decoder state kept between drains
+typedef struct eptTrace
+{
+	alt_u64 timestamp;			// Timestamp of the last decoded record
+	alt_u64 extension;			// Pending upper Delta bits
+	int overflow;				// Record(s) were dropped
+} eptTrace_t;
+
 
 
 #endif	//  EPT_H_
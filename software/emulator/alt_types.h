@@ -0,0 +1,20 @@
+//========================================
+// Host stand-in for the HAL alt_types.h
+//========================================
+
+#ifndef ALT_TYPES_H_
+#define ALT_TYPES_H_
+
+typedef signed char				alt_8;
+typedef unsigned char			alt_u8;
+typedef signed short			alt_16;
+typedef unsigned short			alt_u16;
+typedef signed int				alt_32;
+typedef unsigned int			alt_u32;
+typedef signed long long		alt_64;
+typedef unsigned long long		alt_u64;
+
+#define ALT_INLINE				__inline__
+#define ALT_ALWAYS_INLINE		__attribute__ ((always_inline))
+
+#endif	// ALT_TYPES_H_
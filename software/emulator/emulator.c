@@ -0,0 +1,365 @@
+//==============================================
+// EPT Host Emulator: Bus and MMIO trapping
+//==============================================
+
+/*  @Brief:
+*		- The peripheral spans are mapped PROT_NONE at their system.h base addresses
+*		- A pointer access faults (SIGSEGV), the span is opened and the instruction is single stepped (SIGTRAP)
+*		- Reads are served from the model before the step, writes are forwarded to the model after it
+*		- A host access can be wider than a bus word (e.g. struct copies): the following words are
+*		  served side effect free, and forwarded after the step only if their content changed
+*		- A registered EPT ISR is dispatched after a bus access instruction while ept_irq is set (not nested)
+*		- A probe custom instruction presents the probe on the conduit for its start cycle, then idles
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "system.h"
+#include "emulator.h"
+#include "sys/alt_irq.h"
+
+#if !defined(__linux__) || !defined(__x86_64__)
+	#error "The EPT host emulator requires Linux on x86-64"
+#endif
+
+#define EMU_PAGE_SIZE				4096UL
+#define EMU_TRAP_FLAG				0x100				// EFLAGS.TF
+#define EMU_PF_WRITE				0x2					// Page fault error code: write access
+#define EMU_TRAP_WORDS				4					// Widest host access (16 bytes) in bus words
+#define EMU_CLOCK_RATIO				(EPT_MEASURE_CLOCK_FREQ / ALT_CPU_FREQ)							// Counter cycles per system clock cycle
+#ifdef ALT_CI_EPT_CI
+	#define EMU_PROBE_CYCLES		EMU_CI_CYCLES
+#else
+	#define EMU_PROBE_CYCLES		EMU_ACCESS_CYCLES
+#endif
+#define EMU_PROBE_OFFSET			(EMU_PROBE_CYCLES * EMU_CLOCK_RATIO)							// Probe interval in counter cycles
+#define EMU_IRQ_OFFSET				(EMU_ACCESS_CYCLES * EMU_CLOCK_RATIO)							// Timer IRQ write to the first probe
+
+// Emulated slave
+typedef struct emuSlave
+{
+	unsigned long base;
+	unsigned long span;
+	int readWait;										// Wait states: the address is held
+	int readLatency;									// Fixed latency: readdata follows the address phase
+	emuBus_t bus;
+} emuSlave_t;
+
+// Pending trapped pointer access
+typedef struct emuTrap
+{
+	emuSlave_t *slave;
+	volatile alt_u32 *word;								// Accessed word in the mapped span
+	alt_u32 regnum;
+	alt_u32 words;										// Words up to EMU_TRAP_WORDS within the span
+	alt_u32 peek[EMU_TRAP_WORDS];						// Side effect free content before the access
+	int write;
+} emuTrap_t;
+
+//-----------------------------------------
+// Internal state and prototypes
+//-----------------------------------------
+static emuSlave_t eptSlave = {EPT_BASE, EPT_SPAN, 0, EMU_READ_LATENCY, {0, 0, 0, 0, 0}};
+static emuSlave_t timerSlave = {TIMER_IR_BASE, TIMER_IR_SPAN, EMU_READ_WAIT, 0, {0, 0, 0, 0, 0}};
+static emuProbe_t probe;
+static emuStat_t stat;
+static emuTrap_t trap;
+static alt_isr_func eptIsr;
+static void *eptIsrContext;
+static int isrActive;
+
+static void emuClock(void);
+static void emuIdle(int cycles);
+static void emuWait(emuSlave_t *slave);
+static emuSlave_t *emuSlaveGet(unsigned long address);
+static alt_u32 emuReaddata(emuSlave_t *slave);
+static alt_u32 emuPeek(emuSlave_t *slave);
+static void emuMap(emuSlave_t *slave);
+static void emuProtect(emuSlave_t *slave, int prot);
+static void emuFaultHandler(int sig, siginfo_t *info, void *context);
+static void emuStepHandler(int sig, siginfo_t *info, void *context);
+static void emuReport(void);
+
+//-----------------------------------------
+// Bus access
+//-----------------------------------------
+
+// Avalon read transfer: address is held for the wait states (and while the slave asserts waitrequest),
+// readdata is sampled in the last cycle or after the fixed read latency of a pipelined slave (single cycle address phase)
+alt_u32 emuIord(unsigned long base, alt_u32 regnum)
+{
+	emuSlave_t *slave = emuSlaveGet(base);
+	alt_u32 data;
+
+	slave->bus.address = regnum;
+	slave->bus.chipselect = 1;
+	slave->bus.read = 1;
+	emuWait(slave);
+	emuIdle(slave->readWait);
+	if (slave->readLatency)
+	{
+		emuClock();
+		slave->bus.chipselect = 0;
+		slave->bus.read = 0;
+		emuIdle(slave->readLatency - 1);
+	}
+	data = emuReaddata(slave);
+	emuClock();
+	slave->bus.chipselect = 0;
+	slave->bus.read = 0;
+	emuIdle(EMU_ACCESS_CYCLES - slave->readWait - slave->readLatency - 1);
+
+	if (slave == &eptSlave) stat.eptRead++;
+		else stat.timerRead++;
+	emuInterrupt();
+
+	return data;
+}
+
+// Avalon write transfer: write strobe for one cycle after the slave deasserts waitrequest
+void emuIowr(unsigned long base, alt_u32 regnum, alt_u32 data)
+{
+	emuSlave_t *slave = emuSlaveGet(base);
+
+	slave->bus.address = regnum;
+	slave->bus.writedata = data;
+	slave->bus.chipselect = 1;
+	slave->bus.write = 1;
+	emuWait(slave);
+	emuClock();
+	slave->bus.chipselect = 0;
+	slave->bus.write = 0;
+	emuIdle(EMU_ACCESS_CYCLES - 1);
+
+	if (slave == &eptSlave) stat.eptWrite++;
+		else stat.timerWrite++;
+	emuInterrupt();
+}
+
+// Probe custom instruction: the result is the counter LO word at the start cycle
+alt_u32 emuCustom(alt_u32 n, alt_u32 dataa)
+{
+	alt_u32 result = eptModelProbeCounter();
+
+	probe.valid = 1;
+	probe.select = n & 0x7;										// 3 bit probe select
+	probe.data = dataa;
+	emuClock();
+	probe.valid = 0;
+	emuIdle(EMU_CI_CYCLES - 1);
+
+	stat.eptCustom++;
+	emuInterrupt();
+
+	return result;
+}
+
+// Get bus access statistics
+emuStat_t emuStatGet(void)
+{
+	return stat;
+}
+
+// Dispatch a pending EPT interrupt between instructions
+void emuInterrupt(void)
+{
+	if (!eptIsr || isrActive || trap.slave || !eptModelIrq()) return;
+
+	isrActive = 1;
+	stat.eptIrq++;
+	eptIsr(eptIsrContext);
+	isrActive = 0;
+}
+
+// Enhanced HAL interrupt API: the EPT sender is the only interrupt source of the emulated system
+int alt_ic_isr_register(alt_u32 ic_id, alt_u32 irq, alt_isr_func isr, void *isr_context, void *flags)
+{
+	if ((ic_id != EPT_IRQ_INTERRUPT_CONTROLLER_ID) || (irq != EPT_IRQ)) return -1;
+
+	eptIsr = isr;
+	eptIsrContext = isr_context;
+	(void)flags;
+
+	return 0;
+}
+
+// === Functions with Internal Access ===
+// One system clock cycle: the timer IRQ line is wired to ept_irc
+static void emuClock(void)
+{
+	int irc = timerModelIrq();
+
+	timerModelClock(&timerSlave.bus);
+	eptModelClock(&eptSlave.bus, &probe, irc);
+	stat.cycles++;
+}
+
+static void emuIdle(int cycles)
+{
+	while (cycles-- > 0)
+	{
+		emuClock();
+	}
+}
+
+// Clock cycles while the slave asserts waitrequest: the timerIR slave has fixed wait states
+static void emuWait(emuSlave_t *slave)
+{
+	while ((slave == &eptSlave) && eptModelWaitrequest(&slave->bus))
+	{
+		emuClock();
+	}
+}
+
+static emuSlave_t *emuSlaveGet(unsigned long address)
+{
+	if ((address >= eptSlave.base) && (address < eptSlave.base + eptSlave.span)) return &eptSlave;
+	if ((address >= timerSlave.base) && (address < timerSlave.base + timerSlave.span)) return &timerSlave;
+
+	fprintf(stderr, "EMU: access to unmapped base 0x%lx\n", address);
+	abort();
+}
+
+static alt_u32 emuReaddata(emuSlave_t *slave)
+{
+	if (slave == &eptSlave) return eptModelReaddata(&slave->bus);
+
+	return timerModelReaddata(&slave->bus);
+}
+
+static alt_u32 emuPeek(emuSlave_t *slave)
+{
+	if (slave == &eptSlave) return eptModelPeek(&slave->bus, timerModelIrq());
+
+	return timerModelReaddata(&slave->bus);
+}
+
+//-----------------------------------------
+// MMIO trapping
+//-----------------------------------------
+static void emuMap(emuSlave_t *slave)
+{
+	void *span = mmap((void *)slave->base, slave->span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	if (span != (void *)slave->base)
+	{
+		fprintf(stderr, "EMU: unable to map 0x%lx\n", slave->base);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void emuProtect(emuSlave_t *slave, int prot)
+{
+	mprotect((void *)slave->base, (slave->span + EMU_PAGE_SIZE - 1) & ~(EMU_PAGE_SIZE - 1), prot);
+}
+
+// Pointer access to a span: serve a read now, step over the instruction to catch a write
+static void emuFaultHandler(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+	unsigned long address = (unsigned long)info->si_addr;
+	emuSlave_t *slave = NULL;
+	alt_u32 i;
+
+	if ((address >= eptSlave.base) && (address < eptSlave.base + eptSlave.span)) slave = &eptSlave;
+	if ((address >= timerSlave.base) && (address < timerSlave.base + timerSlave.span)) slave = &timerSlave;
+	if (!slave)
+	{
+		signal(SIGSEGV, SIG_DFL);						// Genuine fault: let it crash
+		return;
+	}
+
+	trap.slave = slave;
+	trap.regnum = (alt_u32)((address - slave->base) / (SYSTEM_BUS_WIDTH / 8));
+	trap.word = (volatile alt_u32 *)(slave->base + trap.regnum * (SYSTEM_BUS_WIDTH / 8));
+	trap.write = (uc->uc_mcontext.gregs[REG_ERR] & EMU_PF_WRITE) != 0;
+	trap.words = (alt_u32)(slave->span / (SYSTEM_BUS_WIDTH / 8)) - trap.regnum;
+	if (trap.words > EMU_TRAP_WORDS) trap.words = EMU_TRAP_WORDS;
+
+	emuProtect(slave, PROT_READ | PROT_WRITE);
+	for (i=0; i<trap.words; i++)
+	{
+		slave->bus.address = trap.regnum + i;
+		trap.peek[i] = emuPeek(slave);					// Side effect free values for partial and wide accesses
+		trap.word[i] = trap.peek[i];
+	}
+	if (!trap.write)
+	{
+		*trap.word = emuIord(slave->base, trap.regnum);
+	}
+	uc->uc_mcontext.gregs[REG_EFL] |= EMU_TRAP_FLAG;
+	(void)sig;
+}
+
+// Instruction is executed: forward the stored word and close the span
+static void emuStepHandler(int sig, siginfo_t *info, void *context)
+{
+	ucontext_t *uc = (ucontext_t *)context;
+	alt_u32 i;
+
+	uc->uc_mcontext.gregs[REG_EFL] &= ~EMU_TRAP_FLAG;
+	if (!trap.slave) return;
+	if (trap.write)
+	{
+		emuIowr(trap.slave->base, trap.regnum, *trap.word);
+		for (i=1; i<trap.words; i++)
+		{
+			if (trap.word[i] != trap.peek[i]) emuIowr(trap.slave->base, trap.regnum + i, trap.word[i]);
+		}
+	}
+	emuProtect(trap.slave, PROT_NONE);
+	trap.slave = NULL;
+	emuInterrupt();										// The ISR accesses the EPT through IORD/IOWR only
+	(void)sig;
+	(void)info;
+}
+
+//-----------------------------------------
+// Emulator lifecycle
+//-----------------------------------------
+__attribute__((constructor))
+static void emuInit(void)
+{
+	struct sigaction action;
+
+	emuMap(&eptSlave);
+	emuMap(&timerSlave);
+	memset(&action, 0, sizeof(action));
+	action.sa_flags = SA_SIGINFO;
+	action.sa_sigaction = emuFaultHandler;
+	sigaction(SIGSEGV, &action, NULL);
+	action.sa_sigaction = emuStepHandler;
+	sigaction(SIGTRAP, &action, NULL);
+
+	timerModelReset();
+	eptModelReset();
+	atexit(emuReport);
+}
+
+// Probe overhead and calibration summary
+static void emuReport(void)
+{
+	alt_u32 offset = eptModelOffset();
+	alt_u32 excOffset[4];
+	int i, excPass = 1;
+
+	for (i=0; i<4; i++)
+	{
+		excOffset[i] = eptModelExceptionOffset(i);
+		if (excOffset[i] != ((i == 0) ? EMU_IRQ_OFFSET : EMU_PROBE_OFFSET)) excPass = 0;
+	}
+
+	printf("\n === EPT EMULATOR ===\n");
+	printf(" >> Model cycles: %llu, EPT R/W/CI: %u/%u/%u, Timer R/W: %u/%u, EPT IRQ: %u\n",
+		   (unsigned long long)stat.cycles, (unsigned int)stat.eptRead, (unsigned int)stat.eptWrite, (unsigned int)stat.eptCustom,
+		   (unsigned int)stat.timerRead, (unsigned int)stat.timerWrite, (unsigned int)stat.eptIrq);
+	printf(" >> Probe write interval: %d cycles, EPT I/O offset: %u cycles -> %s\n",
+		   EMU_PROBE_OFFSET, (unsigned int)offset, (offset == EMU_PROBE_OFFSET) ? "PASS" : "FAIL - calibration error");
+	printf(" >> Exception I/O offsets: %u/%u/%u/%u cycles -> %s\n", (unsigned int)excOffset[0], (unsigned int)excOffset[1],
+		   (unsigned int)excOffset[2], (unsigned int)excOffset[3], (excPass) ? "PASS" : "FAIL - calibration error");
+}
@@ -0,0 +1,95 @@
+//========================================
+// EPT Host Emulator Header
+//========================================
+
+/*  @Brief:
+*		- Runs the driver, service and test layers on a Linux (x86-64) host
+*		- IORD/IOWR and direct pointer accesses on EPT_BASE and TIMER_IR_BASE are routed
+*		  into cycle based models of hdl/eptAV.v, hdl/ept.v, hdl/counter.v and the timerIR block
+*		- Only bus accesses consume model time: each one advances the clock by EMU_ACCESS_CYCLES
+*		- The probe custom instruction (ALT_CI_EPT_CI) takes EMU_CI_CYCLES without a bus access
+*/
+
+#ifndef EMULATOR_H_
+#define EMULATOR_H_
+
+#include "alt_types.h"
+
+//------------------------
+// Bus timing (in cycles)
+//------------------------
+#ifndef EMU_ACCESS_CYCLES
+#define EMU_ACCESS_CYCLES				6			// NIOSii/e cycles of a single load/store instruction
+#endif
+#ifndef EMU_CI_CYCLES
+#define EMU_CI_CYCLES					3			// Assumed NIOSii/e cycles of the fixed 1 cycle custom instruction
+#endif
+#ifndef EMU_READ_WAIT
+#define EMU_READ_WAIT					1			// Avalon read wait states of the timerIR slave
+#endif
+#ifndef EMU_READ_LATENCY
+#define EMU_READ_LATENCY				1			// Avalon fixed read latency of the EPT slave (pipelined)
+#endif
+
+//----------------------
+// Type definitions
+//----------------------
+
+// Avalon MM slave side signals
+typedef struct emuBus
+{
+	alt_u32 address;								// Word address within the slave span
+	alt_u32 writedata;
+	int chipselect;
+	int write;
+	int read;
+} emuBus_t;
+
+// Probe conduit of the custom instruction (eptCI.v)
+typedef struct emuProbe
+{
+	int valid;										// Start cycle of the instruction
+	alt_u32 select;									// n
+	alt_u32 data;									// dataa
+} emuProbe_t;
+
+// Bus access statistics
+typedef struct emuStat
+{
+	alt_u64 cycles;
+	alt_u32 eptRead;
+	alt_u32 eptWrite;
+	alt_u32 timerRead;
+	alt_u32 timerWrite;
+	alt_u32 eptIrq;									// Dispatched EPT interrupts
+	alt_u32 eptCustom;								// Probe custom instructions
+} emuStat_t;
+
+//---------------------
+// Function Prototypes
+//---------------------
+// Bus access
+alt_u32 emuIord(unsigned long base, alt_u32 regnum);					// Avalon read transfer
+void emuIowr(unsigned long base, alt_u32 regnum, alt_u32 data);			// Avalon write transfer
+emuStat_t emuStatGet(void);												// Get bus access statistics
+void emuInterrupt(void);												// Dispatch a pending EPT interrupt between instructions
+alt_u32 emuCustom(alt_u32 n, alt_u32 dataa);							// Probe custom instruction
+
+// EPT model
+void eptModelReset(void);
+void eptModelClock(const emuBus_t *bus, const emuProbe_t *probe, int irc);	// Rising edge of ept_clock
+alt_u32 eptModelReaddata(const emuBus_t *bus);							// ept_readdata: registered at the read, RAM output
+int eptModelWaitrequest(const emuBus_t *bus);							// ept_waitrequest: the transfer is held
+alt_u32 eptModelPeek(const emuBus_t *bus, int irc);						// Side effect free content at the bus address
+alt_u32 eptModelProbeCounter(void);										// ept_probe_counter: counter LO word
+alt_u32 eptModelOffset(void);											// Actual I/O offset register
+alt_u32 eptModelExceptionOffset(int param);								// Actual exception I/O offset register
+int eptModelIrq(void);													// ept_irq interrupt sender output
+
+// Timer model
+void timerModelReset(void);
+void timerModelClock(const emuBus_t *bus);
+alt_u32 timerModelReaddata(const emuBus_t *bus);
+int timerModelIrq(void);												// Interrupt request output
+
+#endif	// EMULATOR_H_
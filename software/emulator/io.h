@@ -0,0 +1,21 @@
+//========================================
+// Host stand-in for the HAL io.h
+//========================================
+
+/*  @Brief:
+*		- Every native register access is forwarded to the emulated Avalon bus
+*		- Direct pointer accesses on the peripheral spans are trapped by the emulator as well
+*/
+
+#ifndef IO_H_
+#define IO_H_
+
+#include "alt_types.h"
+#include "emulator.h"
+
+#define IORD(BASE, REGNUM)							emuIord((unsigned long)(BASE), (alt_u32)(REGNUM))
+#define IOWR(BASE, REGNUM, DATA)					emuIowr((unsigned long)(BASE), (alt_u32)(REGNUM), (alt_u32)(DATA))
+#define IORD_32DIRECT(BASE, OFFSET)					emuIord((unsigned long)(BASE), (alt_u32)(OFFSET) >> 2)
+#define IOWR_32DIRECT(BASE, OFFSET, DATA)			emuIowr((unsigned long)(BASE), (alt_u32)(OFFSET) >> 2, (alt_u32)(DATA))
+
+#endif	// IO_H_
@@ -0,0 +1,1295 @@
+//=====================================================
+// EPT Host Emulator: eptAV / ept / counter model
+//=====================================================
+
+/*  @Brief:
+*		- Cycle based model of hdl/eptAV.v with the ept.v FSM, the counter.v cycle counter
+*		  and the on-chip task record RAM behind the conduit (synchronous read, byte enables)
+*		- The trace encoder of ept.v and the trace.v ring buffer are modelled the same way
+*		- The RAM holds both result banks: port A serves the active bank, port B the frozen one
+*		- Record updates run in the read -> summarize -> store pipeline of ept.v with its forwarding
+*		- The dma.v master writes into host memory without wait states: the destination has to be a
+*		  32 bit address (the emulator is linked without PIE)
+*		- A probe of the custom instruction replaces the bus address and write data for its cycle
+*		- histogram.v counts the summarized updates at once, its clear sweep takes one cycle per bucket
+*		- budget.v: the budget of the running task reaches the watchdog of ept.v one cycle after its address
+*		- sampler.v counts a sample at once, its clear sweep takes one cycle per record
+*		- trigger.v: its registered start and stop pulses reach ept.v with the software start and stop
+*		- Each register mirrors its HDL counterpart: *Eval() is the combinational logic,
+*		  eptModelClock() is the rising edge
+*/
+
+#include <string.h>
+#include "system.h"
+#include "emulator.h"
+
+//---------------------------------
+// HDL parameters
+//---------------------------------
+#define ADDRESS_WIDTH					EPT_ADDRESS_WIDTH
+#define COUNTER_SIZE					40
+#define MEASURE_RATIO					(EPT_MEASURE_CLOCK_FREQ / ALT_CPU_FREQ)		// Measurement clock cycles per ept_clock cycle
+#define RECORD_SIZE						EPT_RECORD_SIZE
+#define RECORD_WORDS					(1u << RECORD_SIZE)
+#define RAM_SIZE						(ADDRESS_WIDTH - RECORD_SIZE - 1)
+#define TASK_ID_SIZE					(RAM_SIZE + 1)
+#define OFFSET_SIZE						8
+#define RESERVED_PARAMETER_SIZE			4
+#define RAM_ADDRESS_MAX					((1u << RAM_SIZE) - 1)
+#define RAM_ADDRESS_RESERVED			(RAM_ADDRESS_MAX - RESERVED_PARAMETER_SIZE + 1)
+#define COUNTER_MASK					((1ULL << COUNTER_SIZE) - 1)
+#define TASK_ID_MASK					((1u << TASK_ID_SIZE) - 1)
+#define TASK_ACTIVE(id)					(((id) >> (TASK_ID_SIZE - 1)) & 1)
+#define DATA_MAX						0xffffffffu
+#define TRACE_SIZE						EPT_TRACE_SIZE
+#define TRACE_DEPTH						(1u << TRACE_SIZE)
+#define TRACE_ID_SIZE					(TASK_ID_SIZE - 1)
+#define TRACE_DELTA_SIZE				(32 - 4 - TRACE_ID_SIZE)
+#define TRACE_EXTENSION					0xfu
+#define IRQ_MASK						0x3fu				// IRQ_SOURCES bits
+#define IRQ_DONE						0
+#define IRQ_ACCUMULATOR					1
+#define IRQ_TRACE						2
+#define IRQ_SWAP						3
+#define IRQ_DMA							4
+#define IRQ_OVERRUN						5
+#define DMA_ENABLE						0x1u
+#define DMA_AT_STOP						0x2u
+#define DMA_TRACE						0x4u
+#define DMA_CONTROL_MASK				0x7u
+#define WORD_ADDRESS_MAX				((1u << (ADDRESS_WIDTH - 1)) - 1)
+#define PREEMPT_DEPTH					EPT_PREEMPT_DEPTH
+#define HIST_SIZE						EPT_HIST_SIZE
+#define HIST_BINS						(1u << HIST_SIZE)
+#define HIST_SLOTS						8					// 4 selected tasks, 4 exception records
+#define HIST_INDEX_MASK					((HIST_SLOTS * HIST_BINS) - 1)
+#define SAMPLE_CONTROL_MASK				0x8000000fu			// {Enable, Dither bits}
+#define SAMPLE_PERIOD_MIN				4
+#define LFSR_SEED						0xace1u
+#define LFSR_TAPS						0xb400u				// x^16 + x^14 + x^13 + x^11 + 1
+#define TRIGGER_CONTROL_MASK			0x20000077u			// {Pre-trigger, Stop, Start condition}
+
+// Task record fields
+#define RECORD_SUM						0					// LO, HI
+#define RECORD_COUNT					2
+#define RECORD_MIN						3
+#define RECORD_MAX						4
+#define RECORD_INCLUSIVE				5					// LO, HI
+#define RECORD_PARENT					7
+#define PARENT_VALID					(1u << 31)
+#define PARENT_MULTIPLE					(1u << 30)
+
+// Memory Mapped Reference Addresses
+#define MM_REGISTER_BASE				(1u << (ADDRESS_WIDTH - 1))
+#define MM_COUNTER_LO					(MM_REGISTER_BASE + 0x0)
+#define MM_COUNTER_HI					(MM_REGISTER_BASE + 0x1)
+#define MM_READY						(MM_REGISTER_BASE + 0x2)
+#define MM_START						(MM_REGISTER_BASE + 0x3)
+#define MM_STOP							(MM_REGISTER_BASE + 0x4)
+#define MM_TASK_ID						(MM_REGISTER_BASE + 0x5)
+#define MM_OFFSET						(MM_REGISTER_BASE + 0x6)
+#define MM_ISR							(MM_REGISTER_BASE + 0x7)
+#define MM_CTX_SAVE						(MM_REGISTER_BASE + 0x8)
+#define MM_CTX_RESTORE					(MM_REGISTER_BASE + 0x9)
+#define MM_EXECUTED						(MM_REGISTER_BASE + 0xa)
+#define MM_RESET						(MM_REGISTER_BASE + 0xb)
+#define MM_MODE							(MM_REGISTER_BASE + 0xc)
+#define MM_TRACE_LEVEL					(MM_REGISTER_BASE + 0xd)
+#define MM_TRACE_DATA					(MM_REGISTER_BASE + 0xe)
+#define MM_SWAP							(MM_REGISTER_BASE + 0xf)
+#define MM_TASK_SWITCH					(MM_REGISTER_BASE + 0x10)
+#define MM_OFFSET_IR					(MM_REGISTER_BASE + 0x11)				// .. MM_OFFSET_CTX_REST
+#define MM_OFFSET_CTX_REST				(MM_REGISTER_BASE + 0x14)
+#define MM_LOST_EVENTS					(MM_REGISTER_BASE + 0x15)
+#define MM_IRQ_STATUS					(MM_REGISTER_BASE + 0x16)
+#define MM_IRQ_MASK						(MM_REGISTER_BASE + 0x17)
+#define MM_DMA_CONTROL					(MM_REGISTER_BASE + 0x18)
+#define MM_DMA_ADDRESS					(MM_REGISTER_BASE + 0x19)
+#define MM_DMA_PERIOD					(MM_REGISTER_BASE + 0x1a)
+#define MM_FILL_RANGE					(MM_REGISTER_BASE + 0x1b)
+#define MM_FILL							(MM_REGISTER_BASE + 0x1c)
+#define MM_PREEMPT						(MM_REGISTER_BASE + 0x1d)
+#define MM_HIST_LAYOUT					(MM_REGISTER_BASE + 0x1e)
+#define MM_HIST_SELECT_LO				(MM_REGISTER_BASE + 0x1f)
+#define MM_HIST_SELECT_HI				(MM_REGISTER_BASE + 0x20)
+#define MM_HIST_ADDRESS					(MM_REGISTER_BASE + 0x21)
+#define MM_HIST_DATA					(MM_REGISTER_BASE + 0x22)
+#define MM_BUDGET_INDEX					(MM_REGISTER_BASE + 0x23)
+#define MM_BUDGET						(MM_REGISTER_BASE + 0x24)
+#define MM_OVERRUNS						(MM_REGISTER_BASE + 0x25)
+#define MM_OVERRUN_FIRST				(MM_REGISTER_BASE + 0x26)
+#define MM_OVERRUN_TIME_LO				(MM_REGISTER_BASE + 0x27)
+#define MM_OVERRUN_TIME_HI				(MM_REGISTER_BASE + 0x28)
+#define MM_SAMPLE_CONTROL				(MM_REGISTER_BASE + 0x29)
+#define MM_SAMPLE_PERIOD				(MM_REGISTER_BASE + 0x2a)
+#define MM_SAMPLE_ADDRESS				(MM_REGISTER_BASE + 0x2b)
+#define MM_SAMPLE_HITS					(MM_REGISTER_BASE + 0x2c)
+#define MM_SAMPLE_IDLE					(MM_REGISTER_BASE + 0x2d)
+#define MM_TRIGGER_CONTROL				(MM_REGISTER_BASE + 0x2e)
+#define MM_TRIGGER_START				(MM_REGISTER_BASE + 0x2f)
+#define MM_TRIGGER_STOP					(MM_REGISTER_BASE + 0x30)
+#define MM_TRIGGER_PRE					(MM_REGISTER_BASE + 0x31)
+#define MM_TRIGGER_TIME_LO				(MM_REGISTER_BASE + 0x32)
+#define MM_TRIGGER_TIME_HI				(MM_REGISTER_BASE + 0x33)
+
+// Probe selects of the custom instruction
+#define PROBE_CTX_RESTORE				4					// Above: no register write
+
+// FSM State Definitions
+#define STATE_IDLE						0
+#define STATE_WATCH						1
+#define STATE_EXCEPTION					2
+#define STATE_DONE						4
+
+// trigger.v State Definitions and conditions
+#define TRIGGER_IDLE					0
+#define TRIGGER_ARMED					1
+#define TRIGGER_TRIGGERED				2
+#define START_NOW						0
+#define START_TASK						1
+#define START_IRQ						2
+#define START_DELAY						3
+#define STOP_TASK						1
+#define STOP_IRQ						2
+#define STOP_CYCLES						3
+#define STOP_EVENTS						4
+
+// dma.v State Definitions
+#define DMA_IDLE						0
+#define DMA_READ						1
+#define DMA_LATCH						2
+#define DMA_RECORD						3
+#define DMA_TRACE_COPY					4
+#define DMA_COMPLETE					5
+
+//---------------------------------
+// Type definitions
+//---------------------------------
+
+// ept.v and counter.v registers
+typedef struct eptCore
+{
+	int state;
+	alt_u32 taskID;
+	alt_u32 ramAddress;
+	alt_u32 taskAddress;
+	alt_u32 stopAddress;
+	int taskStartCCR, taskStopCCR;
+	int irqStartCCR, isrStartCCR, isrStopCCR;
+	int contextSaveStartCCR, contextSaveStopCCR, contextRestoreStartCCR, contextRestoreStopCCR;
+	int irq, isr, contextSave, contextRestore;
+	alt_u64 startTimestamp, taskPartTime, elapsed;
+	int summarize, store, forward;									// Record update pipeline stages
+	int region;														// Task stop: inclusive cycles and parent link are summarized
+	alt_u64 inclusive;
+	alt_u32 parent;
+	int accumulatorWarn;											// The summarized record crossed half of its range
+	alt_u32 storeAddress, forwardAddress;
+	alt_u32 record[RECORD_WORDS];
+	alt_u32 forwardRecord[RECORD_WORDS];
+	alt_u32 lostEvents;
+	alt_u64 counter;
+	alt_u32 tracePending;
+	alt_u64 traceTimestamp, traceLast;
+	alt_u32 traceTask;
+	int traceExtension;
+	int taskPreemptCCR;
+	alt_u32 suspendAddress;										// RAM address of the preempted task
+	alt_u32 preemptLevel;
+	alt_u32 preemptAddress[16];									// Preemption stack: PREEMPT_DEPTH entries are used
+	alt_u64 preemptTime[16];
+	alt_u64 preemptChild[16];
+	alt_u32 preemptParent[16];
+	alt_u64 taskChildTime;											// Inclusive cycles of the finished nested regions
+	alt_u32 taskParent;												// {Valid, RAM address} of the parent region
+	int preemptOverflow;
+	int taskOverrun;												// The running invocation exceeded its budget
+	int preemptOverrun[16];
+	alt_u32 budgetAddress;											// Task address of the budget at the watchdog
+} eptCore_t;
+
+// ept.v combinational outputs
+typedef struct eptCoreOut
+{
+	eptCore_t next;
+	int ready;
+	int doneTick;
+	int counterReset;
+	int taskResume;										// The suspended task runs again
+	int overrunTick;									// The running task exceeded its budget
+	int ramWrite;
+	alt_u32 ramAddress;
+	alt_u32 ramWriteAddress;
+	const alt_u32 *ramWriteData;
+} eptCoreOut_t;
+
+// eptAV.v registers
+typedef struct eptAV
+{
+	int start, stop;
+	alt_u32 taskID;
+	int taskSwitch;
+	alt_u32 offset;
+	alt_u32 offsetException[4];							// IR latency, Context Save, ISR, Context Restore
+	int isrHandling, contextSaving, contextRestoring;
+	int executed, reset;
+	int mode;
+	alt_u32 readdata;									// Registered read path
+	int ramRead, ramFrozenRead;
+	alt_u32 ramField;
+	alt_u32 counterHigh;								// HI word latched at the LO read
+	alt_u64 counterPreload;								// Counter value at the start
+	int bank, swapPending, swapArmed, irc;
+	alt_u32 irqStatus, irqMask;
+	int traceWatermark;
+	alt_u32 dmaControl, dmaAddress, dmaPeriod, dmaTimer;
+	int fillBusy, fillFrozen;
+	alt_u32 fillAddress, fillFirst, fillLast, fillData;
+	alt_u32 histLayout, histSelect[2], histAddress, histClear;	// histClear: remaining cycles of the sweep
+	alt_u32 budgetIndex;
+	int overrunValid;											// First overrun capture
+	alt_u32 overrunAddress;
+	alt_u64 overrunTime;
+	alt_u32 sampleControl, samplePeriod, sampleAddress, sampleClear;	// sampleClear: remaining cycles of the sweep
+	alt_u32 sampleInterval, sampleIdle, lfsr;
+	alt_u32 triggerControl, triggerStartValue, triggerStopValue, triggerKeep;
+	int triggerState, triggerStart, triggerStop, triggerFired;	// trigger.v registers
+	alt_u32 triggerCount;
+	alt_u64 triggerTime;
+} eptAV_t;
+
+// dma.v registers
+typedef struct eptDma
+{
+	int state;
+	alt_u32 base, address;
+	alt_u32 recordAddress, field;
+	alt_u32 record[RECORD_WORDS];
+	alt_u32 words, count, sequence;
+} eptDma_t;
+
+// On-chip dual-port RAM on the conduit: one task record per address in each bank
+typedef struct eptRam
+{
+	alt_u32 data[2][RAM_ADDRESS_MAX + 1][RECORD_WORDS];
+	alt_u32 q[RECORD_WORDS];							// Port A
+	alt_u32 qFrozen[RECORD_WORDS];						// Port B
+} eptRam_t;
+
+// histogram.v bucket memory: {Slot, Bucket}
+typedef struct eptHistRam
+{
+	alt_u32 data[HIST_SLOTS * HIST_BINS];
+} eptHistRam_t;
+
+// budget.v memories: port A follows the running task
+typedef struct eptBudgetRam
+{
+	alt_u32 cycles[RAM_ADDRESS_MAX + 1];
+	alt_u32 overruns[RAM_ADDRESS_MAX + 1];
+	alt_u32 q, overrunsQ;								// Port A
+} eptBudgetRam_t;
+
+// sampler.v hit memory
+typedef struct eptSampleRam
+{
+	alt_u32 hits[RAM_ADDRESS_MAX + 1];
+} eptSampleRam_t;
+
+// trace.v ring buffer
+typedef struct eptTraceRam
+{
+	alt_u32 data[TRACE_DEPTH];
+	alt_u32 writePointer, readPointer;				// TRACE_SIZE + 1 bits
+	alt_u32 q;
+	int overflow;
+} eptTraceRam_t;
+
+//---------------------------------
+// Internal state and prototypes
+//---------------------------------
+static eptCore_t core;
+static eptAV_t av;
+static eptRam_t ram;
+static eptTraceRam_t trace;
+static eptDma_t dma;
+static eptHistRam_t hist;
+static eptBudgetRam_t budget;
+static eptSampleRam_t sample;
+
+static void eptCoreEval(eptCoreOut_t *out, int irc);
+static int eptTraceEncode(eptCore_t *next, alt_u32 ticks, int counterReset, alt_u32 *data);
+static alt_u32 eptTraceLevel(void);
+static alt_u32 eptRegisterRead(alt_u32 address, const eptCoreOut_t *out);
+static void eptDmaClock(int start, int traceSource);
+static void eptFillRecord(alt_u32 *record);
+static void eptHistUpdate(alt_u32 address, alt_u32 elapsed);
+
+//---------------------------------
+// Model interface
+//---------------------------------
+
+// Global reset (the RAM content is kept)
+void eptModelReset(void)
+{
+	memset(&core, 0, sizeof(core));
+	memset(&av, 0, sizeof(av));
+	memset(&dma, 0, sizeof(dma));
+	av.fillLast = WORD_ADDRESS_MAX;										// Whole bank
+	av.lfsr = LFSR_SEED;
+	trace.writePointer = 0;
+	trace.readPointer = 0;
+	trace.overflow = 0;
+	core.state = STATE_IDLE;
+}
+
+// Rising edge of ept_clock
+void eptModelClock(const emuBus_t *bus, const emuProbe_t *probe, int irc)
+{
+	static const alt_u32 probeAddress[PROBE_CTX_RESTORE + 1] = {MM_TASK_ID, MM_TASK_SWITCH, MM_ISR, MM_CTX_SAVE, MM_CTX_RESTORE};
+	emuBus_t probeBus;
+	eptCoreOut_t out;
+	int write;
+	int read;
+	int ramDirectAccess, ramFrozenAccess, ramBusy;
+	alt_u32 ramAddress, ramWriteAddress, ramFrozenAddress, ramField;
+	int ramWrite;
+	int taskStartTick, taskStopTick, taskSwitchTick, taskPreemptTick;
+	alt_u32 lostCount;
+	alt_u64 lostSum;
+	int sampleRun, sampleTick;
+	alt_u32 sampleAddress;
+	alt_u32 traceTicks, traceData, traceReadPointer;
+	int traceWrite, traceClear, tracePop, traceRetain, traceDrop, traceStore;
+	int measureStart, eventTick, triggerPre, triggerTaskStart, triggerStartHit, triggerStopHit;
+	alt_u32 triggerStartMode, triggerStopMode, triggerTaskID;
+	alt_u32 irqTicks;
+	int traceWatermark;
+	int dmaBusy, dmaRamClear, dmaTracePop, dmaDoneTick, dmaTimerRun, dmaPeriodTick, dmaStopTick, dmaStart, swapTick;
+	int fillActive;
+
+	// Register port: a probe takes the write path of its register
+	if (probe->valid && (probe->select <= PROBE_CTX_RESTORE))
+	{
+		probeBus = *bus;
+		probeBus.address = probeAddress[probe->select];
+		probeBus.writedata = probe->data;
+		probeBus.chipselect = 1;
+		probeBus.write = 1;
+		bus = &probeBus;
+	}
+	write = bus->write && bus->chipselect && !eptModelWaitrequest(bus);
+
+	eptCoreEval(&out, irc);
+	read = bus->read && bus->chipselect && !eptModelWaitrequest(bus);
+	measureStart = av.start || av.triggerStart;								// Software or trigger start
+	ramBusy = out.next.summarize || core.summarize || core.store;
+
+	// Readout DMA: outputs of the current state, the master transfer and the next state
+	dmaBusy = (dma.state != DMA_IDLE);
+	dmaRamClear = (dma.state == DMA_LATCH);
+	dmaTracePop = (dma.state == DMA_TRACE_COPY);
+	dmaDoneTick = (dma.state == DMA_COMPLETE);
+	dmaTimerRun = !out.ready && (av.dmaControl & DMA_ENABLE) && av.dmaPeriod;
+	dmaPeriodTick = dmaTimerRun && (av.dmaTimer == av.dmaPeriod - 1);
+	dmaStopTick = (av.dmaControl & DMA_AT_STOP) && out.doneTick;
+	swapTick = av.swapPending && !ramBusy && !dmaBusy && !av.fillBusy;
+	fillActive = av.fillBusy && !(av.fillFrozen && dmaBusy);
+	dmaStart = (av.dmaControl & DMA_ENABLE) && ((av.dmaControl & DMA_TRACE) ? (dmaStopTick || dmaPeriodTick) :
+			   (swapTick && !(write && (bus->address == MM_SWAP))));
+	eptDmaClock(dmaStart, (av.dmaControl & DMA_TRACE) != 0);
+	av.dmaTimer = (dmaTimerRun && !dmaPeriodTick) ? av.dmaTimer + 1 : 0;
+
+	// RAM port multiplexer: direct access writes a single field of the record (byte enables)
+	ramDirectAccess = out.ready && (bus->address != MM_START) && !(bus->address & MM_REGISTER_BASE);
+	ramAddress = (ramDirectAccess) ? ((bus->address >> RECORD_SIZE) & RAM_ADDRESS_MAX) : out.ramAddress;
+	ramWriteAddress = (ramDirectAccess) ? ramAddress : out.ramWriteAddress;
+	ramField = bus->address & (RECORD_WORDS - 1);
+	ramWrite = (ramDirectAccess) ? write : out.ramWrite;
+	ramFrozenAccess = !out.ready && !(bus->address & MM_REGISTER_BASE);
+	ramFrozenAddress = (dmaBusy) ? dma.recordAddress : (bus->address >> RECORD_SIZE) & RAM_ADDRESS_MAX;
+
+	// Registered read path: RAM fields are selected from the RAM output at the next cycle
+	av.ramRead = read && ramDirectAccess;
+	av.ramFrozenRead = read && ramFrozenAccess;
+	if (read)
+	{
+		av.readdata = eptRegisterRead(bus->address, &out);
+		av.ramField = ramField;
+	}
+	if (read && (bus->address == MM_COUNTER_LO))
+	{
+		av.counterHigh = (alt_u32)(core.counter >> 32);
+	}
+
+	// On-chip RAM
+	if (av.fillBusy && !av.fillFrozen) ramAddress = av.fillAddress;
+	if (av.fillBusy && av.fillFrozen && !dmaBusy) ramFrozenAddress = av.fillAddress;
+	memcpy(ram.q, ram.data[av.bank][ramAddress], sizeof(ram.q));
+	memcpy(ram.qFrozen, ram.data[!av.bank][ramFrozenAddress], sizeof(ram.qFrozen));
+	if (av.fillBusy && !av.fillFrozen)
+	{
+		eptFillRecord(ram.data[av.bank][av.fillAddress]);					// Port A belongs to the fill
+	}
+	else if (ramWrite)
+	{
+		if (ramDirectAccess)
+		{
+			ram.data[av.bank][ramAddress][ramField] = bus->writedata;
+		}
+		else
+		{
+			memcpy(ram.data[av.bank][ramWriteAddress], out.ramWriteData, sizeof(ram.q));
+		}
+	}
+	if (dmaBusy)
+	{
+		if (dmaRamClear) memset(ram.data[!av.bank][ramFrozenAddress], 0, sizeof(ram.q));		// The frozen bank belongs to the DMA
+	}
+	else if (av.fillBusy && av.fillFrozen)
+	{
+		eptFillRecord(ram.data[!av.bank][av.fillAddress]);
+	}
+	else if (ramFrozenAccess && write)
+	{
+		ram.data[!av.bank][ramFrozenAddress][ramField] = bus->writedata;
+	}
+
+	// Interrupt sources at the current register values
+	traceWatermark = eptTraceLevel() >= (TRACE_DEPTH >> 1);
+	irqTicks = ((alt_u32)out.doneTick << IRQ_DONE) | ((alt_u32)(core.store && core.accumulatorWarn) << IRQ_ACCUMULATOR) |
+			   ((alt_u32)(traceWatermark && !av.traceWatermark) << IRQ_TRACE) |
+			   ((alt_u32)(swapTick && !(write && (bus->address == MM_SWAP))) << IRQ_SWAP) | ((alt_u32)dmaDoneTick << IRQ_DMA) |
+			   ((alt_u32)out.overrunTick << IRQ_OVERRUN);
+
+	// ept.v DFFs with the capture control register set logic
+	taskSwitchTick = av.taskSwitch && TASK_ACTIVE(core.taskID) && TASK_ACTIVE(out.next.taskID);
+	taskPreemptTick = PREEMPT_DEPTH && !av.taskSwitch && TASK_ACTIVE(core.taskID) && TASK_ACTIVE(out.next.taskID) &&
+					  ((out.next.taskID ^ core.taskID) & RAM_ADDRESS_MAX);
+	taskStartTick = ((TASK_ACTIVE(out.next.taskID) > TASK_ACTIVE(core.taskID)) && !out.taskResume) || taskSwitchTick || taskPreemptTick;
+	taskStopTick = (TASK_ACTIVE(out.next.taskID) < TASK_ACTIVE(core.taskID)) || taskSwitchTick;
+	traceTicks = ((taskStartTick && !taskSwitchTick) << 0) | ((taskStopTick && !taskSwitchTick) << 1) | ((out.next.irq > core.irq) << 2) |
+				 ((out.next.contextSave > core.contextSave) << 3) | ((out.next.contextSave < core.contextSave) << 4) |
+				 ((out.next.isr > core.isr) << 5) | ((out.next.isr < core.isr) << 6) |
+				 ((out.next.contextRestore > core.contextRestore) << 7) | ((out.next.contextRestore < core.contextRestore) << 8) | (taskSwitchTick << 9);
+	eventTick = (core.state != STATE_IDLE) && traceTicks;					// Events of a cycle count once
+	if (!(av.mode && (core.state != STATE_IDLE))) traceTicks = 0;
+	traceWrite = eptTraceEncode(&out.next, traceTicks, out.counterReset, &traceData);
+	// Lost events: a new edge while the capture register keeps its previous event
+	lostCount = (taskStartTick && out.next.taskStartCCR) + (taskStopTick && out.next.taskStopCCR) +
+				((out.next.irq > core.irq) && out.next.irqStartCCR) +
+				((out.next.contextSave > core.contextSave) && out.next.contextSaveStartCCR) +
+				((out.next.contextSave < core.contextSave) && out.next.contextSaveStopCCR) +
+				((out.next.isr > core.isr) && out.next.isrStartCCR) + ((out.next.isr < core.isr) && out.next.isrStopCCR) +
+				((out.next.contextRestore > core.contextRestore) && out.next.contextRestoreStartCCR) +
+				((out.next.contextRestore < core.contextRestore) && out.next.contextRestoreStopCCR);
+	if (core.state == STATE_IDLE) lostCount = 0;
+	lostSum = (alt_u64)core.lostEvents + lostCount;
+	if (out.counterReset || (write && (bus->address == MM_LOST_EVENTS)))
+	{
+		out.next.lostEvents = 0;
+	}
+	else if (lostCount)
+	{
+		out.next.lostEvents = (lostSum > DATA_MAX) ? DATA_MAX : (alt_u32)lostSum;
+	}
+	if (out.counterReset || (write && (bus->address == MM_PREEMPT)))
+	{
+		out.next.preemptOverflow = 0;
+	}
+	if (taskStartTick)
+	{
+		out.next.taskStartCCR = 1;
+		out.next.taskAddress = out.next.taskID & RAM_ADDRESS_MAX;
+	}
+	if (taskPreemptTick)
+	{
+		out.next.taskPreemptCCR = 1;
+		out.next.suspendAddress = core.taskAddress;
+	}
+	if (taskStopTick)
+	{
+		out.next.taskStopCCR = 1;
+		out.next.stopAddress = core.taskAddress;							// A switch overwrites taskAddress
+	}
+	if (out.next.irq > core.irq) out.next.irqStartCCR = 1;
+	if (out.next.isr > core.isr) out.next.isrStartCCR = 1;
+	if (out.next.isr < core.isr) out.next.isrStopCCR = 1;
+	if (out.next.contextSave > core.contextSave) out.next.contextSaveStartCCR = 1;
+	if (out.next.contextSave < core.contextSave) out.next.contextSaveStopCCR = 1;
+	if (out.next.contextRestore > core.contextRestore) out.next.contextRestoreStartCCR = 1;
+	if (out.next.contextRestore < core.contextRestore) out.next.contextRestoreStopCCR = 1;
+
+	// timebase.v: the constant crossing latency of the measurement clock cancels in every difference
+	if (out.counterReset)
+	{
+		out.next.counter = av.counterPreload;									// Synchronous load at the start
+	}
+	else if (core.state != STATE_IDLE)
+	{
+		out.next.counter = (core.counter + MEASURE_RATIO) & COUNTER_MASK;
+	}
+	// histogram.v: the summarized record and its elapsed cycles
+	if (core.summarize && (av.histLayout & (1u << 31)) && !av.histClear)
+	{
+		eptHistUpdate(core.ramAddress, (core.elapsed > DATA_MAX) ? DATA_MAX : (alt_u32)core.elapsed);
+	}
+	// budget.v: port A at the running task, the first overrun since the start is captured
+	if (out.overrunTick)
+	{
+		budget.overruns[core.taskAddress] = (budget.overrunsQ == DATA_MAX) ? DATA_MAX : budget.overrunsQ + 1;
+	}
+	budget.q = budget.cycles[core.taskAddress];
+	budget.overrunsQ = budget.overruns[core.taskAddress];
+	if ((out.ready && measureStart) || (write && (bus->address == MM_OVERRUN_FIRST)))
+	{
+		av.overrunValid = 0;
+	}
+	else if (out.overrunTick && !av.overrunValid)
+	{
+		av.overrunValid = 1;
+		av.overrunAddress = core.taskAddress;
+		av.overrunTime = core.counter;
+	}
+	// sampler.v: the running task or exception phase at the end of each interval
+	sampleRun = (av.sampleControl >> 31) && ((core.state == STATE_WATCH) || (core.state == STATE_EXCEPTION));
+	sampleTick = sampleRun && !av.sampleClear && !av.sampleInterval;
+	if (!sampleRun || av.sampleClear || sampleTick)
+	{
+		av.sampleInterval = ((av.samplePeriod < SAMPLE_PERIOD_MIN) ? SAMPLE_PERIOD_MIN : av.samplePeriod) +
+							(av.lfsr & ((1u << (av.sampleControl & 0xfu)) - 1)) - 1;
+	}
+	else
+	{
+		av.sampleInterval--;
+	}
+	if (sampleTick)
+	{
+		av.lfsr = (av.lfsr >> 1) ^ ((av.lfsr & 1) ? LFSR_TAPS : 0);
+		if (core.state == STATE_EXCEPTION)
+		{
+			sampleAddress = RAM_ADDRESS_RESERVED + (core.contextRestore ? 3 : core.isr ? 2 : core.contextSave ? 1 : 0);
+			if (sample.hits[sampleAddress] != DATA_MAX) sample.hits[sampleAddress]++;
+		}
+		else if (TASK_ACTIVE(core.taskID))
+		{
+			if (sample.hits[core.taskAddress] != DATA_MAX) sample.hits[core.taskAddress]++;
+		}
+		else if (av.sampleIdle != DATA_MAX)
+		{
+			av.sampleIdle++;
+		}
+	}
+	if (write && (bus->address == MM_SAMPLE_CONTROL))
+	{
+		memset(&sample, 0, sizeof(sample));
+		av.sampleIdle = 0;
+		av.sampleClear = RAM_ADDRESS_MAX + 1;
+	}
+	else if (av.sampleClear)
+	{
+		av.sampleClear--;
+	}
+	if (read && (bus->address == MM_SAMPLE_HITS))
+	{
+		av.sampleAddress = (av.sampleAddress + 1) & RAM_ADDRESS_MAX;
+	}
+	// trigger.v: the conditions at the probe writes, the IRQ edge and the detected events
+	traceRetain = (av.triggerState == TRIGGER_ARMED) && (av.triggerControl >> 29);
+	triggerPre = (write && (bus->address == MM_TRIGGER_CONTROL)) ? (bus->writedata >> 29) & 1 : (av.triggerControl >> 29) & 1;
+	triggerStartMode = av.triggerControl & 0x7u;
+	triggerStopMode = (av.triggerControl >> 4) & 0x7u;
+	triggerTaskStart = write && (((bus->address == MM_TASK_ID) && ((bus->writedata >> (TASK_ID_SIZE - 1)) & 1)) ||
+					   (bus->address == MM_TASK_SWITCH));
+	triggerTaskID = bus->writedata & RAM_ADDRESS_MAX;
+	triggerStartHit = (triggerStartMode == START_NOW) ||
+					  ((triggerStartMode == START_TASK) && triggerTaskStart && (triggerTaskID == (av.triggerStartValue & RAM_ADDRESS_MAX))) ||
+					  ((triggerStartMode == START_IRQ) && irc && !av.irc) ||
+					  ((triggerStartMode == START_DELAY) && (av.triggerCount >= av.triggerStartValue));
+	triggerStopHit = ((triggerStopMode == STOP_TASK) && triggerTaskStart && (triggerTaskID == (av.triggerStopValue & RAM_ADDRESS_MAX))) ||
+					 ((triggerStopMode == STOP_IRQ) && irc && !av.irc) ||
+					 (((triggerStopMode == STOP_CYCLES) || (triggerStopMode == STOP_EVENTS)) && (av.triggerCount >= av.triggerStopValue));
+	av.triggerStart = 0;
+	av.triggerStop = 0;
+	if ((write && (bus->address == MM_TRIGGER_CONTROL) && !(bus->writedata >> 31)) || out.doneTick)
+	{
+		av.triggerState = TRIGGER_IDLE;											// Disarm or the end of the measurement
+	}
+	else if (av.triggerState == TRIGGER_IDLE)
+	{
+		if (write && (bus->address == MM_TRIGGER_CONTROL))
+		{
+			av.triggerCount = 0;
+			av.triggerFired = 0;
+			av.triggerTime = 0;
+			av.triggerStart = triggerPre;										// The pre-trigger records are captured
+			av.triggerState = TRIGGER_ARMED;
+		}
+	}
+	else if (av.triggerState == TRIGGER_ARMED)
+	{
+		av.triggerCount++;
+		if (triggerStartHit)
+		{
+			av.triggerCount = 0;
+			av.triggerFired = 1;
+			av.triggerTime = (triggerPre) ? core.counter : 0;
+			av.triggerStart = !triggerPre;
+			av.triggerState = TRIGGER_TRIGGERED;
+		}
+	}
+	else
+	{
+		av.triggerCount += (triggerStopMode != STOP_EVENTS) || eventTick;		// Cycles or events after the trigger
+		if (triggerStopHit)
+		{
+			av.triggerStop = 1;
+			av.triggerState = TRIGGER_IDLE;
+		}
+	}
+	core = out.next;
+
+	// trace.v ring buffer (the popped record is held in readdataReg of eptAV.v)
+	traceClear = (write && (bus->address == MM_TRACE_LEVEL)) || (out.ready && measureStart);
+	tracePop = (read && (bus->address == MM_TRACE_DATA)) || dmaTracePop;
+	traceDrop = traceWrite && traceRetain && !tracePop && eptTraceLevel() && (eptTraceLevel() >= av.triggerKeep);	// The oldest record gives way
+	traceStore = traceWrite && ((eptTraceLevel() < TRACE_DEPTH) || traceDrop);
+	traceReadPointer = trace.readPointer;
+	if ((tracePop || traceDrop) && eptTraceLevel()) traceReadPointer = (traceReadPointer + 1) & (2 * TRACE_DEPTH - 1);
+	if (traceStore && (trace.writePointer == traceReadPointer))
+	{
+		trace.q = traceData;													// Write-through into an empty buffer
+	}
+	else
+	{
+		trace.q = trace.data[traceReadPointer & (TRACE_DEPTH - 1)];
+	}
+	if (traceStore) trace.data[trace.writePointer & (TRACE_DEPTH - 1)] = traceData;
+	if (traceClear)
+	{
+		trace.writePointer = 0;
+		trace.readPointer = 0;
+		trace.overflow = 0;
+	}
+	else
+	{
+		if (traceWrite)
+		{
+			if (!traceStore) trace.overflow = 1;								// Record is dropped
+				else trace.writePointer = (trace.writePointer + 1) & (2 * TRACE_DEPTH - 1);
+		}
+		trace.readPointer = traceReadPointer;
+	}
+
+	// Bank swap: requested now or armed to the next IRQ, never inside a record update
+	if (write && (bus->address == MM_SWAP))
+	{
+		av.swapPending = bus->writedata & 1;
+		av.swapArmed = (bus->writedata >> 1) & 1;
+	}
+	else if (swapTick)
+	{
+		av.bank ^= 1;
+		av.swapPending = 0;
+	}
+	else if (av.swapArmed && irc && !av.irc)
+	{
+		av.swapPending = 1;
+		av.swapArmed = 0;
+	}
+	else if ((av.dmaControl & DMA_ENABLE) && !(av.dmaControl & DMA_TRACE) && (dmaStopTick || dmaPeriodTick))
+	{
+		av.swapPending = 1;													// Records are read out at the swap
+	}
+	av.irc = irc;
+
+	// RAM fill: one record per cycle from the record of the first word to the record of the last one
+	if (write && (bus->address == MM_FILL) && !av.fillBusy && (av.fillFirst <= av.fillLast))
+	{
+		av.fillBusy = 1;
+		av.fillFrozen = !out.ready;
+		av.fillAddress = av.fillFirst >> RECORD_SIZE;
+		av.fillData = bus->writedata;
+	}
+	else if (fillActive)
+	{
+		if (av.fillAddress == (av.fillLast >> RECORD_SIZE)) av.fillBusy = 0;
+		av.fillAddress = (av.fillAddress + 1) & RAM_ADDRESS_MAX;
+	}
+
+	// Histogram clear sweep: one bucket per cycle
+	if (write && (bus->address == MM_HIST_LAYOUT))
+	{
+		memset(&hist, 0, sizeof(hist));
+		av.histClear = HIST_SLOTS * HIST_BINS;
+	}
+	else if (av.histClear)
+	{
+		av.histClear--;
+	}
+	if (read && (bus->address == MM_HIST_DATA))
+	{
+		av.histAddress = (av.histAddress + 1) & HIST_INDEX_MASK;
+	}
+
+	// eptAV.v DFFs
+	av.taskSwitch = write && (bus->address == MM_TASK_SWITCH);
+	if (write)
+	{
+		if ((bus->address >= MM_OFFSET_IR) && (bus->address <= MM_OFFSET_CTX_REST))
+		{
+			av.offsetException[bus->address - MM_OFFSET_IR] = bus->writedata & ((1u << OFFSET_SIZE) - 1);
+		}
+		switch (bus->address)
+		{
+			case MM_START:			av.start = bus->writedata & 1;						break;
+			case MM_STOP:			av.stop = bus->writedata & 1;						break;
+			case MM_TASK_ID:		av.taskID = bus->writedata & TASK_ID_MASK;			break;
+			case MM_TASK_SWITCH:	av.taskID = (1u << (TASK_ID_SIZE - 1)) | (bus->writedata & RAM_ADDRESS_MAX);	break;
+			case MM_OFFSET:			av.offset = bus->writedata & ((1u << OFFSET_SIZE) - 1);	break;
+			case MM_ISR:			av.isrHandling = bus->writedata & 1;				break;
+			case MM_CTX_SAVE:		av.contextSaving = bus->writedata & 1;				break;
+			case MM_CTX_RESTORE:	av.contextRestoring = bus->writedata & 1;			break;
+			case MM_RESET:			av.reset = bus->writedata & 1;						break;
+			case MM_MODE:			av.mode = bus->writedata & 1;						break;
+			case MM_COUNTER_LO:		av.counterPreload = (av.counterPreload & ~(alt_u64)DATA_MAX) | bus->writedata;	break;
+			case MM_COUNTER_HI:		av.counterPreload = (av.counterPreload & DATA_MAX) | (((alt_u64)bus->writedata << 32) & COUNTER_MASK);	break;
+			case MM_DMA_CONTROL:	av.dmaControl = bus->writedata & DMA_CONTROL_MASK;	break;
+			case MM_DMA_ADDRESS:	av.dmaAddress = bus->writedata & ~3u;				break;
+			case MM_DMA_PERIOD:		av.dmaPeriod = bus->writedata;						break;
+			case MM_FILL_RANGE:
+				av.fillFirst = bus->writedata & WORD_ADDRESS_MAX;
+				av.fillLast = (bus->writedata >> 16) & WORD_ADDRESS_MAX;
+				break;
+			case MM_HIST_LAYOUT:	av.histLayout = bus->writedata & ((1u << 31) | (0x1fu << 8) | 1);	break;
+			case MM_HIST_SELECT_LO:	av.histSelect[0] = bus->writedata;					break;
+			case MM_HIST_SELECT_HI:	av.histSelect[1] = bus->writedata;					break;
+			case MM_HIST_ADDRESS:	av.histAddress = bus->writedata & HIST_INDEX_MASK;	break;
+			case MM_BUDGET_INDEX:	av.budgetIndex = bus->writedata & RAM_ADDRESS_MAX;	break;
+			case MM_SAMPLE_CONTROL:	av.sampleControl = bus->writedata & SAMPLE_CONTROL_MASK;	break;
+			case MM_SAMPLE_PERIOD:	av.samplePeriod = bus->writedata;					break;
+			case MM_SAMPLE_ADDRESS:	av.sampleAddress = bus->writedata & RAM_ADDRESS_MAX;	break;
+			case MM_TRIGGER_CONTROL:	av.triggerControl = bus->writedata & TRIGGER_CONTROL_MASK;	break;
+			case MM_TRIGGER_START:	av.triggerStartValue = bus->writedata;				break;
+			case MM_TRIGGER_STOP:	av.triggerStopValue = bus->writedata;				break;
+			case MM_TRIGGER_PRE:	av.triggerKeep = bus->writedata & (2 * TRACE_DEPTH - 1);	break;
+			case MM_BUDGET:			budget.cycles[av.budgetIndex] = bus->writedata;		break;
+			case MM_OVERRUNS:		budget.overruns[av.budgetIndex] = bus->writedata;	break;
+			default:																	break;
+		}
+	}
+	if (out.taskResume && !(write && ((bus->address == MM_TASK_ID) || (bus->address == MM_TASK_SWITCH))))
+	{
+		av.taskID = out.next.taskID;											// The suspended task runs again, unless a task ID write wins
+	}
+	if (out.doneTick)
+	{
+		av.executed ^= 1;														// 1 bit wide executedReg
+	}
+	// Interrupt status: the sources set their bit, a write clears the bits set in the data
+	if (write && (bus->address == MM_IRQ_STATUS)) av.irqStatus &= ~(bus->writedata & IRQ_MASK);
+	av.irqStatus |= irqTicks;
+	if (write && (bus->address == MM_IRQ_MASK)) av.irqMask = bus->writedata & IRQ_MASK;
+	av.traceWatermark = traceWatermark;
+
+	// Command reset is fed back asynchronously to both modules
+	if (av.reset)
+	{
+		eptModelReset();
+	}
+}
+
+// ept_readdata: fixed latency of one cycle, the RAM fields come from the registered RAM output
+alt_u32 eptModelReaddata(const emuBus_t *bus)
+{
+	(void)bus;
+	if (av.ramRead) return ram.q[av.ramField];
+	if (av.ramFrozenRead) return ram.qFrozen[av.ramField];
+
+	return av.readdata;
+}
+
+// ept_waitrequest: the RAM window transfers are held while the fill owns the RAM ports
+int eptModelWaitrequest(const emuBus_t *bus)
+{
+	return bus->chipselect && av.fillBusy && !(bus->address & MM_REGISTER_BASE);
+}
+
+// ept_irq: a status bit enabled in the mask
+int eptModelIrq(void)
+{
+	return (av.irqStatus & av.irqMask) != 0;
+}
+
+// Side effect free content at the bus address
+alt_u32 eptModelPeek(const emuBus_t *bus, int irc)
+{
+	eptCoreOut_t out;
+	alt_u32 record = (bus->address >> RECORD_SIZE) & RAM_ADDRESS_MAX;
+
+	eptCoreEval(&out, irc);
+	if (bus->address & MM_REGISTER_BASE) return eptRegisterRead(bus->address, &out);
+
+	return ram.data[(out.ready) ? av.bank : !av.bank][record][bus->address & (RECORD_WORDS - 1)];
+}
+
+// ept_probe_counter: the counter LO word
+alt_u32 eptModelProbeCounter(void)
+{
+	return (alt_u32)core.counter;
+}
+
+// Actual I/O offset register
+alt_u32 eptModelOffset(void)
+{
+	return av.offset;
+}
+
+// Actual exception I/O offset register: IR latency, Context Save, ISR, Context Restore
+alt_u32 eptModelExceptionOffset(int param)
+{
+	return av.offsetException[param];
+}
+
+// === Functions with Internal Access ===
+// ept.v trace encoder: one record per cycle, the lowest pending event type first
+static int eptTraceEncode(eptCore_t *next, alt_u32 ticks, int counterReset, alt_u32 *data)
+{
+	alt_u64 delta = (core.traceTimestamp - core.traceLast) & COUNTER_MASK;
+	alt_u32 type = 0;
+	int write = 0;
+
+	*data = 0;
+	if (core.tracePending)
+	{
+		while (!((core.tracePending >> type) & 1)) type++;
+		write = 1;
+		if ((delta >> TRACE_DELTA_SIZE) && !core.traceExtension)
+		{
+			*data = (TRACE_EXTENSION << 28) | (alt_u32)(delta >> TRACE_DELTA_SIZE);
+			next->traceExtension = 1;
+		}
+		else
+		{
+			*data = (type << 28) | (core.traceTask << TRACE_DELTA_SIZE) | ((alt_u32)delta & ((1u << TRACE_DELTA_SIZE) - 1));
+			next->tracePending &= ~(1u << type);
+			next->traceLast = core.traceTimestamp;
+			next->traceExtension = 0;
+		}
+	}
+	if (ticks)
+	{
+		if (!next->tracePending)
+		{
+			next->traceTimestamp = core.counter;
+			next->traceTask = (ticks & ((1u << 0) | (1u << 9))) ? (next->taskID & RAM_ADDRESS_MAX) : core.taskAddress;	// Started or running task
+		}
+		next->tracePending |= ticks;
+	}
+	if (counterReset)
+	{
+		next->tracePending = 0;
+		next->traceLast = 0;
+		next->traceExtension = 0;
+	}
+
+	return write;
+}
+
+// eptAV.v register block readdata (one-hot register select)
+static alt_u32 eptRegisterRead(alt_u32 address, const eptCoreOut_t *out)
+{
+	if ((address >= MM_OFFSET_IR) && (address <= MM_OFFSET_CTX_REST))
+	{
+		return av.offsetException[address - MM_OFFSET_IR];
+	}
+	switch (address)
+	{
+		case MM_COUNTER_LO:		return (alt_u32)core.counter;
+		case MM_COUNTER_HI:		return av.counterHigh;
+		case MM_READY:			return out->ready;
+		case MM_START:			return av.start;
+		case MM_STOP:			return av.stop;
+		case MM_TASK_ID:		return av.taskID;
+		case MM_TASK_SWITCH:	return av.taskID;
+		case MM_OFFSET:			return av.offset;
+		case MM_ISR:			return av.isrHandling;
+		case MM_CTX_SAVE:		return av.contextSaving;
+		case MM_CTX_RESTORE:	return av.contextRestoring;
+		case MM_EXECUTED:		return av.executed;
+		case MM_RESET:			return av.reset;
+		case MM_MODE:			return av.mode;
+		case MM_TRACE_LEVEL:	return ((alt_u32)trace.overflow << 31) | eptTraceLevel();
+		case MM_TRACE_DATA:		return trace.q;
+		case MM_SWAP:			return ((alt_u32)(av.swapPending | av.swapArmed) << 1) | av.bank;
+		case MM_LOST_EVENTS:	return core.lostEvents;
+		case MM_IRQ_STATUS:		return av.irqStatus;
+		case MM_IRQ_MASK:		return av.irqMask;
+		case MM_DMA_CONTROL:	return ((alt_u32)(dma.state != DMA_IDLE) << 31) | av.dmaControl;
+		case MM_DMA_ADDRESS:	return av.dmaAddress;
+		case MM_DMA_PERIOD:		return av.dmaPeriod;
+		case MM_FILL_RANGE:		return (av.fillLast << 16) | av.fillFirst;
+		case MM_FILL:			return av.fillBusy;
+		case MM_PREEMPT:		return ((alt_u32)core.preemptOverflow << 31) | core.preemptLevel;
+		case MM_HIST_LAYOUT:	return av.histLayout | ((alt_u32)(av.histClear != 0) << 30);
+		case MM_HIST_SELECT_LO:	return av.histSelect[0];
+		case MM_HIST_SELECT_HI:	return av.histSelect[1];
+		case MM_HIST_ADDRESS:	return av.histAddress;
+		case MM_HIST_DATA:		return hist.data[av.histAddress];
+		case MM_BUDGET_INDEX:	return av.budgetIndex;
+		case MM_BUDGET:			return budget.cycles[av.budgetIndex];
+		case MM_OVERRUNS:		return budget.overruns[av.budgetIndex];
+		case MM_OVERRUN_FIRST:	return ((alt_u32)av.overrunValid << 31) | av.overrunAddress;
+		case MM_OVERRUN_TIME_LO:	return (alt_u32)av.overrunTime;
+		case MM_OVERRUN_TIME_HI:	return (alt_u32)(av.overrunTime >> 32);
+		case MM_SAMPLE_CONTROL:	return av.sampleControl | ((alt_u32)(av.sampleClear != 0) << 30);
+		case MM_SAMPLE_PERIOD:	return av.samplePeriod;
+		case MM_SAMPLE_ADDRESS:	return av.sampleAddress;
+		case MM_SAMPLE_HITS:	return sample.hits[av.sampleAddress];
+		case MM_SAMPLE_IDLE:	return av.sampleIdle;
+		case MM_TRIGGER_CONTROL:	return ((alt_u32)(av.triggerState != TRIGGER_IDLE) << 31) | ((alt_u32)av.triggerFired << 30) | av.triggerControl;
+		case MM_TRIGGER_START:	return av.triggerStartValue;
+		case MM_TRIGGER_STOP:	return av.triggerStopValue;
+		case MM_TRIGGER_PRE:	return av.triggerKeep;
+		case MM_TRIGGER_TIME_LO:	return (alt_u32)av.triggerTime;
+		case MM_TRIGGER_TIME_HI:	return (alt_u32)(av.triggerTime >> 32);
+		default:				return 0;
+	}
+}
+
+// dma.v: one clock of the readout DMA, the master writes without wait states
+// Called before the RAM and trace updates: the registered RAM output and the oldest trace record are current
+static void eptDmaClock(int start, int traceSource)
+{
+	volatile alt_u32 *target = (volatile alt_u32 *)(unsigned long)((dma.state == DMA_COMPLETE) ? dma.base : dma.address);
+
+	switch (dma.state)
+	{
+		case DMA_IDLE:
+			if (start)
+			{
+				dma.base = av.dmaAddress;
+				dma.address = av.dmaAddress + 4;
+				dma.recordAddress = 0;
+				dma.field = 0;
+				dma.words = eptTraceLevel();
+				dma.count = 0;
+				dma.state = (!traceSource) ? DMA_READ : (dma.words) ? DMA_TRACE_COPY : DMA_COMPLETE;
+			}
+			break;
+		case DMA_READ:
+			dma.state = DMA_LATCH;
+			break;
+		case DMA_LATCH:
+			memcpy(dma.record, ram.qFrozen, sizeof(dma.record));
+			dma.state = DMA_RECORD;
+			break;
+		case DMA_RECORD:
+			*target = dma.record[dma.field];
+			dma.address += 4;
+			dma.count = (dma.count + 1) & 0xffff;
+			if (dma.field == RECORD_WORDS - 1)
+			{
+				dma.state = (dma.recordAddress == RAM_ADDRESS_MAX) ? DMA_COMPLETE : DMA_READ;
+				dma.recordAddress = (dma.recordAddress + 1) & RAM_ADDRESS_MAX;
+			}
+			dma.field = (dma.field + 1) & (RECORD_WORDS - 1);
+			break;
+		case DMA_TRACE_COPY:
+			*target = trace.q;														// Popped at this edge
+			dma.address += 4;
+			dma.count = (dma.count + 1) & 0xffff;
+			if (--dma.words == 0) dma.state = DMA_COMPLETE;
+			break;
+		case DMA_COMPLETE:
+			dma.sequence = (dma.sequence + 1) & 0xffff;
+			*target = (dma.sequence << 16) | dma.count;
+			dma.state = DMA_IDLE;
+			break;
+		default:
+			dma.state = DMA_IDLE;
+			break;
+	}
+}
+
+// RAM fill write of the record at the fill address: the fields within the word range (byte enables)
+static void eptFillRecord(alt_u32 *record)
+{
+	alt_u32 word = av.fillAddress << RECORD_SIZE;
+	int field;
+
+	for (field=0; field<(int)RECORD_WORDS; field++)
+	{
+		if ((word + field >= av.fillFirst) && (word + field <= av.fillLast)) record[field] = av.fillData;
+	}
+}
+
+// histogram.v: the bucket of a selected task (slot 0-3) or of an exception record (slot 4-7) is incremented (saturated)
+static void eptHistUpdate(alt_u32 address, alt_u32 elapsed)
+{
+	alt_u32 shift = (av.histLayout >> 8) & 0x1f;
+	alt_u32 scaled = elapsed >> shift;
+	alt_u32 slot = 0, bucket, select, *count;
+	int i, hit = 0;
+
+	if (address >= RAM_ADDRESS_RESERVED)
+	{
+		slot = 4 + address - RAM_ADDRESS_RESERVED;
+		hit = 1;
+	}
+	else
+	{
+		for (i=3; i>=0; i--)												// The lowest matching slot
+		{
+			select = (av.histSelect[i / 2] >> ((i % 2) * 16)) & 0xffff;
+			if ((select & 0x8000) && ((select & 0x7fff) == address))
+			{
+				slot = i;
+				hit = 1;
+			}
+		}
+	}
+	if (!hit) return;
+	if (!(av.histLayout & 1))
+	{
+		bucket = (scaled > HIST_BINS - 1) ? HIST_BINS - 1 : scaled;
+	}
+	else
+	{
+		for (bucket=0; scaled; scaled >>= 1) bucket++;					// Highest set bit + 1
+		if (bucket > HIST_BINS - 1) bucket = HIST_BINS - 1;
+	}
+	count = &hist.data[(slot << HIST_SIZE) | bucket];
+	if (*count != DATA_MAX) (*count)++;
+}
+
+// trace.v fill level
+static alt_u32 eptTraceLevel(void)
+{
+	return (trace.writePointer - trace.readPointer) & (2 * TRACE_DEPTH - 1);
+}
+
+// ept.v finite-state machine and record update pipeline logic
+static void eptCoreEval(eptCoreOut_t *out, int irc)
+{
+	const eptCore_t *reg = &core;
+	eptCore_t *next = &out->next;
+	alt_u64 offset = av.offset;
+	alt_u32 elapsedData = (core.elapsed > DATA_MAX) ? DATA_MAX : (alt_u32)core.elapsed;
+	const alt_u32 *source = ram.q;
+	alt_u64 recordSum, recordInclusive;
+	alt_u32 parentLink;
+	int taskEnableRamAddress = (reg->state == STATE_WATCH) && (reg->stopAddress < RAM_ADDRESS_RESERVED);
+	alt_u64 taskElapsed = ((reg->counter - reg->startTimestamp) + reg->taskPartTime) & COUNTER_MASK;
+	int budgetWatch = (reg->state == STATE_WATCH) && TASK_ACTIVE(reg->taskID) && !reg->taskStartCCR && !reg->taskStopCCR &&
+					  (reg->budgetAddress == reg->taskAddress) && budget.q && !reg->taskOverrun;
+
+	*next = core;
+	next->taskID = av.taskID;
+	next->irq = irc;
+	next->isr = av.isrHandling;
+	next->contextSave = av.contextSaving;
+	next->contextRestore = av.contextRestoring;
+	next->summarize = 0;
+	next->region = 0;
+	next->accumulatorWarn = 0;
+	out->counterReset = 0;
+	out->taskResume = 0;
+	out->overrunTick = budgetWatch && (taskElapsed >= (alt_u64)budget.q + offset);	// Watched until the cycle before the stop processing
+	next->taskOverrun = reg->taskOverrun || out->overrunTick;
+	next->budgetAddress = reg->taskAddress;
+	out->ready = 0;
+	out->doneTick = 0;
+
+	switch (reg->state)
+	{
+		case STATE_IDLE:
+			out->ready = 1;
+			if (av.start || av.triggerStart)
+			{
+				out->counterReset = 1;
+				next->preemptLevel = 0;
+				next->taskPreemptCCR = 0;										// The stack restarts empty
+				next->taskStartCCR = 0;											// Events captured before the start are dropped
+				next->taskStopCCR = 0;
+				next->irqStartCCR = 0;
+				next->isrStartCCR = 0;
+				next->isrStopCCR = 0;
+				next->contextSaveStartCCR = 0;
+				next->contextSaveStopCCR = 0;
+				next->contextRestoreStartCCR = 0;
+				next->contextRestoreStopCCR = 0;
+				next->state = STATE_WATCH;
+			}
+			break;
+		case STATE_WATCH:
+			if (av.stop || av.triggerStop)
+			{
+				next->state = STATE_DONE;
+			}
+			else if (reg->irqStartCCR)
+			{
+				next->irqStartCCR = 0;
+				next->startTimestamp = reg->counter;
+				next->taskPartTime = (reg->taskPartTime + (reg->counter - reg->startTimestamp)) & COUNTER_MASK;
+				next->state = STATE_EXCEPTION;
+			}
+			else
+			{
+				if (reg->taskStartCCR)
+				{
+					next->taskStartCCR = 0;
+					next->startTimestamp = reg->counter;
+					next->taskPartTime = 0;
+					next->taskChildTime = 0;
+					next->taskOverrun = 0;												// New invocation
+					// The running task is preempted: suspended with its part-time, dropped at the full stack
+					if (reg->taskPreemptCCR)
+					{
+						next->taskPreemptCCR = 0;
+						if (reg->preemptLevel != PREEMPT_DEPTH)
+						{
+							next->preemptAddress[reg->preemptLevel] = reg->suspendAddress;
+							next->preemptTime[reg->preemptLevel] = (reg->taskPartTime + (reg->counter - reg->startTimestamp)) & COUNTER_MASK;
+							next->preemptChild[reg->preemptLevel] = reg->taskChildTime;
+							next->preemptParent[reg->preemptLevel] = reg->taskParent;
+							next->preemptOverrun[reg->preemptLevel] = reg->taskOverrun;
+							next->preemptLevel = reg->preemptLevel + 1;
+						}
+						else
+						{
+							next->preemptOverflow = 1;
+						}
+						next->taskParent = PARENT_VALID | reg->suspendAddress;			// Nested in the preempted task
+					}
+					else
+					{
+						next->taskParent = (reg->preemptLevel) ? PARENT_VALID | reg->preemptAddress[reg->preemptLevel - 1] : 0;
+					}
+				}
+				if (reg->taskStopCCR)
+				{
+					next->taskStopCCR = 0;
+					next->elapsed = ((reg->counter - reg->startTimestamp) + reg->taskPartTime - offset) & COUNTER_MASK;
+					next->ramAddress = (taskEnableRamAddress) ? reg->stopAddress : RAM_ADDRESS_RESERVED - 1;
+					next->summarize = 1;
+					next->region = 1;
+					next->inclusive = (next->elapsed + reg->taskChildTime) & COUNTER_MASK;	// Own and nested cycles
+					next->parent = reg->taskParent;
+					// The last suspended task resumes, unless a task is started instead (switch)
+					if (!reg->taskStartCCR && reg->preemptLevel)
+					{
+						next->preemptLevel = reg->preemptLevel - 1;
+						out->taskResume = 1;
+						next->taskID = (1u << (TASK_ID_SIZE - 1)) | reg->preemptAddress[next->preemptLevel];
+						next->taskAddress = reg->preemptAddress[next->preemptLevel];
+						next->startTimestamp = reg->counter;
+						next->taskPartTime = reg->preemptTime[next->preemptLevel];
+						next->taskChildTime = (reg->preemptChild[next->preemptLevel] + next->inclusive) & COUNTER_MASK;
+						next->taskParent = reg->preemptParent[next->preemptLevel];
+						next->taskOverrun = reg->preemptOverrun[next->preemptLevel];
+					}
+					else if (reg->taskStartCCR && !reg->taskPreemptCCR && reg->preemptLevel)
+					{
+						// A task switched in a nested region
+						next->preemptChild[reg->preemptLevel - 1] = (reg->preemptChild[reg->preemptLevel - 1] + next->inclusive) & COUNTER_MASK;
+					}
+				}
+			}
+			break;
+		case STATE_EXCEPTION:
+			// One record update per cycle, in the order of the exception
+			if (reg->contextSaveStartCCR)
+			{
+				next->contextSaveStartCCR = 0;
+				next->elapsed = ((reg->counter - reg->startTimestamp) - av.offsetException[0]) & COUNTER_MASK;
+				next->startTimestamp = reg->counter;
+				next->ramAddress = RAM_ADDRESS_RESERVED;
+				next->summarize = 1;
+			}
+			else if (reg->contextSaveStopCCR)
+			{
+				next->contextSaveStopCCR = 0;
+				next->taskPartTime = (reg->taskPartTime + reg->elapsed) & COUNTER_MASK;
+				next->elapsed = ((reg->counter - reg->startTimestamp) - av.offsetException[1]) & COUNTER_MASK;
+				next->ramAddress = RAM_ADDRESS_RESERVED + 1;
+				next->summarize = 1;
+			}
+			else if (reg->isrStartCCR)
+			{
+				next->isrStartCCR = 0;
+				next->startTimestamp = reg->counter;
+			}
+			else if (reg->isrStopCCR)
+			{
+				next->isrStopCCR = 0;
+				next->elapsed = ((reg->counter - reg->startTimestamp) - av.offsetException[2]) & COUNTER_MASK;
+				next->ramAddress = RAM_ADDRESS_RESERVED + 2;
+				next->summarize = 1;
+			}
+			else if (reg->contextRestoreStartCCR)
+			{
+				next->contextRestoreStartCCR = 0;
+				next->startTimestamp = reg->counter;
+			}
+			else if (reg->contextRestoreStopCCR)
+			{
+				next->contextRestoreStopCCR = 0;
+				next->elapsed = ((reg->counter - reg->startTimestamp) - av.offsetException[3]) & COUNTER_MASK;
+				next->ramAddress = RAM_ADDRESS_RESERVED + 3;
+				next->startTimestamp = reg->counter;
+				next->summarize = 1;
+				next->state = STATE_WATCH;
+			}
+			break;
+		case STATE_DONE:
+			if (!(reg->summarize || reg->store))				// The last record update is stored
+			{
+				out->doneTick = 1;
+				next->state = STATE_IDLE;
+			}
+			break;
+		default:
+			next->state = STATE_IDLE;
+			break;
+	}
+
+	// Record update pipeline: the RAM read misses the record at the store stage and the one stored at the read edge
+	if (reg->store && (reg->storeAddress == reg->ramAddress)) source = reg->record;
+		else if (reg->forward && (reg->forwardAddress == reg->ramAddress)) source = reg->forwardRecord;
+	if (reg->summarize)
+	{
+		recordSum = (((alt_u64)source[RECORD_SUM + 1] << 32) | source[RECORD_SUM]) + reg->elapsed;
+		memcpy(next->record, source, sizeof(next->record));
+		next->record[RECORD_SUM] = (alt_u32)recordSum;
+		next->record[RECORD_SUM + 1] = (alt_u32)(recordSum >> 32);
+		next->record[RECORD_COUNT] = source[RECORD_COUNT] + 1;
+		if ((source[RECORD_COUNT] == 0) || (elapsedData < source[RECORD_MIN])) next->record[RECORD_MIN] = elapsedData;
+		if (elapsedData > source[RECORD_MAX]) next->record[RECORD_MAX] = elapsedData;
+		// Task stop: inclusive cycles and the parent link, a different parent than the stored one is flagged
+		recordInclusive = ((alt_u64)source[RECORD_INCLUSIVE + 1] << 32) | source[RECORD_INCLUSIVE];
+		if (reg->region)
+		{
+			recordInclusive += reg->inclusive;
+			next->record[RECORD_INCLUSIVE] = (alt_u32)recordInclusive;
+			next->record[RECORD_INCLUSIVE + 1] = (alt_u32)(recordInclusive >> 32);
+			parentLink = source[RECORD_PARENT] & (PARENT_VALID | RAM_ADDRESS_MAX);
+			next->record[RECORD_PARENT] = reg->parent | (source[RECORD_PARENT] & PARENT_MULTIPLE) |
+										  ((source[RECORD_COUNT] && (parentLink != reg->parent)) ? PARENT_MULTIPLE : 0);
+		}
+		// The MSB of the Sum, of the inclusive Sum or of the Count is set by this update
+		next->accumulatorWarn = ((recordSum >> 63) && !(source[RECORD_SUM + 1] >> 31)) ||
+								((recordInclusive >> 63) && !(source[RECORD_INCLUSIVE + 1] >> 31)) ||
+								((next->record[RECORD_COUNT] >> 31) && !(source[RECORD_COUNT] >> 31));
+	}
+	next->store = reg->summarize;
+	next->storeAddress = reg->ramAddress;
+	next->forward = reg->store;
+	next->forwardAddress = reg->storeAddress;
+	memcpy(next->forwardRecord, reg->record, sizeof(next->forwardRecord));
+
+	out->ramAddress = (reg->state == STATE_IDLE) ? 0 : next->ramAddress;
+	out->ramWriteAddress = reg->storeAddress;
+	out->ramWrite = reg->store;
+	out->ramWriteData = reg->record;
+}
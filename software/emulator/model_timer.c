@@ -0,0 +1,77 @@
+//=========================================
+// EPT Host Emulator: timerIR model
+//=========================================
+
+/*  @Brief:
+*		- Cycle based model of the timerIR block as used by driver/timerir.h
+*		- The counter runs in every mode but TMRIR_CCTR_CMD_DISABLE, match raises the IRQ register
+*/
+
+#include <string.h>
+#include "emulator.h"
+#include "timerir.h"
+
+// timerIR registers
+static timerIR_t timer;
+
+// Global reset
+void timerModelReset(void)
+{
+	memset(&timer, 0, sizeof(timer));
+}
+
+// Rising edge of the system clock
+void timerModelClock(const emuBus_t *bus)
+{
+	int write = bus->write && bus->chipselect;
+	int matchMode = (timer.ccr == TMRIR_CCTR_CMD_MTCNRES) || (timer.ccr == TMRIR_CCTR_CMD_MATCRES);
+
+	// Counter
+	if (write && (bus->address == TMRIR_DATA_REG_OF))
+	{
+		timer.data = bus->writedata;
+	}
+	else if (timer.ccr != TMRIR_CCTR_CMD_DISABLE)
+	{
+		if (matchMode && (timer.data == timer.match))
+		{
+			timer.irq = 1;
+			timer.data = (timer.ccr == TMRIR_CCTR_CMD_MATCRES) ? 0 : timer.data + 1;
+		}
+		else
+		{
+			timer.data++;
+		}
+	}
+
+	// Register writes
+	if (write)
+	{
+		switch (bus->address)
+		{
+			case TMRIR_CCTR_REG_OF:		timer.ccr = bus->writedata & TMRIR_CCTR_REG_DATA_MASK;		break;
+			case TMRIR_MATC_REG_OF:		timer.match = bus->writedata;								break;
+			case TMRIR_IRQ_REG_OF:		timer.irq = bus->writedata & TMRIR_IRQ_REG_DATA_MASK;		break;
+			default:																				break;
+		}
+	}
+}
+
+// Combinational readdata
+alt_u32 timerModelReaddata(const emuBus_t *bus)
+{
+	switch (bus->address)
+	{
+		case TMRIR_CCTR_REG_OF:		return timer.ccr;
+		case TMRIR_MATC_REG_OF:		return timer.match;
+		case TMRIR_DATA_REG_OF:		return timer.data;
+		case TMRIR_IRQ_REG_OF:		return timer.irq;
+		default:					return 0;
+	}
+}
+
+// Interrupt request output
+int timerModelIrq(void)
+{
+	return (int)timer.irq;
+}
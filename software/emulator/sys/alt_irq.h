@@ -0,0 +1,20 @@
+//========================================
+// Host stand-in for the HAL sys/alt_irq.h
+//========================================
+
+/*  @Brief:
+*		- Enhanced interrupt API: a registered ISR is called by the emulator between bus accesses
+*		  while its interrupt request is set
+*/
+
+#ifndef ALT_IRQ_H_
+#define ALT_IRQ_H_
+
+#include <stddef.h>
+#include "alt_types.h"
+
+typedef void (*alt_isr_func)(void *isr_context);
+
+int alt_ic_isr_register(alt_u32 ic_id, alt_u32 irq, alt_isr_func isr, void *isr_context, void *flags);
+
+#endif	// ALT_IRQ_H_
@@ -0,0 +1,57 @@
+//==========================================
+// Host stand-in for the generated system.h
+//==========================================
+
+/*  @Brief:
+*		- Mirrors the SOPC components used by software/ on the emulated system
+*		- The spans are mapped by the emulator at the given base addresses
+*/
+
+#ifndef SYSTEM_H_
+#define SYSTEM_H_
+
+#define ALT_CPU_FREQ				50000000
+#define SYSTEM_BUS_WIDTH			32
+
+// Execution Performance Tester
+// Parameters exported by eptAV_hw.tcl, can be overridden, e.g. EMU_FLAGS="-DEPT_ADDRESS_WIDTH=14"
+#define EPT_BASE					0x20000000UL
+#ifndef EPT_ADDRESS_WIDTH
+#define EPT_ADDRESS_WIDTH			11
+#endif
+#ifndef EPT_RECORD_SIZE
+#define EPT_RECORD_SIZE				3
+#endif
+#ifndef EPT_TRACE_SIZE
+#define EPT_TRACE_SIZE				9
+#endif
+#ifndef EPT_MEASURE_CLOCK_FREQ
+#define EPT_MEASURE_CLOCK_FREQ		ALT_CPU_FREQ				// MEASURE_CLOCK = 1: integer multiples of ALT_CPU_FREQ are modelled
+#endif
+#ifndef EPT_PREEMPT_DEPTH
+#define EPT_PREEMPT_DEPTH			4
+#endif
+#define EPT_SPAN					((SYSTEM_BUS_WIDTH / 8) << EPT_ADDRESS_WIDTH)
+#define EPT_IRQ						1
+#define EPT_IRQ_INTERRUPT_CONTROLLER_ID	0
+#define EPT_DMA						1							// Readout DMA master into host memory
+#define EPT_HISTOGRAM				1							// Latency histograms
+#define EPT_BUDGET					1							// Budget watchdog
+#define EPT_SAMPLING				1							// Sampling profiler
+#define EPT_TRIGGER					1							// Trigger unit
+#ifndef EPT_HIST_SIZE
+#define EPT_HIST_SIZE				5
+#endif
+
+// Probe custom instruction (eptCI), e.g. EMU_FLAGS="-DEMU_EPT_CI=1"
+#if EMU_EPT_CI
+#define ALT_CI_EPT_CI_N				0x0
+#define ALT_CI_EPT_CI_N_MASK		((1<<3)-1)
+#define ALT_CI_EPT_CI(n,A)			emuCustom(ALT_CI_EPT_CI_N+(n&ALT_CI_EPT_CI_N_MASK),(A))
+#endif
+
+// System timer
+#define TIMER_IR_BASE				0x20010000UL
+#define TIMER_IR_SPAN				16
+
+#endif	// SYSTEM_H_
@@ -8,10 +8,13 @@
 
 #include "main.h"
 
+static void statPrint(char *name, stat_t *stat, statHist_t *hist);		// Display a calibration statistic
+
 
 int main()
 {
 	ioOffset_t offset;
+	excOffset_t excOffset;
 	status_t status;
 
 	printf("\n === EPT SYSTEM ===\n\n");
@@ -28,11 +31,48 @@ int main()
 	//------------------
 	// I/O offset calibration
 	printf("--- Initialization ---\n");
-	offset = ioOffsetCalibration(TASK_ID_MAX);
-	printf(" >> IO Offset Calibration: %s -> N: %d, Mean: %.2lf, StDev: %.2lf\n", offset.status.description, offset.result.N, offset.result.mean, offset.result.stdev);
-	// RAM initialization
-	status = ramInit(0, EPT_RAM_ADDRESS_MAX, 0);
+	offset = ioOffsetCalibration(CAL_TASKS, CAL_REPETITIONS);
+	printf(" >> IO Offset Calibration: %s\n", offset.status.description);
+	statPrint("Task", &offset.result, &offset.histogram);
+	excOffset = exceptionOffsetCalibration(EXC_CALIBRATION_MAX);
+	printf(" >> Exception IO Offset Calibration: %s\n", excOffset.status.description);
+	statPrint("IR latency", &excOffset.result[EPT_IR_LATENCY], &excOffset.histogram[EPT_IR_LATENCY]);
+	statPrint("Context Save", &excOffset.result[EPT_IR_CTX_SAVE], &excOffset.histogram[EPT_IR_CTX_SAVE]);
+	statPrint("ISR", &excOffset.result[EPT_IR_ISR], &excOffset.histogram[EPT_IR_ISR]);
+	statPrint("Context Restore", &excOffset.result[EPT_IR_CTX_REST], &excOffset.histogram[EPT_IR_CTX_REST]);
+	// RAM initialization: both result banks
+	status = ramInit(0, EPT_RAM_WORD_MAX, 0);
+	if (!status.type)
+	{
+		status = windowSwap(0);
+	}
+	if (!status.type)
+	{
+		status = ramInit(0, EPT_RAM_WORD_MAX, 0);
+	}
 	printf(" >> EPT RAM initialization to 0: %s\n", status.description);
 
 	return 0;
 }
+
+// Display a calibration statistic with the non-empty histogram bins
+static void statPrint(char *name, stat_t *stat, statHist_t *hist)
+{
+	eptTime_t median = eptTimeGet(stat->median);
+	int i;
+
+	printf("    - %s -> N: %u (%u rejected), Median: %u (%u.%03u %s), Mean: %u.%02u, StDev: %u.%02u, Min: %u, Max: %u\n      Histogram:",
+		   name, stat->N, stat->rejected, (unsigned int)stat->median,
+		   (unsigned int)median.integer, (unsigned int)median.fraction, median.unit,
+		   (unsigned int)(stat->mean / STAT_SCALE), (unsigned int)(stat->mean % STAT_SCALE),
+		   (unsigned int)(stat->stdev / STAT_SCALE), (unsigned int)(stat->stdev % STAT_SCALE),
+		   (unsigned int)stat->min, (unsigned int)stat->max);
+	for (i=0; i<STAT_BINS; i++)
+	{
+		if (hist->bin[i])
+		{
+			printf(" %d: %u", i, (unsigned int)hist->bin[i]);
+		}
+	}
+	printf(", Overflow: %u\n", (unsigned int)hist->overflow);
+}
@@ -2,63 +2,97 @@
 // EPT Initialization Layer Function Collection
 //===============================================
 
-#include <math.h>
 #include "init.h"
 
 //-----------------------------------------
 // Function Prototypes with Internal Access
 //-----------------------------------------
-static stat_t stdevCalc(int *sample, int sampleNum);	// Standard deviation calculation
+static void statReset(statHist_t *hist);						// Clear the sample histogram
+static void statAdd(statHist_t *hist, alt_u32 sample);			// Streaming accumulation of a sample
+static stat_t statCalc(const statHist_t *hist);					// Integer statistic of the accumulated samples
+static alt_u32 statRank(const statHist_t *hist, alt_u32 rank);	// Sample value at the rank (0 - N-1) in ascending order
+static alt_u32 isqrt(alt_u64 data);								// Integer square root
 
 //-----------------------------------------
 // Initialization Function Collection
 //-----------------------------------------
 
 // Fills the address interval of the on-chip RAM with the input data
+// The EPT walks the interval in hardware (one record per cycle), RAM_INIT_VERIFY reads the words back
 status_t ramInit(int addressStart, int addressStop, unsigned int data)
 {
 	status_t status = {NO_ERROR, "SUCCESS"};
 	int i;
+
+	// Validate the input address interval
+	if ((addressStart < 0) || (addressStart > addressStop) || (addressStop > EPT_RAM_WORD_MAX))
+	{
+		status.type = INVALID_ADDRESS;
+		stringCopy(status.description, "FAIL - Invalid input address");
+		return status;
+	}
+	// Fill RAM with the data: a single write, the RAM is not accessible until the fill is done
+	DRV_EPT_FILL_RANGE_SET(addressStart, addressStop);
+	DRV_EPT_FILL(data);
+	for (i=0; (i<RAM_FILL_POLL_MAX) && DRV_EPT_FILL_BUSY_GET; i++);
+	if (DRV_EPT_FILL_BUSY_GET)
+	{
+		status.type = EPT_STATUS;
+		stringCopy(status.description, "FAIL - RAM fill is not done");
+		return status;
+	}
+#if RAM_INIT_VERIFY
+	// Validate the written data
+	status = ramVerify(addressStart, addressStop, data);
+#endif
+
+	return status;
+}
+
+// Reads back the address interval of the on-chip RAM: every word has to match the input data
+status_t ramVerify(int addressStart, int addressStop, unsigned int data)
+{
+	status_t status = {NO_ERROR, "SUCCESS"};
 	alt_u32 *ram = (alt_u32 *)DRV_EPT_RAM_PTR;			// Set RAM to starting address
+	int i;
 
 	// Validate the input address interval
-	if ((addressStart > addressStop) || (addressStop > EPT_RAM_ADDRESS_MAX))
+	if ((addressStart < 0) || (addressStart > addressStop) || (addressStop > EPT_RAM_WORD_MAX))
 	{
 		status.type = INVALID_ADDRESS;
 		stringCopy(status.description, "FAIL - Invalid input address");
 		return status;
 	}
-	// Fill RAM with the data
-	for (i=0; i<=addressStop; i++)
+	for (i=addressStart; i<=addressStop; i++)
 	{
-		if (i >= addressStart)
+		if (data != (unsigned int)ram[i])
 		{
-			*ram = (alt_u32)data;						// If i reaches or beyond the starting interval, fill the RAM with the data
-			if (data != (unsigned int)*ram)				// Validate the written data
-			{
-				status.type = RAM_ACCESS;
-				stringCopy(status.description, "FAIL - RAM data mismatch");
-				return status;
-			}
+			status.type = RAM_ACCESS;
+			stringCopy(status.description, "FAIL - RAM data mismatch");
+			return status;
 		}
-		ram++;		// Increment address
 	}
 
 	return status;
 }
 
-// I/O START-STOP offset validation for each task IDs
-ioOffset_t ioOffsetCalibration(int numberOfTasks)
+// I/O offset validation for each task IDs: the tasks are chained by task switch probes
+// A task is measured between two probes, the same as a START-STOP pair on the Task ID register
+// The probes are the driver macros: Avalon writes or the probe custom instruction, whichever is in the system
+// Each repetition is a separate measurement, a sample is the increment of the task record sum
+ioOffset_t ioOffsetCalibration(int numberOfTasks, int repetitions)
 {
-	ioOffset_t ioOffset = {{0, 0, 0}, {NO_ERROR, "SUCCESS"}};
+	ioOffset_t ioOffset;
 	status_t status = {NO_ERROR, "SUCCESS."};
-	alt_u32 *taskPtr = (alt_u32 *)DRV_EPT_TASK_PTR;
-	alt_u32 *ramPtr = (alt_u32 *)DRV_EPT_RAM_PTR;
-	alt_u32 *ramStartPtr = (alt_u32 *)DRV_EPT_RAM_PTR;
-	alt_u8 taskIdOn = 0x80;
-	alt_u8 taskIdOff = 0;
-	int taskResult[EPT_RAM_ADDRESS_MAX] = {0};
-	int i;
+	eptTask_t *recordPtr;
+	alt_u32 taskSum[CAL_TASK_MAX] = {0};
+	alt_u32 taskId;
+	int i, run;
+
+	ioOffset.status.type = NO_ERROR;
+	stringCopy(ioOffset.status.description, "SUCCESS");
+	statReset(&ioOffset.histogram);
+	ioOffset.result = statCalc(&ioOffset.histogram);
 
 // --- 1. RAM initialization ---
 	DRV_EPT_RESET;								// Module Reset
@@ -68,7 +102,7 @@ ioOffset_t ioOffsetCalibration(int numberOfTasks)
 		stringCopy(ioOffset.status.description, "FAIL - ETP module is not ready");
 		return ioOffset;
 	}
-	status = ramInit(0, EPT_RAM_ADDRESS_MAX, 0);
+	status = ramInit(0, EPT_RAM_WORD_MAX, 0);
 	if (status.type)		// Get status from RAM initialization
 	{
 		ioOffset.status.type = RAM_ACCESS;
@@ -77,57 +111,66 @@ ioOffset_t ioOffsetCalibration(int numberOfTasks)
 	}
 
 // --- 2. Run TaskID IO offset measurement ---
-	// Validate maximum number of tasks
-	if (numberOfTasks > TASK_ID_MAX)
+	// Validate maximum number of tasks and repetitions: bounded calibration time
+	if ((numberOfTasks < 1) || (numberOfTasks > CAL_TASKS) || (repetitions < 1) || (repetitions > CAL_REPETITION_MAX))
 	{
 		ioOffset.status.type = INVALID_DATA;
 		stringCopy(ioOffset.status.description, "FAIL - Number of tasks is out of the limit");
 		return ioOffset;
 	}
-	// Measure IO overhead for each task
-	DRV_EPT_START;
-	if (DRV_EPT_STATUS_GET)						// Check module status
+	for (run=0; run<repetitions; run++)
 	{
-		ioOffset.status.type = EPT_STATUS;
-		stringCopy(ioOffset.status.description, "FAIL - ETP module is not ready");
-		return ioOffset;
-	}
-	i = numberOfTasks;
+		// Measure IO overhead for each task
+		DRV_EPT_START;
+		if (DRV_EPT_STATUS_GET)						// Check module status
+		{
+			ioOffset.status.type = EPT_STATUS;
+			stringCopy(ioOffset.status.description, "FAIL - ETP module is not ready");
+			return ioOffset;
+		}
+		taskId = 0;
+		i = numberOfTasks;
 SetTask:
-	*taskPtr = taskIdOn;						// Start current task
-	*taskPtr = taskIdOff;						// Stop current task
-	taskIdOn++;
-	taskIdOff++;
-	i--;
-	if (i)
-	{
-		goto SetTask;
-	}
+		DRV_EPT_TASK_SWITCH_SET(taskId);			// Stop the previous task, start the current task
+		taskId++;
+		i--;
+		if (i)
+		{
+			goto SetTask;
+		}
+		DRV_EPT_TASK_SET(taskId - 1);				// Stop the last task
 
 // --- 3. Read all task data from RAM ---
-	DRV_EPT_STOP;							// RAM is accessible only at module ready status
-	if (!DRV_EPT_STATUS_GET)				// Check module status
-	{
-		ioOffset.status.type = EPT_STATUS;
-		stringCopy(ioOffset.status.description, "FAIL - ETP module is not ready");
-		return ioOffset;
-	}
-	ramPtr = ramStartPtr;	// Reinitialize RAM pointer
-	// Accessing the Task results
-	for (i=0; i<numberOfTasks; i++)
-	{
-		taskResult[i] = (int)*ramPtr;
-		ramPtr++;
+		DRV_EPT_STOP;							// RAM is accessible only at module ready status
+		if (!DRV_EPT_STATUS_GET)				// Check module status
+		{
+			ioOffset.status.type = EPT_STATUS;
+			stringCopy(ioOffset.status.description, "FAIL - ETP module is not ready");
+			return ioOffset;
+		}
+		// Accessing the Task results
+		recordPtr = (eptTask_t *)DRV_EPT_RAM_PTR;
+		for (i=0; i<numberOfTasks; i++)
+		{
+			statAdd(&ioOffset.histogram, recordPtr->sumLo - taskSum[i]);
+			taskSum[i] = recordPtr->sumLo;
+			recordPtr++;
+		}
 	}
 
 // --- 4. Evaluating the obtained data ---
-	// Calculating the result
-	ioOffset.result = stdevCalc(taskResult, numberOfTasks);
+	ioOffset.result = statCalc(&ioOffset.histogram);
+	if (!ioOffset.result.N)
+	{
+		ioOffset.status.type = INVALID_DATA;
+		stringCopy(ioOffset.status.description, "FAIL - No valid sample");
+		return ioOffset;
+	}
 
 // --- 5. Sending calibration result to EPT ---
-	DRV_EPT_IOOF_SET((alt_u8) ioOffset.result.mean);
+	DRV_EPT_IOOF_SET((alt_u8) STAT_ROUND(ioOffset.result.mean));
 	// Validating I/O offset data
-	if (((alt_u8) ioOffset.result.mean) != DRV_EPT_IOOF_GET)
+	if (((alt_u8) STAT_ROUND(ioOffset.result.mean)) != DRV_EPT_IOOF_GET)
 	{
 		ioOffset.status.type = INVALID_DATA;
 		stringCopy(ioOffset.status.description, "Unable to set EPT I/O offset");
@@ -136,28 +179,241 @@ SetTask:
 	return ioOffset;
 }
 
+// I/O offset validation for each exception timing parameter: empty exceptions are emulated by the probes
+// The IRQ is forced in the system timer and cleared between Context Save and ISR, outside the measured intervals
+// The task IO offset is kept, the system timer is disabled
+excOffset_t exceptionOffsetCalibration(int numberOfExceptions)
+{
+	excOffset_t excOffset;
+	alt_u32 sum[IR_TIMING_PARAM] = {0};
+	alt_u32 data;
+	int i, j;
+
+	excOffset.status.type = NO_ERROR;
+	stringCopy(excOffset.status.description, "SUCCESS");
+	for (j=0; j<IR_TIMING_PARAM; j++)
+	{
+		statReset(&excOffset.histogram[j]);
+		excOffset.result[j] = statCalc(&excOffset.histogram[j]);
+	}
+
+// --- 1. Validation and RAM initialization ---
+	if ((numberOfExceptions < 2) || (numberOfExceptions > EXC_CALIBRATION_MAX))
+	{
+		excOffset.status.type = INVALID_DATA;
+		stringCopy(excOffset.status.description, "FAIL - Number of exceptions is out of the limit");
+		return excOffset;
+	}
+	if (!DRV_EPT_STATUS_GET)					// Check module status
+	{
+		excOffset.status.type = EPT_STATUS;
+		stringCopy(excOffset.status.description, "FAIL - ETP module is not ready");
+		return excOffset;
+	}
+	if (ramInit(EPT_RAM_IR_OF, EPT_RAM_WORD_MAX, 0).type)
+	{
+		excOffset.status.type = RAM_ACCESS;
+		stringCopy(excOffset.status.description, "FAIL - RAM initialization is failed");
+		return excOffset;
+	}
+	for (j=0; j<IR_TIMING_PARAM; j++)
+	{
+		DRV_EPT_IOOF_IR_SET(j, 0);				// Uncompensated measurement
+	}
+	DRV_TMRSYS_DISABLE;
+	DRV_TMRSYS_IRQ_CLR;
+
+// --- 2. Run empty exceptions, one per measurement ---
+	for (i=0; i<numberOfExceptions; i++)
+	{
+		DRV_EPT_START;
+		DRV_TMRSYS_IRQ_SET(1);					// IRQ assert
+		DRV_EPT_CTXSAV_SET(1);
+		DRV_EPT_CTXSAV_SET(0);
+		DRV_TMRSYS_IRQ_CLR;
+		DRV_EPT_ISR_SET(1);
+		DRV_EPT_ISR_SET(0);
+		DRV_EPT_CTXRES_SET(1);
+		DRV_EPT_CTXRES_SET(0);
+		DRV_EPT_STOP;							// RAM is accessible only at module ready status
+		if (!DRV_EPT_STATUS_GET)
+		{
+			excOffset.status.type = EPT_STATUS;
+			stringCopy(excOffset.status.description, "FAIL - ETP module is not ready");
+			return excOffset;
+		}
+		// The records accumulate: a sample is the increment of the summarized cycles
+		for (j=0; j<IR_TIMING_PARAM; j++)
+		{
+			data = DRV_EPT_RECORD_GET(TASK_ID_MAX + j, EPT_RECORD_SUM_LO_OF);
+			statAdd(&excOffset.histogram[j], data - sum[j]);
+			sum[j] = data;
+		}
+	}
+
+// --- 3. Evaluating the obtained data and sending the results to EPT ---
+	for (j=0; j<IR_TIMING_PARAM; j++)
+	{
+		excOffset.result[j] = statCalc(&excOffset.histogram[j]);
+		if (!excOffset.result[j].N)
+		{
+			excOffset.status.type = INVALID_DATA;
+			stringCopy(excOffset.status.description, "FAIL - No valid sample");
+			return excOffset;
+		}
+		DRV_EPT_IOOF_IR_SET(j, (alt_u8) STAT_ROUND(excOffset.result[j].mean));
+		if (((alt_u8) STAT_ROUND(excOffset.result[j].mean)) != DRV_EPT_IOOF_IR_GET(j))
+		{
+			excOffset.status.type = INVALID_DATA;
+			stringCopy(excOffset.status.description, "Unable to set EPT exception I/O offset");
+		}
+	}
+
+	return excOffset;
+}
+
 // === Functions with Internal Access ===
-// Standard deviation calculation
-static stat_t stdevCalc(int *sample, int sampleNum)
+// Clear the sample histogram
+static void statReset(statHist_t *hist)
 {
-    stat_t result;
-    float partRes = 0;
-    int i, sum = 0;
-
-    result.N = (unsigned int)sampleNum;
-    // Calculate the Mean
-    for (i=0; i<sampleNum; i++)
-    {
-        sum += sample[i];
-    }
-    result.mean = (float)sum / (float)sampleNum;
-
-    // Calculate the standard deviation
-    for (i=0; i<sampleNum; i++)
-    {
-        partRes += ((float)sample[i]-result.mean) * ((float)sample[i]-result.mean);
-    }
-    result.stdev = sqrt( 1/(float)(result.N-1) * partRes );
-
-    return result;
+	int i;
+
+	for (i=0; i<STAT_BINS; i++)
+	{
+		hist->bin[i] = 0;
+	}
+	hist->N = 0;
+	hist->overflow = 0;
+}
+
+// Streaming accumulation of a sample: one cycle wide bins, an offset beyond the 8 bit register is an outlier
+static void statAdd(statHist_t *hist, alt_u32 sample)
+{
+	if (sample < STAT_BINS)
+	{
+		hist->bin[sample]++;
+		hist->N++;
+	}
+	else
+	{
+		hist->overflow++;
+	}
+}
+
+// Integer statistic of the accumulated samples without floating point
+//	- Outliers (e.g. stray interrupts) are rejected by the Tukey fences: Q1 - STAT_FENCE * IQR, Q3 + STAT_FENCE * IQR
+//	- Mean: the lowest and highest STAT_TRIM percent of the accepted samples are trimmed
+static stat_t statCalc(const statHist_t *hist)
+{
+	stat_t result = {0, 0, 0, 0, 0, 0, 0};
+	alt_u32 q1, q3, iqr, fenceLow, fenceHigh, trim, rank, first = 0, last = 0, count, low, high, i;
+	alt_u64 sum = 0, sumSquare = 0, n = 0, trimSum = 0;
+
+	result.rejected = hist->overflow;
+	if (!hist->N)
+	{
+		return result;
+	}
+	// Fences from the quartiles, a zero IQR is widened to one cycle (jitter of the probe)
+	q1 = statRank(hist, (hist->N - 1) / 4);
+	q3 = statRank(hist, (3 * (hist->N - 1)) / 4);
+	iqr = (q3 > q1) ? q3 - q1 : 1;
+	fenceLow = (q1 > STAT_FENCE * iqr) ? q1 - STAT_FENCE * iqr : 0;
+	fenceHigh = q3 + STAT_FENCE * iqr;
+	// Accepted samples
+	for (i=0; i<STAT_BINS; i++)
+	{
+		if (!hist->bin[i])
+		{
+			continue;
+		}
+		if ((i < fenceLow) || (i > fenceHigh))
+		{
+			result.rejected += hist->bin[i];
+			continue;
+		}
+		if (!n) first = i;
+		last = i;
+		n += hist->bin[i];
+		sum += (alt_u64)hist->bin[i] * i;
+		sumSquare += (alt_u64)hist->bin[i] * i * i;
+	}
+	result.N = (unsigned int)n;
+	result.min = first;
+	result.max = last;
+	// Median and trimmed mean: ranks within the accepted samples
+	if (!n)
+	{
+		return result;
+	}
+	rank = 0;
+	for (i=0; i<first; i++)
+	{
+		rank += hist->bin[i];						// Rejected low samples precede the accepted ones
+	}
+	result.median = statRank(hist, rank + (result.N - 1) / 2);
+	trim = (result.N * STAT_TRIM) / 100;
+	count = 0;
+	for (i=first; i<=last; i++)
+	{
+		// Overlap of the bin with the untrimmed ranks [trim, N - trim)
+		low = (count > trim) ? count : trim;
+		high = (count + hist->bin[i] < result.N - trim) ? count + hist->bin[i] : result.N - trim;
+		if (high > low)
+		{
+			trimSum += (alt_u64)(high - low) * i;
+		}
+		count += hist->bin[i];
+	}
+	result.mean = (alt_u32)((trimSum * STAT_SCALE + (result.N - 2 * trim) / 2) / (result.N - 2 * trim));
+	// Standard deviation of the accepted samples: exact integer moments
+	if (n > 1)
+	{
+		result.stdev = isqrt(((n * sumSquare - sum * sum) * STAT_SCALE * STAT_SCALE) / (n * (n - 1)));
+	}
+
+	return result;
+}
+
+// Sample value at the rank (0 - N-1) in ascending order
+static alt_u32 statRank(const statHist_t *hist, alt_u32 rank)
+{
+	alt_u32 i, count = 0;
+
+	for (i=0; i<STAT_BINS; i++)
+	{
+		count += hist->bin[i];
+		if (count > rank)
+		{
+			return i;
+		}
+	}
+
+	return STAT_BINS - 1;
+}
+
+// Integer square root: bitwise method, no division
+static alt_u32 isqrt(alt_u64 data)
+{
+	alt_u64 root = 0, bit = 1ULL << 62;
+
+	while (bit > data)
+	{
+		bit >>= 2;
+	}
+	while (bit)
+	{
+		if (data >= root + bit)
+		{
+			data -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (alt_u32)root;
 }
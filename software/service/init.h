@@ -15,31 +15,66 @@
 //---------------------
 // Constant Definitions
 //---------------------
+#define EXC_CALIBRATION_MAX		32			// Maximum number of exceptions for the offset calibration
+#define RAM_INIT_VERIFY			0			// Self-test option: ramInit() reads back every filled word (ramVerify)
+#define RAM_FILL_POLL_MAX		(EPT_RAM_ADDRESS_MAX + 1)	// Busy reads until a hardware fill is done (one record per cycle)
+#define CAL_REPETITION_MAX		16			// Maximum number of repetitions of the task offset calibration
+#define CAL_REPETITIONS			4			// Default repetitions of the task offset calibration
+#define CAL_TASK_MAX			124			// Maximum number of tasks of the offset calibration: bounded stack and boot time
+#define CAL_TASKS				((TASK_ID_MAX < CAL_TASK_MAX) ? TASK_ID_MAX : CAL_TASK_MAX)	// Default tasks of the offset calibration
+#define STAT_BINS				256			// One cycle wide histogram bins: range of the 8 bit offset registers
+#define STAT_SCALE				100			// Mean and standard deviation resolution: 1/STAT_SCALE cycle
+#define STAT_FENCE				3			// Outlier fences in interquartile ranges
+#define STAT_TRIM				10			// Trimmed percent at both ends for the mean
+#define STAT_ROUND(data)		(((data) + STAT_SCALE / 2) / STAT_SCALE)	// Scaled statistic to rounded cycles
 
 //---------------------
 // Type Definitions
 //---------------------
 
-// Statistic for standard deviation
+// Integer statistic of the calibration samples (cycles)
 typedef struct stat
 {
-    unsigned int N;
-    float mean;
-    float stdev;
+	unsigned int N;							// Accepted samples
+	unsigned int rejected;					// Outliers
+	alt_u32 min;
+	alt_u32 max;
+	alt_u32 median;
+	alt_u32 mean;							// Trimmed mean in 1/STAT_SCALE cycles
+	alt_u32 stdev;							// Standard deviation of the accepted samples in 1/STAT_SCALE cycles
 } stat_t;
 
+// Sample histogram
+typedef struct statHist
+{
+	alt_u16 bin[STAT_BINS];					// Number of samples of each cycle value
+	alt_u32 N;								// Samples in the bins
+	alt_u32 overflow;						// Samples beyond the last bin
+} statHist_t;
+
 // IO Offset Type
 typedef struct ioOffset
 {
 	stat_t result;
+	statHist_t histogram;
 	status_t status;
 } ioOffset_t;
 
+// Exception IO Offset Type
+typedef struct excOffset
+{
+	stat_t result[IR_TIMING_PARAM];			// IR latency, Context Save, ISR, Context Restore
+	statHist_t histogram[IR_TIMING_PARAM];
+	status_t status;
+} excOffset_t;
+
 //---------------------
 // Function Prototypes
 //---------------------
-status_t ramInit(int addressStart, int addressStop, unsigned int data);		// Fills the address interval of the on-chip RAM with the input data
-ioOffset_t ioOffsetCalibration(int numberOfTasks);							// I/O START-STOP offset validation for each task IDs
+status_t ramInit(int addressStart, int addressStop, unsigned int data);		// Fills the address interval of the on-chip RAM with the input data (hardware fill)
+status_t ramVerify(int addressStart, int addressStop, unsigned int data);	// Reads back the address interval of the on-chip RAM
+ioOffset_t ioOffsetCalibration(int numberOfTasks, int repetitions);			// I/O START-STOP offset validation for each task IDs
+excOffset_t exceptionOffsetCalibration(int numberOfExceptions);				// I/O offset validation for each exception timing parameter
 
 
 #endif			// _INIT_H_
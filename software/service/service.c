@@ -3,3 +3,157 @@
 //==============================
 
 #include "service.h"
+
+static int regionNodeFind(const regionNode_t *node, int nodes, int taskID);
+
+// Reads the statistic record of a task ID from the on-chip RAM
+// While measuring, the record of the frozen bank is read (the window closed by the last windowSwap())
+taskStat_t taskStatGet(int taskID)
+{
+	taskStat_t taskStat = {0, 0, 0, 0, 0, 0, -1, 0, {NO_ERROR, "SUCCESS"}};
+	eptTask_t *recordPtr = (eptTask_t *)DRV_EPT_RAM_PTR;
+
+	// Validate the task ID, the IR timing records are accessible as well
+	if ((taskID < 0) || (taskID > EPT_RAM_ADDRESS_MAX))
+	{
+		taskStat.status.type = INVALID_ADDRESS;
+		stringCopy(taskStat.status.description, "FAIL - Invalid task ID");
+		return taskStat;
+	}
+
+	recordPtr += taskID;
+	taskStat.sum = eptTaskSumGet(taskID);
+	taskStat.count = recordPtr->count;
+	taskStat.min = recordPtr->min;
+	taskStat.max = recordPtr->max;
+	if (taskStat.count)
+	{
+		taskStat.mean = (alt_u32)(taskStat.sum / taskStat.count);
+	}
+	taskStat.inclusive = eptTaskInclusiveGet(taskID);
+	if (recordPtr->parent & EPT_PARENT_VALID)
+	{
+		taskStat.parent = recordPtr->parent & EPT_PARENT_ID_MASK;
+	}
+	taskStat.multipleParents = (recordPtr->parent & EPT_PARENT_MULTIPLE) != 0;
+
+	return taskStat;
+}
+
+// Closes the profiling window by swapping the result banks, the measurement keeps running
+// The frozen bank has to be cleared (ramInit) after reading: it becomes the active bank at the next swap
+// onIrq: the swap is armed to the next IRQ assertion, DRV_EPT_SWAP_GET shows when it is done
+status_t windowSwap(int onIrq)
+{
+	status_t status = {NO_ERROR, "SUCCESS"};
+	int i;
+
+	if (onIrq)
+	{
+		DRV_EPT_SWAP_SET(EPT_SWAP_IRQ);
+		return status;
+	}
+	DRV_EPT_SWAP_SET(EPT_SWAP_NOW);
+	// The swap is delayed only by a record update in progress
+	for (i=0; i<WINDOW_SWAP_POLL_MAX; i++)
+	{
+		if (!(DRV_EPT_SWAP_GET & EPT_SWAP_PENDING))
+		{
+			return status;
+		}
+	}
+	status.type = EPT_STATUS;
+	stringCopy(status.description, "FAIL - Bank swap is pending");
+
+	return status;
+}
+
+// Rebuilds the region call tree from the parent links of the invoked task records, returns the number of nodes
+// A region is linked to the parent of its last invocation, a parent without a record or a loop makes it a root
+int regionTreeGet(regionNode_t *node, int nodeMax)
+{
+	int nodes = 0;
+	int i, j, parent, ancestor, tail, root = -1;
+
+	for (i=0; (i<TASK_ID_MAX) && (nodes<nodeMax); i++)
+	{
+		if (DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF))
+		{
+			node[nodes].taskID = i;
+			node[nodes].parent = -1;
+			node[nodes].child = -1;
+			node[nodes].sibling = -1;
+			node[nodes].depth = 0;
+			node[nodes].stat = taskStatGet(i);
+			nodes++;
+		}
+	}
+	// Parent links: the ancestors of the parent must not contain the node
+	for (i=0; i<nodes; i++)
+	{
+		parent = regionNodeFind(node, nodes, node[i].stat.parent);
+		ancestor = parent;
+		for (j=0; (ancestor >= 0) && (ancestor != i) && (j < nodes); j++)
+		{
+			ancestor = node[ancestor].parent;
+		}
+		if (ancestor < 0) node[i].parent = parent;
+	}
+	// Child and sibling chains in task ID order, the roots are chained from the first one
+	for (i=0; i<nodes; i++)
+	{
+		tail = (node[i].parent < 0) ? root : node[node[i].parent].child;
+		if (tail < 0)
+		{
+			if (node[i].parent < 0) root = i;
+				else node[node[i].parent].child = i;
+			continue;
+		}
+		while (node[tail].sibling >= 0) tail = node[tail].sibling;
+		node[tail].sibling = i;
+	}
+	// Parents are visited first
+	for (i=regionTreeNext(node, nodes, -1); i>=0; i=regionTreeNext(node, nodes, i))
+	{
+		if (node[i].parent >= 0) node[i].depth = node[node[i].parent].depth + 1;
+	}
+
+	return nodes;
+}
+
+// Depth-first walk of the region call tree: the node after the index, the first root at index -1, -1 at the end
+int regionTreeNext(const regionNode_t *node, int nodes, int index)
+{
+	int i;
+
+	if (index < 0)
+	{
+		for (i=0; i<nodes; i++)
+		{
+			if (node[i].parent < 0) return i;
+		}
+		return -1;
+	}
+	if (node[index].child >= 0) return node[index].child;
+	while (index >= 0)
+	{
+		if (node[index].sibling >= 0) return node[index].sibling;
+		index = node[index].parent;
+	}
+
+	return -1;
+}
+
+// === Functions with Internal Access ===
+// Node of a task ID among the collected nodes, -1 without a record
+static int regionNodeFind(const regionNode_t *node, int nodes, int taskID)
+{
+	int i;
+
+	for (i=0; i<nodes; i++)
+	{
+		if (node[i].taskID == taskID) return i;
+	}
+
+	return -1;
+}
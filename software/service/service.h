@@ -7,5 +7,46 @@
 
 #include "init.h"
 
-#endif		// _SERVICE_H_
+//---------------------
+// Constant Definitions
+//---------------------
+#define WINDOW_SWAP_POLL_MAX		16			// Status reads until an immediate bank swap is done
+
+//---------------------
+// Type Definitions
+//---------------------
+
+// Task statistics
+typedef struct taskStat
+{
+	alt_u64 sum;				// Summarized cycles
+	alt_u32 count;				// Number of invocations
+	alt_u32 min;				// Shortest invocation
+	alt_u32 max;				// Longest invocation
+	alt_u32 mean;				// Average cycles of an invocation
+	alt_u64 inclusive;			// Summarized cycles with the nested regions
+	int parent;					// Task ID the last invocation was nested in, -1: none
+	int multipleParents;		// The task was nested in different parents
+	status_t status;
+} taskStat_t;
 
+// Node of the region call tree, the links are node indexes (-1: none)
+typedef struct regionNode
+{
+	int taskID;
+	int parent;
+	int child;					// First nested region
+	int sibling;				// Next region with the same parent, the roots are chained as well
+	int depth;					// Nesting level, 0: root
+	taskStat_t stat;
+} regionNode_t;
+
+//---------------------
+// Function Prototypes
+//---------------------
+taskStat_t taskStatGet(int taskID);				// Reads the statistic record of a task ID from the on-chip RAM
+status_t windowSwap(int onIrq);					// Closes the profiling window by swapping the result banks
+int regionTreeGet(regionNode_t *node, int nodeMax);	// Rebuilds the region call tree from the parent links of the records
+int regionTreeNext(const regionNode_t *node, int nodes, int index);	// Depth-first walk of the region call tree
+
+#endif		// _SERVICE_H_
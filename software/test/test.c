@@ -18,8 +18,99 @@ void systemTest(void)
 	if (!(result = testEptRam(0xffffff00, 0))) printf("...PASS\n");
 		else printf("...%d item(s) FAIL.\n", (-1*result));
 
+	// --- Onchip RAM Hardware Fill Test ---
+	printf("---\n");
+	if (!testEptRamFill()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+
 	// --- EPT Cycle Counter Test ---
 	printf("---\n");
 	if (!testEptCounter(EPT_CTR_OVF)) printf("...PASS\n");
 			else printf("...FAIL.\n");
+
+	// --- EPT Task Statistic Test ---
+	printf("---\n");
+	if (!testEptTaskStat()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+
+	// --- EPT Trace Test ---
+	printf("---\n");
+	if (!testEptTrace()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+
+	// --- EPT Window Swap Test ---
+	printf("---\n");
+	if (!testEptWindowSwap()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+
+	// --- EPT Task Switch Test ---
+	printf("---\n");
+	if (!testEptTaskSwitch()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+
+	// --- EPT Lost Events Test ---
+	printf("---\n");
+	if (!testEptLostEvents()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+
+	// --- EPT Probe Test ---
+	printf("---\n");
+	if (!testEptProbe()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+
+#if EPT_PREEMPT_DEPTH
+	// --- EPT Preemption Test ---
+	printf("---\n");
+	if (!testEptPreempt()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
+
+#if EPT_PREEMPT_DEPTH >= 2
+	// --- EPT Region Test ---
+	printf("---\n");
+	if (!testEptRegion()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
+
+#ifdef EPT_HISTOGRAM
+	// --- EPT Histogram Test ---
+	printf("---\n");
+	if (!testEptHistogram()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
+
+#ifdef EPT_BUDGET
+	// --- EPT Budget Watchdog Test ---
+	printf("---\n");
+	if (!testEptBudget()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
+
+#ifdef EPT_SAMPLING
+	// --- EPT Sampling Profiler Test ---
+	printf("---\n");
+	if (!testEptSampling()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
+
+#ifdef EPT_TRIGGER
+	// --- EPT Trigger Test ---
+	printf("---\n");
+	if (!testEptTrigger()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
+
+#ifdef EPT_IRQ
+	// --- EPT Interrupt Test ---
+	printf("---\n");
+	if (!testEptIrq()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
+
+#ifdef EPT_DMA
+	// --- EPT Readout DMA Test ---
+	printf("---\n");
+	if (!testEptDma()) printf("...PASS\n");
+			else printf("...FAIL.\n");
+#endif
 }
@@ -4,8 +4,22 @@
 #include <stdio.h>
 #include "../driver/driver.h"
 #include "../common/common.h"
+#include "../service/service.h"
 
-#define EPT_CTR_OVF			0		// EPT Counter overflow parameter
+#define EPT_CTR_OVF			3		// EPT Counter wrap boundaries checked with the preload
+#define EPT_CTR_GAP			0x100	// Preload distance below a wrap boundary in cycles
+#define EPT_CTR_SPIN_MAX	0x1000	// Polls until a wrap boundary is passed
+#define EPT_IRQ_WAIT_MAX	16		// Polls until a pending interrupt is handled
+#define EPT_DMA_WAIT_MAX	0x1000	// Polls until a readout DMA copy is complete
+#define EPT_DMA_PERIOD		0x400	// Readout period of the trace test in cycles
+#define EPT_PROBE_REPEAT	4		// Invocations of each task in the probe test
+#define EPT_REGION_NODES	4		// Regions of the call tree in the region test
+#define EPT_SAMPLE_PERIOD	16		// Sampling interval of the sampling test in bus clock cycles
+#define EPT_SAMPLE_LOOP		400		// Status polls of the task and of the idle part in the sampling test
+#define EPT_TRIGGER_DELAY	0x40	// Start of the trigger test after the arm in bus clock cycles
+#define EPT_TRIGGER_WINDOW	0x100	// Measured cycles of the trigger test
+#define EPT_TRIGGER_KEEP	4		// Trace records kept before the trigger
+#define EPT_TRIGGER_WAIT_MAX	0x1000	// Polls until a triggered measurement is stopped
 
 void systemTest(void);
 
@@ -14,6 +28,37 @@ int testSystemTimer(void);
 
 // EPT Tests
 int testEptRam(unsigned int pattern, int displayData);
+int testEptRamFill(void);
 int testEptCounter(unsigned int overflow);
+int testEptTaskStat(void);
+int testEptTrace(void);
+int testEptWindowSwap(void);
+int testEptTaskSwitch(void);
+int testEptLostEvents(void);
+int testEptProbe(void);
+#if EPT_PREEMPT_DEPTH
+int testEptPreempt(void);
+#endif
+#if EPT_PREEMPT_DEPTH >= 2
+int testEptRegion(void);
+#endif
+#ifdef EPT_HISTOGRAM
+int testEptHistogram(void);
+#endif
+#ifdef EPT_BUDGET
+int testEptBudget(void);
+#endif
+#ifdef EPT_SAMPLING
+int testEptSampling(void);
+#endif
+#ifdef EPT_TRIGGER
+int testEptTrigger(void);
+#endif
+#ifdef EPT_IRQ
+int testEptIrq(void);
+#endif
+#ifdef EPT_DMA
+int testEptDma(void);
+#endif
 
 #endif	// TEST_H_
@@ -4,6 +4,19 @@
 
 #include "test.h"
 
+// Resets the EPT and clears the records of the first tasks: 0 on success
+static int testEptRecordsReset(int tasks)
+{
+	DRV_EPT_RESET;
+	if (ramInit(0, tasks*EPT_RECORD_WORDS-1, 0).type)
+	{
+		printf("FAIL: Task record initialization.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 // Memory test
 int testEptRam(unsigned int pattern, int displayData)
 {
@@ -14,8 +27,8 @@ int testEptRam(unsigned int pattern, int displayData)
 	alt_u32 *ramPtr = (alt_u32 *)DRV_EPT_RAM_PTR;		// Pointer to On-chip RAM absolute address
 
 
-	printf("On-Chip RAM test (0 - %x) using '0x%x' pattern.\n", (unsigned int)EPT_RAM_ADDRESS_MAX, pattern);
-	for (i=0; i<=EPT_RAM_ADDRESS_MAX; i++)
+	printf("On-Chip RAM test (0 - %x) using '0x%x' pattern.\n", (unsigned int)EPT_RAM_WORD_MAX, pattern);
+	for (i=0; i<=EPT_RAM_WORD_MAX; i++)
 	{
 		*ramPtr = setPattern;					// Set RAM pattern
 		data = *ramPtr;							// Get RAM Pattern
@@ -40,15 +53,15 @@ int testEptRam(unsigned int pattern, int displayData)
 		   "  - Context Save: 0x%x\n"
 		   "  - ISR handle: 0x%x\n"
 		   "  - Context Restore: 0x%x\n",
-		   (unsigned int)irTiming->irLatency,
-		   (unsigned int)irTiming->ctxSave,
-		   (unsigned int)irTiming->isrHandle,
-		   (unsigned int)irTiming->ctxRestore);
+		   (unsigned int)irTiming->irLatency.sumLo,
+		   (unsigned int)irTiming->ctxSave.sumLo,
+		   (unsigned int)irTiming->isrHandle.sumLo,
+		   (unsigned int)irTiming->ctxRestore.sumLo);
 
 	if (displayData)
 	{
 		printf("\n3. --- Reading memory contents ---\n");
-		for (i=0; i<=EPT_RAM_ADDRESS_MAX; i++)
+		for (i=0; i<=EPT_RAM_WORD_MAX; i++)
 		{
 			data = DRV_EPT_RAM_GET(i);
 			if(!(i % 8))
@@ -62,6 +75,62 @@ int testEptRam(unsigned int pattern, int displayData)
 	return (-1*fail);
 }
 
+// Hardware RAM fill: the word range is written with a single command, the neighbouring words are kept
+int testEptRamFill(void)
+{
+	alt_u32 *ramPtr = (alt_u32 *)DRV_EPT_RAM_PTR;
+	int first = EPT_RECORD_WORDS - 1, last = 2*EPT_RECORD_WORDS + 1;		// Partial records at both ends
+	int i;
+
+	printf("EPT RAM Fill Test:\n");
+
+	DRV_EPT_RESET;
+	if (ramInit(0, EPT_RAM_WORD_MAX, 0xa5a5a5a5).type || ramInit(first, last, 0x5a5a5a5a).type)
+	{
+		printf("1. FAIL: RAM fill is not done\n");
+		return -1;
+	}
+	for (i=0; i<=EPT_RAM_WORD_MAX; i++)
+	{
+		if (ramPtr[i] != (((i >= first) && (i <= last)) ? 0x5a5a5a5a : 0xa5a5a5a5))
+		{
+			printf("1. FAIL: Word 0x%x: 0x%x\n", i, (unsigned int)ramPtr[i]);
+			return -1;
+		}
+	}
+	printf("1. PASS: Words 0x%x - 0x%x are filled, the rest is kept\n", first, last);
+
+	// While measuring the fill writes the frozen bank of the RAM window
+	DRV_EPT_START;
+	if (ramInit(0, EPT_RECORD_WORDS-1, 0x12345678).type || (ramPtr[EPT_RECORD_COUNT_OF] != 0x12345678))
+	{
+		printf("2. FAIL: Frozen bank fill, N: 0x%x\n", (unsigned int)ramPtr[EPT_RECORD_COUNT_OF]);
+		DRV_EPT_STOP;
+		return -1;
+	}
+	DRV_EPT_STOP;
+	printf("2. PASS: Frozen bank fill while measuring\n");
+
+	// A RAM access right after the fill start is held until the fill is done (waitrequest)
+	DRV_EPT_FILL_RANGE_SET(0, EPT_RAM_WORD_MAX);
+	DRV_EPT_FILL(0xa5a5a5a5);
+	ramPtr[EPT_RAM_WORD_MAX] = 0x5a5a5a5a;									// The last filled word
+	if (DRV_EPT_FILL_BUSY_GET || ramVerify(0, EPT_RAM_WORD_MAX-1, 0xa5a5a5a5).type || (ramPtr[EPT_RAM_WORD_MAX] != 0x5a5a5a5a))
+	{
+		printf("3. FAIL: RAM write during the fill, last word: 0x%x\n", (unsigned int)ramPtr[EPT_RAM_WORD_MAX]);
+		return -1;
+	}
+	printf("3. PASS: RAM access is held until the fill is done\n");
+
+	if (ramInit(0, EPT_RAM_WORD_MAX, 0).type || ramVerify(0, EPT_RAM_WORD_MAX, 0).type)
+	{
+		printf("FAIL: RAM initialization\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 // Counter LO-HI test
 int testEptCounter(unsigned int overflow)
 {
@@ -113,36 +182,1106 @@ int testEptCounter(unsigned int overflow)
 		return -1;
 	}
 
-	// --- 3. Counter owerflow test
-	//		  @Tests the counter HIGH, concatenation and millisecond conversion --> LONG TEST!
+	// --- 3. Snapshot: consecutive now() values are increasing, the HI word holds until the next LO read
+	//		  @The interval of two snapshots is the cost of a timestamp
+	alt_u64 now[2];
+
+	now[0] = eptNow();
+	now[1] = eptNow();
+	if ((now[1] > now[0]) && (DRV_EPT_CTR_HI_GET == (alt_u32)(now[1] >> 32)))
+	{
+		printf("%d. PASS: Counter snapshot, now() interval: %u cycles\n", step++, (unsigned int)(now[1] - now[0]));
+	}
+	else
+	{
+		printf("%d. FAIL: Counter snapshot: 0x%llx -> 0x%llx\n", step++, (unsigned long long)now[0], (unsigned long long)now[1]);
+		return -1;
+	}
+
+	// --- 4. Counter overflow test: the counter starts EPT_CTR_GAP cycles below a wrap boundary
+	//		  @Tests the LO word carry, the HI word, concatenation, the 40 bit wrap-around and the time conversion
+	const alt_u64 boundary[] = {1ULL << 32, 0x80ULL << 32, EPT_COUNTER_MASK + 1};
 	alt_u64 elapsedCycle;
+	eptTime_t elapsedTime;
+	int i, spin;
 
+	if (overflow > sizeof(boundary) / sizeof(boundary[0])) overflow = sizeof(boundary) / sizeof(boundary[0]);
 	if (overflow)
 	{
-		printf("%d. Counter overflow test, estimated duration: %u sec\n", step, (unsigned int)(overflow*(WORD_MASK/SYSTEM_CLOCK)));
-		// Checking counter overflow
-		step = 1;
-		while (overflow)
+		printf("%d. Counter overflow test with preload:\n", step++);
+		for (i=0; i<(int)overflow; i++, subStep++)
 		{
-			// Detect overflow
-			if (0x400 > counterPtr->Low)
+			DRV_EPT_RESET;										// Ready even inside an exception (STOP is ignored inside one)
+			DRV_EPT_PRELOAD(boundary[i] - EPT_CTR_GAP);
+			DRV_EPT_START;
+			// Wait for the boundary: the snapshot is still below it until the carry
+			spin = 0;
+			do
 			{
-				elapsedCycle = eptCounterConcat(counterPtr);
-				printf("  - %c. overflow: 0x%llx\n", subStep, (unsigned long long)elapsedCycle);
-				overflow--;
-				subStep++;
+				now[0] = eptNow();
+			} while ((((now[0] - (boundary[i] - EPT_CTR_GAP)) & EPT_COUNTER_MASK) < EPT_CTR_GAP) && (++spin < EPT_CTR_SPIN_MAX));
+			elapsedCycle = eptCounterConcat(counterPtr);
+			if ((((now[0] - boundary[i]) & EPT_COUNTER_MASK) < EPT_CTR_GAP) && (elapsedCycle >= now[0]) && (elapsedCycle - now[0] < EPT_CTR_GAP))
+			{
+				elapsedTime = eptTimeGet(elapsedCycle);
+				printf("  - %c. PASS: 0x%010llx -> 0x%010llx (%u.%03u %s)\n", subStep, (unsigned long long)(boundary[i] - EPT_CTR_GAP),
+					   (unsigned long long)elapsedCycle, (unsigned int)elapsedTime.integer, (unsigned int)elapsedTime.fraction, elapsedTime.unit);
+			}
+			else
+			{
+				printf("  - %c. FAIL: 0x%010llx -> 0x%010llx\n", subStep, (unsigned long long)(boundary[i] - EPT_CTR_GAP), (unsigned long long)elapsedCycle);
+				DRV_EPT_RESET;									// Clears the preload
+				return -1;
 			}
 		}
-		printf("  - Elapsed time: %.3lf msec\n", elapsedTimeMillisec(elapsedCycle));
-
 	}
 
 	DRV_EPT_STOP;											// Stop EPT
+	DRV_EPT_PRELOAD(0);										// Measurements start from 0
+
+	return 0;
+}
+
+// Task record test: count, minimum, maximum and 64 bit sum of invocations with different durations
+int testEptTaskStat(void)
+{
+	int i, j;
+	alt_u32 *taskPtr = (alt_u32 *)DRV_EPT_TASK_PTR;
+	alt_u32 sumSeed = 0xfffffff0;
+	taskStat_t taskStat;
+
+	printf("EPT Task Statistic Test:\n");
+
+	if (testEptRecordsReset(1)) return -1;					// Clear the record of Task 0
+	DRV_EPT_RAM_SET(EPT_RECORD_SUM_LO_OF, sumSeed);			// Sum LO close to wrap: the invocations carry into Sum HI
+
+	// Task 0 is invoked 3 times, each invocation is stretched by an extra bus read
+	DRV_EPT_START;
+	for (i=0; i<3; i++)
+	{
+		*taskPtr = EPT_TASK_ACTIVE;						// Start Task 0
+		for (j=0; j<i; j++)
+		{
+			(void)DRV_EPT_TASK_GET;
+		}
+		*taskPtr = 0;										// Stop Task 0
+	}
+	DRV_EPT_STOP;
+
+	taskStat = taskStatGet(0);
+	if (taskStat.status.type)
+	{
+		printf("FAIL: %s\n", taskStat.status.description);
+		return -1;
+	}
+	taskStat.sum -= sumSeed;
+	if ((taskStat.count == 3) && (taskStat.min < taskStat.max) &&
+		(taskStat.sum > taskStat.min + taskStat.max) && (taskStat.sum < 3 * taskStat.max))
+	{
+		printf("1. PASS: N: %u, Min: %u, Max: %u, Sum: %u\n", (unsigned int)taskStat.count,
+			   (unsigned int)taskStat.min, (unsigned int)taskStat.max, (unsigned int)taskStat.sum);
+	}
+	else
+	{
+		printf("1. FAIL: N: %u, Min: %u, Max: %u, Sum: %u\n", (unsigned int)taskStat.count,
+			   (unsigned int)taskStat.min, (unsigned int)taskStat.max, (unsigned int)taskStat.sum);
+		return -1;
+	}
+	// Carry of the 64 bit accumulation
+	if (DRV_EPT_RECORD_GET(0, EPT_RECORD_SUM_HI_OF) == 1)
+	{
+		printf("2. PASS: Sum carry: 0x%llx\n", (unsigned long long)eptTaskSumGet(0));
+	}
+	else
+	{
+		printf("2. FAIL: Sum carry: 0x%llx\n", (unsigned long long)eptTaskSumGet(0));
+		return -1;
+	}
+
+	return 0;
+}
+
+// Trace mode test: event order, task IDs, timestamps and the Delta extension of long gaps
+int testEptTrace(void)
+{
+	alt_u32 *taskPtr = (alt_u32 *)DRV_EPT_TASK_PTR;
+	eptTrace_t trace = {0, 0, 0};
+	eptEvent_t event[4];
+	alt_u32 timestamp;
+	int events;
+
+	printf("EPT Trace Test:\n");
+
+	DRV_EPT_RESET;
+	DRV_EPT_MODE_SET(EPT_MODE_TRACE);
+	DRV_EPT_START;											// Flushes the trace buffer
+	*taskPtr = EPT_TASK_ACTIVE | 1;						// Start Task 1
+	*taskPtr = 0x01;										// Stop Task 1
+	events = eptTraceDrain(&trace, event, 4);				// Drain while measuring
+	if ((events == 2) && (event[0].type == EPT_EVENT_TASK_START) && (event[1].type == EPT_EVENT_TASK_STOP) &&
+		(event[0].taskID == 1) && (event[1].taskID == 1) && (event[0].timestamp < event[1].timestamp))
+	{
+		printf("1. PASS: Task 1 started at %u, stopped at %u\n", (unsigned int)event[0].timestamp, (unsigned int)event[1].timestamp);
+	}
+	else
+	{
+		printf("1. FAIL: %d event(s)\n", events);
+		DRV_EPT_STOP;
+		DRV_EPT_MODE_SET(0);
+		return -1;
+	}
+
+	// Gap longer than the Delta field: an extension record precedes the next event
+	while ((timestamp = DRV_EPT_CTR_LO_GET) <= (EPT_TRACE_DELTA_MASK + event[1].timestamp));
+	*taskPtr = EPT_TASK_ACTIVE | 2;						// Start Task 2
+	*taskPtr = 0x02;										// Stop Task 2
+	events = eptTraceDrain(&trace, event, 4);
+	DRV_EPT_STOP;
+	DRV_EPT_MODE_SET(0);
+	if ((events == 2) && (event[0].type == EPT_EVENT_TASK_START) && (event[0].taskID == 2) &&
+		(event[0].timestamp > timestamp) && (event[1].timestamp > event[0].timestamp) && !trace.overflow)
+	{
+		printf("2. PASS: Task 2 started at %llu after a counter read at %u\n", (unsigned long long)event[0].timestamp, (unsigned int)timestamp);
+	}
+	else
+	{
+		printf("2. FAIL: %d event(s), Task 2 started at %llu\n", events, (unsigned long long)event[0].timestamp);
+		return -1;
+	}
+
+	return 0;
+}
+
+// Ping-pong bank test: the closed window is readable and clearable while the measurement keeps running
+int testEptWindowSwap(void)
+{
+	int i;
+	alt_u32 *taskPtr = (alt_u32 *)DRV_EPT_TASK_PTR;
+	alt_u32 bank;
+	status_t status;
+
+	printf("EPT Window Swap Test:\n");
+
+	// No pending timer IRQ: Window 2 is closed at the next assertion
+	DRV_TMRSYS_DISABLE;
+	DRV_TMRSYS_IRQ_CLR;
+	// Clear Task 0 in both banks
+	DRV_EPT_RESET;
+	status = ramInit(0, EPT_RECORD_WORDS-1, 0);
+	if (!status.type) status = windowSwap(0);
+	if (!status.type) status = ramInit(0, EPT_RECORD_WORDS-1, 0);
+	if (status.type)
+	{
+		printf("FAIL: %s\n", status.description);
+		return -1;
+	}
+	bank = DRV_EPT_SWAP_GET & EPT_SWAP_BANK;
+
+	// Window 1: Task 0 is invoked twice
+	DRV_EPT_START;
+	for (i=0; i<2; i++)
+	{
+		*taskPtr = EPT_TASK_ACTIVE;
+		*taskPtr = 0;
+	}
+	status = windowSwap(0);
+	*taskPtr = EPT_TASK_ACTIVE;							// Window 2 is running while Window 1 is read
+	if (!status.type && (DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF) == 2) && ((DRV_EPT_SWAP_GET & EPT_SWAP_BANK) != bank))
+	{
+		printf("1. PASS: Window 1 is frozen while measuring, N: 2\n");
+	}
+	else
+	{
+		printf("1. FAIL: Window 1, N: %u, %s\n", (unsigned int)DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF), status.description);
+		DRV_EPT_STOP;
+		return -1;
+	}
+	status = ramInit(0, EPT_RECORD_WORDS-1, 0);				// Cleared for Window 3
+	*taskPtr = 0;
+
+	// Window 2 is closed by the IRQ: the exception is processed completely
+	windowSwap(1);
+	if (!(DRV_EPT_SWAP_GET & EPT_SWAP_PENDING) || ((DRV_EPT_SWAP_GET & EPT_SWAP_BANK) == bank))
+	{
+		printf("2. FAIL: Swap is not armed\n");
+		DRV_EPT_STOP;
+		return -1;
+	}
+	DRV_TMRSYS_IRQ_SET(1);
+	DRV_EPT_CTXSAV_SET(1);
+	DRV_EPT_CTXSAV_SET(0);
+	DRV_EPT_ISR_SET(1);
+	DRV_TMRSYS_IRQ_CLR;
+	DRV_EPT_ISR_SET(0);
+	DRV_EPT_CTXRES_SET(1);
+	DRV_EPT_CTXRES_SET(0);
+	if (!status.type && !(DRV_EPT_SWAP_GET & EPT_SWAP_PENDING) && ((DRV_EPT_SWAP_GET & EPT_SWAP_BANK) == bank) &&
+		(DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF) == 1))
+	{
+		printf("2. PASS: Window 2 is closed at the IRQ, N: 1\n");
+	}
+	else
+	{
+		printf("2. FAIL: Window 2, N: %u\n", (unsigned int)DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF));
+		DRV_EPT_STOP;
+		return -1;
+	}
+	DRV_EPT_STOP;
+
+	// The cleared bank of Window 1 is active at ready status
+	if (DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF) == 0)
+	{
+		printf("3. PASS: Window 3 started from a cleared bank\n");
+	}
+	else
+	{
+		printf("3. FAIL: Window 3, N: %u\n", (unsigned int)DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF));
+		return -1;
+	}
 
 	return 0;
 }
 
+// Task switch test: a single probe write closes the running task and opens the next one
+int testEptTaskSwitch(void)
+{
+	alt_u32 *taskPtr = (alt_u32 *)DRV_EPT_TASK_PTR;
+	alt_u32 *switchPtr = (alt_u32 *)DRV_EPT_TASK_SWITCH_PTR;
+	alt_u32 sum[3];
+	int i;
 
+	printf("EPT Task Switch Test:\n");
 
+	if (testEptRecordsReset(3)) return -1;					// Clear the records of Task 0-2
+	DRV_EPT_START;
+	*taskPtr = EPT_TASK_ACTIVE;							// Reference: Task 0 by START-STOP writes
+	*taskPtr = 0;
+	*switchPtr = 1;											// Start Task 1 (no running task)
+	*switchPtr = 2;											// Stop Task 1, start Task 2
+	*taskPtr = 2;											// Stop Task 2
+	DRV_EPT_STOP;
 
+	for (i=0; i<3; i++)
+	{
+		sum[i] = DRV_EPT_RECORD_GET(i, EPT_RECORD_SUM_LO_OF);
+		if (DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF) != 1)
+		{
+			printf("1. FAIL: Task %d, N: %u\n", i, (unsigned int)DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF));
+			return -1;
+		}
+	}
+	printf("1. PASS: Every task is invoked once\n");
+	// A switched task costs the same probe interval as a START-STOP pair
+	if ((sum[1] == sum[0]) && (sum[2] == sum[0]))
+	{
+		printf("2. PASS: Task cycles: %u - %u - %u\n", (unsigned int)sum[0], (unsigned int)sum[1], (unsigned int)sum[2]);
+	}
+	else
+	{
+		printf("2. FAIL: Task cycles: %u - %u - %u\n", (unsigned int)sum[0], (unsigned int)sum[1], (unsigned int)sum[2]);
+		return -1;
+	}
+
+	return 0;
+}
+
+// Driver probe macros: the custom instruction (ALT_CI_EPT_CI) or the Avalon writes have a fixed latency,
+// every invocation and every task costs the same probe interval
+int testEptProbe(void)
+{
+	alt_u32 sum[3], now[3];
+	int i;
+
+#ifdef ALT_CI_EPT_CI
+	printf("EPT Probe Test (custom instruction):\n");
+#else
+	printf("EPT Probe Test (Avalon):\n");
+#endif
+
+	if (testEptRecordsReset(3)) return -1;					// Clear the records of Task 0-2
+	DRV_EPT_START;
+	for (i=0; i<EPT_PROBE_REPEAT; i++)
+	{
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);					// Task 0 by START-STOP probes
+		DRV_EPT_TASK_SET(0);
+		DRV_EPT_TASK_SWITCH_SET(1);							// Task 1-2 by task switch probes
+		DRV_EPT_TASK_SWITCH_SET(2);
+		DRV_EPT_TASK_SET(2);
+	}
+	DRV_EPT_STOP;
+
+	for (i=0; i<3; i++)
+	{
+		sum[i] = DRV_EPT_RECORD_GET(i, EPT_RECORD_SUM_LO_OF);
+		if ((DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF) != EPT_PROBE_REPEAT) ||
+			(DRV_EPT_RECORD_GET(i, EPT_RECORD_MIN_OF) != DRV_EPT_RECORD_GET(i, EPT_RECORD_MAX_OF)))
+		{
+			printf("1. FAIL: Task %d, N: %u, Min: %u, Max: %u\n", i, (unsigned int)DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF),
+				   (unsigned int)DRV_EPT_RECORD_GET(i, EPT_RECORD_MIN_OF), (unsigned int)DRV_EPT_RECORD_GET(i, EPT_RECORD_MAX_OF));
+			return -1;
+		}
+	}
+	if ((sum[1] != sum[0]) || (sum[2] != sum[0]))
+	{
+		printf("1. FAIL: Task cycles: %u - %u - %u\n", (unsigned int)sum[0], (unsigned int)sum[1], (unsigned int)sum[2]);
+		return -1;
+	}
+	printf("1. PASS: Task cycles: %u, N: %d, Min = Max\n", (unsigned int)sum[0], EPT_PROBE_REPEAT);
+
+	// Back-to-back timestamps: constant, non-zero interval
+	DRV_EPT_START;
+	for (i=0; i<3; i++)
+	{
+		now[i] = DRV_EPT_NOW32;
+	}
+	DRV_EPT_STOP;
+	if ((now[1] == now[0]) || (now[2] - now[1] != now[1] - now[0]))
+	{
+		printf("2. FAIL: Timestamps: %u - %u - %u\n", (unsigned int)now[0], (unsigned int)now[1], (unsigned int)now[2]);
+		return -1;
+	}
+	printf("2. PASS: Timestamp interval: %u cycles\n", (unsigned int)(now[1] - now[0]));
+
+	return 0;
+}
 
+#if EPT_PREEMPT_DEPTH
+// Preemption: a task started while another one runs suspends it, the suspended task resumes at the stop
+// of the preempting one -> every task record holds the exclusive time of the task
+int testEptPreempt(void)
+{
+	alt_u32 sum[EPT_PREEMPT_DEPTH + 2], status;
+	int i;
+
+	printf("EPT Preemption Test:\n");
+
+	if (testEptRecordsReset(EPT_PREEMPT_DEPTH + 2)) return -1;	// Clear the records of the nested tasks
+	DRV_EPT_START;
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);					// Task 0 runs
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 1);				// Task 1 preempts it
+	DRV_EPT_TASK_SET(1);									// Task 1 stops, Task 0 resumes
+	DRV_EPT_TASK_SET(0);									// Task 0 stops
+	DRV_EPT_STOP;
+
+	for (i=0; i<2; i++)
+	{
+		sum[i] = DRV_EPT_RECORD_GET(i, EPT_RECORD_SUM_LO_OF);
+		if (DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF) != 1)
+		{
+			printf("1. FAIL: Task %d, N: %u\n", i, (unsigned int)DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF));
+			return -1;
+		}
+	}
+	// Task 0 runs for two probe intervals, Task 1 for one
+	if ((sum[1] == 0) || (sum[0] != 2*sum[1]) || (DRV_EPT_PREEMPT_GET != 0))
+	{
+		printf("1. FAIL: Task cycles: %u - %u, status: 0x%x\n", (unsigned int)sum[0], (unsigned int)sum[1],
+			   (unsigned int)DRV_EPT_PREEMPT_GET);
+		return -1;
+	}
+	printf("1. PASS: Exclusive task cycles: %u - %u\n", (unsigned int)sum[0], (unsigned int)sum[1]);
+
+	// Nested tasks up to the stack depth, every suspended task costs the same two probe intervals
+	if (ramInit(0, (EPT_PREEMPT_DEPTH + 2)*EPT_RECORD_WORDS-1, 0).type)
+	{
+		printf("FAIL: Task record initialization.\n");
+		return -1;
+	}
+	DRV_EPT_START;
+	for (i=0; i<=EPT_PREEMPT_DEPTH; i++)
+	{
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | i);
+	}
+	status = DRV_EPT_PREEMPT_GET;
+	for (i=EPT_PREEMPT_DEPTH; i>=0; i--)
+	{
+		DRV_EPT_TASK_SET(i);
+	}
+	DRV_EPT_STOP;
+
+	for (i=0; i<=EPT_PREEMPT_DEPTH; i++)
+	{
+		sum[i] = DRV_EPT_RECORD_GET(i, EPT_RECORD_SUM_LO_OF);
+		if ((DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF) != 1) || ((sum[i] != sum[0]) && (i != EPT_PREEMPT_DEPTH)))
+		{
+			printf("2. FAIL: Task %d, N: %u, cycles: %u - %u\n", i, (unsigned int)DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF),
+				   (unsigned int)sum[i], (unsigned int)sum[0]);
+			return -1;
+		}
+	}
+	if ((status != EPT_PREEMPT_DEPTH) || (DRV_EPT_PREEMPT_GET != 0))
+	{
+		printf("2. FAIL: Status: 0x%x at the deepest task, 0x%x at the end\n", (unsigned int)status, (unsigned int)DRV_EPT_PREEMPT_GET);
+		return -1;
+	}
+	printf("2. PASS: %d suspended tasks, cycles: %u, innermost: %u\n", EPT_PREEMPT_DEPTH, (unsigned int)sum[0],
+		   (unsigned int)sum[EPT_PREEMPT_DEPTH]);
+
+	// One more preemption than the depth: the task is dropped and the overflow is flagged until cleared
+	DRV_EPT_START;
+	for (i=0; i<=EPT_PREEMPT_DEPTH+1; i++)
+	{
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | i);
+	}
+	DRV_EPT_STOP;
+	status = DRV_EPT_PREEMPT_GET;
+	DRV_EPT_PREEMPT_CLEAR;
+	if ((status != (EPT_PREEMPT_OVERFLOW | EPT_PREEMPT_DEPTH)) || (DRV_EPT_PREEMPT_GET & EPT_PREEMPT_OVERFLOW))
+	{
+		printf("3. FAIL: Status: 0x%x, after clear: 0x%x\n", (unsigned int)status, (unsigned int)DRV_EPT_PREEMPT_GET);
+		return -1;
+	}
+	printf("3. PASS: Stack overflow is flagged and cleared\n");
+	DRV_EPT_TASK_SET(0);										// No running task for the next test
+
+	return 0;
+}
+#endif
+
+#if EPT_PREEMPT_DEPTH >= 2
+// Nested regions: the records hold the exclusive and the inclusive cycles and the parent link,
+// the service walker rebuilds the call tree 0 -> {1 -> {2}, 3}
+int testEptRegion(void)
+{
+	static const int parent[EPT_REGION_NODES] = {-1, 0, 1, 0};
+	static const int order[EPT_REGION_NODES] = {0, 1, 2, 3};
+	static const int depth[EPT_REGION_NODES] = {0, 1, 2, 1};
+	regionNode_t node[EPT_REGION_NODES];
+	alt_u64 nested[EPT_REGION_NODES] = {0};
+	int nodes, i, n;
+
+	printf("EPT Region Test:\n");
+
+	if (testEptRecordsReset(TASK_ID_MAX)) return -1;		// Clear every task record
+	DRV_EPT_START;
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);					// Region 0 begin
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 1);				// Region 1 begin in 0
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 2);				// Region 2 begin in 1
+	DRV_EPT_TASK_SET(2);									// Region 2 end
+	DRV_EPT_TASK_SET(1);									// Region 1 end
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 3);				// Region 3 begin in 0
+	DRV_EPT_TASK_SET(3);									// Region 3 end
+	DRV_EPT_TASK_SET(0);									// Region 0 end
+	DRV_EPT_STOP;
+
+	nodes = regionTreeGet(node, EPT_REGION_NODES);
+	if (nodes != EPT_REGION_NODES)
+	{
+		printf("1. FAIL: %d regions\n", nodes);
+		return -1;
+	}
+	for (i=0; i<nodes; i++)
+	{
+		if ((node[i].taskID != i) || (node[i].stat.parent != parent[i]) || node[i].stat.multipleParents)
+		{
+			printf("1. FAIL: Region %d, parent: %d\n", node[i].taskID, node[i].stat.parent);
+			return -1;
+		}
+		if (parent[i] >= 0) nested[parent[i]] += node[i].stat.inclusive;
+	}
+	printf("1. PASS: Parent links\n");
+
+	// Inclusive = exclusive + inclusive cycles of the nested regions
+	for (i=0; i<nodes; i++)
+	{
+		if ((node[i].stat.count != 1) || (node[i].stat.sum == 0) || (node[i].stat.inclusive != node[i].stat.sum + nested[i]))
+		{
+			printf("2. FAIL: Region %d, N: %u, exclusive: %u, inclusive: %u\n", i, (unsigned int)node[i].stat.count,
+				   (unsigned int)node[i].stat.sum, (unsigned int)node[i].stat.inclusive);
+			return -1;
+		}
+		printf("   Region %d: exclusive %u, inclusive %u\n", i, (unsigned int)node[i].stat.sum, (unsigned int)node[i].stat.inclusive);
+	}
+	printf("2. PASS: Inclusive cycles\n");
+
+	// Depth-first walk
+	for (i=regionTreeNext(node, nodes, -1), n=0; i>=0; i=regionTreeNext(node, nodes, i), n++)
+	{
+		if ((n >= nodes) || (i != order[n]) || (node[i].depth != depth[n]))
+		{
+			printf("3. FAIL: Step %d: region %d, depth %d\n", n, i, node[i].depth);
+			return -1;
+		}
+	}
+	if (n != nodes)
+	{
+		printf("3. FAIL: %d regions walked\n", n);
+		return -1;
+	}
+	printf("3. PASS: Call tree walk\n");
+
+	return 0;
+}
+#endif
+
+#ifdef EPT_HISTOGRAM
+// Latency histograms: every invocation of the selected task is counted into the bucket of its
+// (constant) cycles in both layouts, an unselected task is not counted
+int testEptHistogram(void)
+{
+	static const alt_u32 layout[2] = {EPT_HIST_ENABLE, EPT_HIST_ENABLE | EPT_HIST_LOG2};
+	static const int taskID[EPT_HIST_TASK_SLOTS] = {0, -1, -1, -1};
+	eptHist_t hist, unselected;
+	alt_u32 cycles, bucket, p50, p75;
+	int i, l;
+
+	printf("EPT Histogram Test:\n");
+
+	for (l=0; l<2; l++)
+	{
+		if (testEptRecordsReset(2)) return -1;				// Clear the records of Task 0-1
+		eptHistSetup(layout[l], taskID);
+		DRV_EPT_START;
+		for (i=0; i<EPT_PROBE_REPEAT; i++)
+		{
+			DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);				// Task 0: slot 0
+			DRV_EPT_TASK_SET(0);
+			DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 1);			// Task 1: not selected
+			DRV_EPT_TASK_SET(1);
+		}
+		DRV_EPT_STOP;
+
+		cycles = DRV_EPT_RECORD_GET(0, EPT_RECORD_MIN_OF);
+		if (l == 0)
+		{
+			bucket = cycles;
+		}
+		else
+		{
+			for (bucket=0; (cycles >> bucket) != 0; bucket++);
+		}
+		if (bucket > EPT_HIST_BINS - 1) bucket = EPT_HIST_BINS - 1;
+		eptHistGet(0, &hist);
+		eptHistGet(1, &unselected);
+		if ((cycles != DRV_EPT_RECORD_GET(0, EPT_RECORD_MAX_OF)) || (hist.count != EPT_PROBE_REPEAT) ||
+			(hist.bin[bucket] != EPT_PROBE_REPEAT) || unselected.count)
+		{
+			printf("%d. FAIL: %u cycles, bucket %u: %u of %u, unselected: %u\n", l + 1, (unsigned int)cycles, (unsigned int)bucket,
+				   (unsigned int)hist.bin[bucket], (unsigned int)hist.count, (unsigned int)unselected.count);
+			return -1;
+		}
+		printf("%d. PASS: %s layout: %u cycles -> bucket %u, N: %u\n", l + 1, (l == 0) ? "Linear" : "Log2", (unsigned int)cycles,
+			   (unsigned int)bucket, (unsigned int)hist.count);
+	}
+
+	// The setup clears the buckets
+	eptHistSetup(0, taskID);
+	eptHistGet(0, &hist);
+	if (hist.count)
+	{
+		printf("3. FAIL: %u updates after the clear\n", (unsigned int)hist.count);
+		return -1;
+	}
+	printf("3. PASS: Clear\n");
+
+	// Percentiles interpolated in 4 cycle wide buckets: 10 updates in [4, 8), 10 updates in [12, 16)
+	hist.layout = EPT_HIST_ENABLE | (2 << EPT_HIST_SHIFT_POS);
+	hist.bin[1] = 10;
+	hist.bin[3] = 10;
+	hist.count = 20;
+	p50 = eptHistPercentile(&hist, 500);
+	p75 = eptHistPercentile(&hist, 750);
+	if ((p50 != 8) || (p75 != 14))
+	{
+		printf("4. FAIL: Percentiles: 50%%: %u, 75%%: %u\n", (unsigned int)p50, (unsigned int)p75);
+		return -1;
+	}
+	printf("4. PASS: Percentiles: 50%%: %u, 75%%: %u\n", (unsigned int)p50, (unsigned int)p75);
+
+	return 0;
+}
+#endif
+
+#ifdef EPT_BUDGET
+// Budget watchdog: overruns counted per task, the first one captured
+int testEptBudget(void)
+{
+	alt_u32 cycles[2], overruns[2];
+	alt_u64 timestamp;
+	int firstID, i;
+
+	printf("EPT Budget Watchdog Test:\n");
+
+	// Task durations without a budget
+	if (testEptRecordsReset(2)) return -1;					// Clear the records of Task 0-1
+	eptBudgetSet(0, 0);
+	eptBudgetSet(1, 0);
+	DRV_EPT_START;
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);
+	DRV_EPT_TASK_SET(0);
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 1);
+	DRV_EPT_TASK_SET(1);
+	DRV_EPT_STOP;
+	cycles[0] = DRV_EPT_RECORD_GET(0, EPT_RECORD_MIN_OF);
+	cycles[1] = DRV_EPT_RECORD_GET(1, EPT_RECORD_MIN_OF);
+	if (!eptOverrunFirstGet(&firstID, &timestamp))
+	{
+		printf("1. PASS: No budget, Task 0: %u cycles, Task 1: %u cycles\n", (unsigned int)cycles[0], (unsigned int)cycles[1]);
+	}
+	else
+	{
+		printf("1. FAIL: Overrun of Task %d without a budget\n", firstID);
+		return -1;
+	}
+
+	// Task 0 exceeds its budget, Task 1 takes exactly its budget
+	eptBudgetSet(0, cycles[0] / 2);
+	eptBudgetSet(1, cycles[1]);
+	DRV_EPT_IRQ_CLEAR(EPT_IRQ_OVERRUN);
+	DRV_EPT_START;
+	for (i=0; i<EPT_PROBE_REPEAT; i++)
+	{
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);
+		DRV_EPT_TASK_SET(0);
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 1);
+		DRV_EPT_TASK_SET(1);
+	}
+	DRV_EPT_STOP;
+	overruns[0] = eptOverrunsGet(0);
+	overruns[1] = eptOverrunsGet(1);
+	if ((overruns[0] != EPT_PROBE_REPEAT) || overruns[1] || !(DRV_EPT_IRQ_STATUS_GET & EPT_IRQ_OVERRUN))
+	{
+		printf("2. FAIL: Overruns, Task 0: %u, Task 1: %u, status: 0x%x\n", (unsigned int)overruns[0], (unsigned int)overruns[1],
+			   (unsigned int)DRV_EPT_IRQ_STATUS_GET);
+		return -1;
+	}
+	printf("2. PASS: Overruns, Task 0: %u, Task 1: %u\n", (unsigned int)overruns[0], (unsigned int)overruns[1]);
+
+	if (!eptOverrunFirstGet(&firstID, &timestamp) || firstID || (timestamp < cycles[0]))
+	{
+		printf("3. FAIL: First overrun, Task %d at %u\n", firstID, (unsigned int)timestamp);
+		return -1;
+	}
+	printf("3. PASS: First overrun, Task %d at %u\n", firstID, (unsigned int)timestamp);
+
+	DRV_EPT_OVERRUN_CLEAR;
+	DRV_EPT_IRQ_CLEAR(EPT_IRQ_OVERRUN);
+	eptBudgetSet(0, 0);
+	eptBudgetSet(1, 0);
+	if (eptOverrunFirstGet(&firstID, &timestamp) || eptOverrunsGet(0))
+	{
+		printf("4. FAIL: Clear\n");
+		return -1;
+	}
+	printf("4. PASS: Clear\n");
+
+	return 0;
+}
+#endif
+
+#ifdef EPT_SAMPLING
+// Sampling profiler: the hits of a task follow its share of the measurement, idle samples outside of it
+int testEptSampling(void)
+{
+	static const int dither[2] = {0, 4};
+	static eptSample_t sample;
+	alt_u64 cycles, expected;
+	int i, d;
+
+	printf("EPT Sampling Profiler Test:\n");
+
+	for (d=0; d<2; d++)
+	{
+		if (testEptRecordsReset(1)) return -1;				// Clear the record of Task 0
+		eptSampleSetup(EPT_SAMPLE_PERIOD, dither[d]);
+		DRV_EPT_START;
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);
+		for (i=0; i<EPT_SAMPLE_LOOP; i++) DRV_EPT_STATUS_GET;	// Task 0 runs
+		DRV_EPT_TASK_SET(0);
+		for (i=0; i<EPT_SAMPLE_LOOP; i++) DRV_EPT_STATUS_GET;	// Idle
+		DRV_EPT_STOP;
+		eptSampleGet(&sample);
+
+		// Task 0 cycles in sampling (bus clock) cycles, the mean of a short dither sequence is not exact
+		cycles = eptTaskSumGet(0) * SYSTEM_CLOCK / MEASURE_CLOCK;
+		expected = cycles / EPT_SAMPLE_PERIOD;
+		if ((sample.hits[0] + 2 + expected / 8 < expected) || (sample.hits[0] > expected + 2 + expected / 8) ||
+			sample.hits[1] || (sample.idle + 2 + expected / 8 < sample.hits[0]) || (sample.idle > sample.hits[0] + 2 + expected / 8))
+		{
+			printf("%d. FAIL: Task 0: %u hits, expected: %u, Task 1: %u, idle: %u\n", d + 1, (unsigned int)sample.hits[0],
+				   (unsigned int)expected, (unsigned int)sample.hits[1], (unsigned int)sample.idle);
+			return -1;
+		}
+		printf("%d. PASS: %s: Task 0: %u of %u samples (expected: %u), idle: %u\n", d + 1, (d == 0) ? "Fixed period" : "Dithered",
+			   (unsigned int)sample.hits[0], (unsigned int)sample.count, (unsigned int)expected, (unsigned int)sample.idle);
+	}
+
+	// The setup clears the counts
+	eptSampleSetup(0, 0);
+	eptSampleGet(&sample);
+	if (sample.count)
+	{
+		printf("3. FAIL: %u samples after the clear\n", (unsigned int)sample.count);
+		return -1;
+	}
+	printf("3. PASS: Clear\n");
+
+	return 0;
+}
+#endif
+
+#ifdef EPT_TRIGGER
+// Waits for the stop of a triggered measurement: 1 if the trigger is done and the measurement is stopped
+static int testEptTriggerWait(void)
+{
+	int i;
+
+	for (i=0; (i<EPT_TRIGGER_WAIT_MAX) && ((DRV_EPT_TRIGGER_CONTROL_GET & EPT_TRIGGER_ARM) || !DRV_EPT_STATUS_GET); i++);
+
+	return (i < EPT_TRIGGER_WAIT_MAX);
+}
+
+// Trigger unit: the measurement window between the start and the stop condition, pre-trigger trace records
+int testEptTrigger(void)
+{
+	static eptEvent_t event[EPT_TRACE_DEPTH];
+	eptTrace_t trace = {0, 0, 0};
+	alt_u64 timestamp = 0, cycles;
+	alt_u32 count[3];
+	int i, events, trigger, stopped;
+
+	printf("EPT Trigger Test:\n");
+
+	// Task 1 starts the measurement, Task 2 stops it: Task 0 runs outside of the window
+	if (testEptRecordsReset(3)) return -1;					// Clear the records of Task 0-2
+	eptTriggerArm(EPT_TRIGGER_START_TASK | EPT_TRIGGER_STOP_TASK, 1, 2, 0);
+	for (i=0; i<3; i++)
+	{
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | i);
+		DRV_EPT_TASK_SET(i);
+	}
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);
+	DRV_EPT_TASK_SET(0);
+	stopped = testEptTriggerWait();
+	for (i=0; i<3; i++) count[i] = DRV_EPT_RECORD_GET(i, EPT_RECORD_COUNT_OF);
+	if (!stopped || count[0] || (count[1] != 1))
+	{
+		printf("1. FAIL: Task start window, counts: %u, %u, %u, status: 0x%x\n", (unsigned int)count[0], (unsigned int)count[1],
+			   (unsigned int)count[2], (unsigned int)DRV_EPT_TRIGGER_CONTROL_GET);
+		DRV_EPT_STOP;
+		eptTriggerDisarm();
+		return -1;
+	}
+	printf("1. PASS: Task start window, counts: %u, %u, %u\n", (unsigned int)count[0], (unsigned int)count[1], (unsigned int)count[2]);
+
+	// Cycle conditions: the window opens after a delay and lasts a number of cycles
+	DRV_EPT_RESET;
+	eptTriggerArm(EPT_TRIGGER_START_DELAY | EPT_TRIGGER_STOP_CYCLES, EPT_TRIGGER_DELAY, EPT_TRIGGER_WINDOW, 0);
+	if (!testEptTriggerWait())
+	{
+		printf("2. FAIL: The cycle window is not closed\n");
+		DRV_EPT_STOP;
+		eptTriggerDisarm();
+		return -1;
+	}
+	cycles = DRV_EPT_CTR_LO_GET * SYSTEM_CLOCK / MEASURE_CLOCK;
+	if ((cycles < EPT_TRIGGER_WINDOW) || (cycles > EPT_TRIGGER_WINDOW + 4))
+	{
+		printf("2. FAIL: Cycle window: %u cycles, expected: %u\n", (unsigned int)cycles, EPT_TRIGGER_WINDOW);
+		return -1;
+	}
+	printf("2. PASS: Cycle window: %u cycles, expected: %u\n", (unsigned int)cycles, EPT_TRIGGER_WINDOW);
+
+	// Pre-trigger: the newest records before Task 2 are kept, two events after it stop the measurement
+	// (back-to-back probes may add an event until the stop reaches the measurement)
+	DRV_EPT_RESET;
+	DRV_EPT_MODE_SET(EPT_MODE_TRACE);
+	eptTriggerArm(EPT_TRIGGER_PRE | EPT_TRIGGER_START_TASK | EPT_TRIGGER_STOP_EVENTS, 2, 2, EPT_TRIGGER_KEEP);
+	for (i=0; i<EPT_PROBE_REPEAT; i++)
+	{
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);
+		DRV_EPT_TASK_SET(0);
+		DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 1);
+		DRV_EPT_TASK_SET(1);
+	}
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE | 2);
+	DRV_EPT_TASK_SET(2);
+	DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);
+	DRV_EPT_TASK_SET(0);
+	if (!testEptTriggerWait())
+	{
+		printf("3. FAIL: The event window is not closed\n");
+		DRV_EPT_STOP;
+		DRV_EPT_MODE_SET(0);
+		eptTriggerDisarm();
+		return -1;
+	}
+	events = eptTraceDrain(&trace, event, EPT_TRACE_DEPTH);
+	DRV_EPT_MODE_SET(0);
+	for (trigger=0; (trigger<events) && !((event[trigger].type == EPT_EVENT_TASK_START) && (event[trigger].taskID == 2)); trigger++);
+	if ((trigger == events) || !trigger || (trigger > EPT_TRIGGER_KEEP) || (events - trigger < 2) || trace.overflow ||
+		!eptTriggerTimeGet(&timestamp) || !timestamp)
+	{
+		printf("3. FAIL: %d event(s), Task 2 started at event %d, trigger at %u\n", events, trigger, (unsigned int)timestamp);
+		return -1;
+	}
+	printf("3. PASS: %d record(s) before the trigger at %u, %d after it\n", trigger, (unsigned int)timestamp, events - trigger - 1);
+
+	return 0;
+}
+#endif
+
+// Back-to-back events: an exception closed right before a task switch, and edges merged into unprocessed ones
+int testEptLostEvents(void)
+{
+	alt_u32 *taskPtr = (alt_u32 *)DRV_EPT_TASK_PTR;
+	alt_u32 *switchPtr = (alt_u32 *)DRV_EPT_TASK_SWITCH_PTR;
+	alt_u32 lost;
+	int i;
+
+	printf("EPT Lost Events Test:\n");
+
+	// ISR probes without an IRQ stay captured: the second pair is merged
+	DRV_EPT_RESET;
+	DRV_EPT_START;
+	DRV_EPT_ISR_SET(1);
+	DRV_EPT_ISR_SET(0);
+	DRV_EPT_ISR_SET(1);
+	DRV_EPT_ISR_SET(0);
+	DRV_EPT_STOP;
+	lost = DRV_EPT_LOST_EVENTS_GET;
+	DRV_EPT_LOST_CLEAR;
+	if ((lost == 2) && (DRV_EPT_LOST_EVENTS_GET == 0))
+	{
+		printf("1. PASS: Merged edges are counted and cleared, lost: %u\n", (unsigned int)lost);
+	}
+	else
+	{
+		printf("1. FAIL: Lost: %u, after clear: %u\n", (unsigned int)lost, (unsigned int)DRV_EPT_LOST_EVENTS_GET);
+		return -1;
+	}
+
+	// Exception inside Task 0, Task 1 is switched in right after the Context Restore
+	if (testEptRecordsReset(2)) return -1;					// Flush the captured probes
+	if (ramInit(EPT_RAM_IR_OF, EPT_RAM_WORD_MAX, 0).type)
+	{
+		printf("FAIL: IR record initialization.\n");
+		return -1;
+	}
+	DRV_TMRSYS_DISABLE;
+	DRV_TMRSYS_IRQ_CLR;
+	DRV_EPT_START;
+	*taskPtr = EPT_TASK_ACTIVE;
+	DRV_TMRSYS_IRQ_SET(1);
+	DRV_EPT_CTXSAV_SET(1);
+	DRV_EPT_CTXSAV_SET(0);
+	DRV_TMRSYS_IRQ_CLR;
+	DRV_EPT_ISR_SET(1);
+	DRV_EPT_ISR_SET(0);
+	DRV_EPT_CTXRES_SET(1);
+	DRV_EPT_CTXRES_SET(0);
+	*switchPtr = 1;											// Stop Task 0, start Task 1
+	*taskPtr = 1;											// Stop Task 1
+	DRV_EPT_STOP;
+
+	for (i=0; i<IR_TIMING_PARAM; i++)
+	{
+		if (DRV_EPT_RECORD_GET(TASK_ID_MAX + i, EPT_RECORD_COUNT_OF) != 1)
+		{
+			printf("2. FAIL: Exception parameter %d, N: %u\n", i, (unsigned int)DRV_EPT_RECORD_GET(TASK_ID_MAX + i, EPT_RECORD_COUNT_OF));
+			return -1;
+		}
+	}
+	if ((DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF) == 1) && (DRV_EPT_RECORD_GET(1, EPT_RECORD_COUNT_OF) == 1) && !DRV_EPT_LOST_EVENTS_GET)
+	{
+		printf("2. PASS: Exception and task switch are recorded, no lost event\n");
+	}
+	else
+	{
+		printf("2. FAIL: Task 0 N: %u, Task 1 N: %u, lost: %u\n", (unsigned int)DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF),
+			   (unsigned int)DRV_EPT_RECORD_GET(1, EPT_RECORD_COUNT_OF), (unsigned int)DRV_EPT_LOST_EVENTS_GET);
+		return -1;
+	}
+
+	return 0;
+}
+
+#ifdef EPT_IRQ
+// Interrupt test handler: collects the reported sources
+static void testEptIrqHandler(void *context, alt_u32 status)
+{
+	*(volatile alt_u32 *)context |= status;
+}
+
+// Interrupt sender: every source is reported once through the registered handler and is cleared by the driver ISR
+int testEptIrq(void)
+{
+	alt_u32 *taskPtr = (alt_u32 *)DRV_EPT_TASK_PTR;
+	volatile alt_u32 reported = 0;
+	int i;
+
+	printf("EPT Interrupt Test:\n");
+
+	// Measurement done
+	DRV_EPT_RESET;
+	if (eptIrqRegister(EPT_IRQ_DONE, testEptIrqHandler, (void *)&reported))
+	{
+		printf("FAIL: ISR registration.\n");
+		return -1;
+	}
+	DRV_EPT_START;
+	*taskPtr = EPT_TASK_ACTIVE;
+	*taskPtr = 0;
+	DRV_EPT_STOP;
+	for (i=0; (i<EPT_IRQ_WAIT_MAX) && !reported; i++) DRV_EPT_STATUS_GET;
+	if ((reported == EPT_IRQ_DONE) && !DRV_EPT_IRQ_STATUS_GET)
+	{
+		printf("1. PASS: Done is reported and cleared\n");
+	}
+	else
+	{
+		printf("1. FAIL: Done, reported: 0x%x, status: 0x%x\n", (unsigned int)reported, (unsigned int)DRV_EPT_IRQ_STATUS_GET);
+		eptIrqRegister(0, NULL, NULL);
+		return -1;
+	}
+
+	// Half of the Count range is reached: a masked source is still flagged in the status
+	reported = 0;
+	eptIrqRegister(EPT_IRQ_ACCUMULATOR, testEptIrqHandler, (void *)&reported);
+	DRV_EPT_RAM_SET(EPT_RECORD_COUNT_OF, 0x7fffffff);
+	DRV_EPT_START;
+	*taskPtr = EPT_TASK_ACTIVE;
+	*taskPtr = 0;
+	for (i=0; (i<EPT_IRQ_WAIT_MAX) && !reported; i++) DRV_EPT_STATUS_GET;
+	DRV_EPT_STOP;
+	if ((reported == EPT_IRQ_ACCUMULATOR) && (DRV_EPT_IRQ_STATUS_GET == EPT_IRQ_DONE))
+	{
+		printf("2. PASS: Accumulator warning while measuring\n");
+	}
+	else
+	{
+		printf("2. FAIL: Accumulator, reported: 0x%x, status: 0x%x\n", (unsigned int)reported, (unsigned int)DRV_EPT_IRQ_STATUS_GET);
+		eptIrqRegister(0, NULL, NULL);
+		return -1;
+	}
+
+	// Trace buffer at half depth: a record per probe write
+	reported = 0;
+	eptIrqRegister(EPT_IRQ_TRACE | EPT_IRQ_SWAP, testEptIrqHandler, (void *)&reported);
+	DRV_EPT_MODE_SET(EPT_MODE_TRACE);
+	DRV_EPT_START;
+	for (i=0; (i<EPT_TRACE_DEPTH) && !reported; i++)
+	{
+		*taskPtr = (i & 1) ? 0 : EPT_TASK_ACTIVE;
+	}
+	if ((reported == EPT_IRQ_TRACE) && (i >= EPT_TRACE_DEPTH / 2))
+	{
+		printf("3. PASS: Trace watermark after %d records\n", i);
+	}
+	else
+	{
+		printf("3. FAIL: Trace, reported: 0x%x after %d records\n", (unsigned int)reported, i);
+		DRV_EPT_STOP;
+		DRV_EPT_MODE_SET(0);
+		eptIrqRegister(0, NULL, NULL);
+		return -1;
+	}
+
+	// Bank swap while measuring
+	reported = 0;
+	DRV_EPT_SWAP_SET(1);
+	for (i=0; (i<EPT_IRQ_WAIT_MAX) && !reported; i++) DRV_EPT_STATUS_GET;
+	DRV_EPT_STOP;
+	DRV_EPT_MODE_SET(0);
+	eptIrqRegister(0, NULL, NULL);
+	if (reported == EPT_IRQ_SWAP)
+	{
+		printf("4. PASS: Bank swap is reported\n");
+	}
+	else
+	{
+		printf("4. FAIL: Swap, reported: 0x%x\n", (unsigned int)reported);
+		return -1;
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef EPT_DMA
+// Readout DMA destination: completion word and a whole record bank
+static alt_u32 testEptDmaBuffer[EPT_DMA_RECORD_WORDS + 1];
+
+// Polls the completion word until the copy of the given sequence number is written
+static int testEptDmaWait(alt_u32 sequence)
+{
+	volatile alt_u32 *buffer = testEptDmaBuffer;
+	int i;
+
+	for (i=0; (i<EPT_DMA_WAIT_MAX) && (EPT_DMA_SEQUENCE(buffer[0]) != sequence); i++) DRV_EPT_STATUS_GET;
+
+	return (EPT_DMA_SEQUENCE(buffer[0]) == sequence) ? 0 : -1;
+}
+
+// Readout DMA: the records reach the buffer at the stop and the copied bank starts cleared, the trace records are copied periodically
+int testEptDma(void)
+{
+	volatile alt_u32 *buffer = testEptDmaBuffer;
+	status_t status;
+	int i, run;
+
+	printf("EPT Readout DMA Test:\n");
+
+	// Both banks start cleared, the DMA keeps them cleared
+	DRV_EPT_RESET;
+	status = ramInit(0, EPT_RAM_WORD_MAX, 0);
+	if (!status.type) status = windowSwap(0);
+	if (!status.type) status = ramInit(0, EPT_RAM_WORD_MAX, 0);
+	if (status.type)
+	{
+		printf("FAIL: %s\n", status.description);
+		return -1;
+	}
+
+	// Two measurements: Task 0 is invoked twice, then once
+	eptDmaSetup(buffer, EPT_DMA_ENABLE | EPT_DMA_AT_STOP, 0);
+	for (run=1; run<=2; run++)
+	{
+		DRV_EPT_START;
+		for (i=run; i<=2; i++)
+		{
+			DRV_EPT_TASK_SET(EPT_TASK_ACTIVE);
+			DRV_EPT_TASK_SET(0);
+		}
+		DRV_EPT_STOP;
+		if (testEptDmaWait(run) || (EPT_DMA_WORDS(buffer[0]) != EPT_DMA_RECORD_WORDS) ||
+			(buffer[1 + EPT_RECORD_COUNT_OF] != (alt_u32)(3 - run)) || DRV_EPT_RECORD_GET(0, EPT_RECORD_COUNT_OF))
+		{
+			printf("%d. FAIL: Records at the stop, completion: 0x%x, N: %u\n", run, (unsigned int)buffer[0], (unsigned int)buffer[1 + EPT_RECORD_COUNT_OF]);
+			eptDmaSetup(NULL, 0, 0);
+			return -1;
+		}
+		printf("%d. PASS: Records copied at the stop, N: %u, the RAM is cleared\n", run, (unsigned int)buffer[1 + EPT_RECORD_COUNT_OF]);
+	}
+	if (!(DRV_EPT_IRQ_STATUS_GET & EPT_IRQ_DMA))
+	{
+		printf("3. FAIL: Completion is not flagged in the IRQ status\n");
+		eptDmaSetup(NULL, 0, 0);
+		return -1;
+	}
+
+	// Trace records are drained by the period while measuring
+	eptDmaSetup(buffer, EPT_DMA_ENABLE | EPT_DMA_TRACE, EPT_DMA_PERIOD);
+	DRV_EPT_MODE_SET(EPT_MODE_TRACE);
+	DRV_EPT_START;
+	for (i=0; i<2*EPT_TRACE_DEPTH; i++)						// Overflows without the readout
+	{
+		DRV_EPT_TASK_SET((i & 1) ? 0 : EPT_TASK_ACTIVE);
+	}
+	DRV_EPT_STOP;
+	DRV_EPT_MODE_SET(0);
+	eptDmaSetup(NULL, 0, 0);
+	if (EPT_DMA_SEQUENCE(buffer[0]) && EPT_DMA_WORDS(buffer[0]) && !(DRV_EPT_TRACE_LEVEL_GET & EPT_TRACE_OVERFLOW) &&
+		(EPT_TRACE_TYPE(buffer[1]) <= EPT_EVENT_TASK_STOP))
+	{
+		printf("3. PASS: Trace copies: %u, last: %u records\n", (unsigned int)EPT_DMA_SEQUENCE(buffer[0]), (unsigned int)EPT_DMA_WORDS(buffer[0]));
+	}
+	else
+	{
+		printf("3. FAIL: Trace, completion: 0x%x, level: 0x%x\n", (unsigned int)buffer[0], (unsigned int)DRV_EPT_TRACE_LEVEL_GET);
+		return -1;
+	}
+
+	return 0;
+}
+#endif